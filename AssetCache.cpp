@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "AssetCache.h"
+#include "MappedAudioFile.h"
+
+#include <stdexcept>
+
+using namespace lab;
+
+AssetCache::AssetCache(std::string asset_base, size_t budget_bytes)
+    : _asset_base(std::move(asset_base))
+{
+    _stats.budget = budget_bytes;
+}
+
+AssetCache::Future AssetCache::request(Key const& key, std::shared_ptr<Promise>& decode)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(key);
+    if (it != _entries.end())
+    {
+        _stats.hits++;
+        _lru.splice(_lru.begin(), _lru, it->second.lru);
+        return it->second.bus;
+    }
+
+    // the caller decodes, everyone else waits on the future
+    _stats.misses++;
+    decode = std::make_shared<Promise>();
+    _lru.push_front(key);
+    Entry& entry = _entries[key];
+    entry.bus = decode->get_future().share();
+    entry.lru = _lru.begin();
+    return entry.bus;
+}
+
+void AssetCache::decode(Key const& key, Promise& decoded)
+{
+    // decode outside of the lock, so that other files can be decoded concurrently
+    const std::string path = _asset_base + std::get<0>(key);
+    std::shared_ptr<AudioBus> bus;
+    try
+    {
+        bus = load(path, std::get<1>(key), std::get<2>(key));
+        if (!bus)
+            throw std::runtime_error("couldn't open " + path);
+    }
+    catch (...)
+    {
+        // waiters see the failure; later requests try again
+        decoded.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        _lru.erase(it->second.lru);
+        _entries.erase(it);
+        return;
+    }
+
+    decoded.set_value(bus);
+
+    // bus is still referenced here, so the new entry itself won't be evicted
+    std::lock_guard<std::mutex> lock(_mutex);
+    Entry& entry = _entries[key];
+    entry.bytes = static_cast<size_t>(bus->numberOfChannels()) * bus->length() * sizeof(float);
+    _stats.bytes += entry.bytes;
+    evict();
+}
+
+std::shared_ptr<AudioBus> AssetCache::get(const std::string& name, float sampleRate, bool mixToMono)
+{
+    const Key key(name, sampleRate, mixToMono);
+    std::shared_ptr<Promise> promise;
+    Future bus = request(key, promise);
+    if (promise)
+        decode(key, *promise);
+    return bus.get();
+}
+
+AssetCache::Future AssetCache::getAsync(WorkerPool& pool, const std::string& name, float sampleRate, bool mixToMono)
+{
+    const Key key(name, sampleRate, mixToMono);
+    std::shared_ptr<Promise> promise;
+    Future bus = request(key, promise);
+    if (promise)
+        pool.submit([this, key, promise]() { decode(key, *promise); });
+    return bus;
+}
+
+std::shared_ptr<AudioBus> AssetCache::load(const std::string& path, float sampleRate, bool mixToMono) const
+{
+    if (mixToMono)
+        return MakeBusFromFile(path, true, sampleRate);
+
+    const std::string sidecar = SidecarPath(path, sampleRate);
+    if (IsFileUpToDate(sidecar, path))
+    {
+        if (std::shared_ptr<AudioBus> bus = MakeBusFromMappedFile(sidecar, sampleRate))
+            return bus;
+    }
+
+    std::shared_ptr<AudioBus> bus = MakeBusFromMappedFile(path, sampleRate);
+    if (!bus)
+        bus = MakeBusFromFile(path, false, sampleRate);
+
+    if (bus && _write_sidecars)
+        WritePlanarFloatFile(sidecar, *bus, sampleRate);
+    return bus;
+}
+
+void AssetCache::evict()
+{
+    if (!_stats.budget)
+        return;
+
+    // oldest first, skipping buses that are still decoding or still in use
+    for (auto it = _lru.end(); it != _lru.begin() && _stats.bytes > _stats.budget;)
+    {
+        --it;
+        auto entry = _entries.find(*it);
+        if (!entry->second.bytes || entry->second.bus.get().use_count() > 1)
+            continue;
+
+        _stats.bytes -= entry->second.bytes;
+        _stats.evictions++;
+        _entries.erase(entry);
+        it = _lru.erase(it);
+    }
+}
+
+void AssetCache::setBudget(size_t budget_bytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.budget = budget_bytes;
+    evict();
+}
+
+AssetCache::Stats AssetCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Stats s = _stats;
+    s.entries = _entries.size();
+    return s;
+}
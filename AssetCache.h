@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_ASSETCACHE_H
+#define LABSOUNDDEMO_ASSETCACHE_H
+
+#include "LabSound/LabSound.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+// AssetCache shares decoded sample files between contexts, and between the threads that
+// build them. A file is decoded once for each sample rate and channel layout it is asked
+// for; a request for a file that another thread is already decoding waits for that decode
+// instead of starting a second one. Cached buses are shared, so they must be treated as
+// read only.
+//
+// Uncompressed wav files are read through a memory mapping, see MappedAudioFile.h, and
+// converted to float in a single pass when they are loaded, rather than decoded. With
+// sidecars enabled, every file the cache decodes is also written as a planar float file for
+// that sample rate, to the user's cache directory since the assets may be read only, see
+// SidecarPath(). Later runs map it in place instead of decoding.
+//
+// With a memory budget, the least recently used buses are evicted once the budget is
+// exceeded. Only buses the cache holds the last reference to are evicted, so the cache may
+// stay over budget while its buses are in use.
+class AssetCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;       // decoded samples held by the cache
+        size_t budget = 0;      // 0 for unlimited
+    };
+
+    using Future = std::shared_future<std::shared_ptr<lab::AudioBus>>;
+
+private:
+    // name, sample rate, mixed to mono
+    using Key = std::tuple<std::string, float, bool>;
+    using Promise = std::promise<std::shared_ptr<lab::AudioBus>>;
+
+    struct Entry
+    {
+        Future bus;
+        size_t bytes = 0;                   // 0 while decoding
+        std::list<Key>::iterator lru;
+    };
+
+    std::string _asset_base;
+    std::atomic<bool> _write_sidecars{false};
+    mutable std::mutex _mutex;
+    std::map<Key, Entry> _entries;
+    std::list<Key> _lru;                    // most recently used first
+    Stats _stats;
+
+    void evict();
+    Future request(Key const& key, std::shared_ptr<Promise>& decode);
+    void decode(Key const& key, Promise& decoded);
+    std::shared_ptr<lab::AudioBus> load(const std::string& path, float sampleRate, bool mixToMono) const;
+
+public:
+    explicit AssetCache(std::string asset_base, size_t budget_bytes = 0);
+
+    // name is relative to the asset base. Throws if the file can't be decoded.
+    std::shared_ptr<lab::AudioBus> get(const std::string& name, float sampleRate, bool mixToMono = false);
+
+    // As get, but decodes on pool rather than on the calling thread. The future throws if
+    // the file can't be decoded. The cache must outlive the pool's tasks.
+    Future getAsync(WorkerPool& pool, const std::string& name, float sampleRate, bool mixToMono = false);
+
+    void setBudget(size_t budget_bytes);
+
+    // sidecars are written to the user's cache directory; failures to write them are ignored
+    void writeSidecars(bool enable) { _write_sidecars = enable; }
+
+    Stats stats() const;
+};
+
+#endif
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "BlockFunctionNode.h"
+
+#include <algorithm>
+#include <cstddef>
+
+using namespace lab;
+
+BlockFunctionNode::BlockFunctionNode(AudioContext& ac, int channels)
+    : FunctionNode(ac, channels)
+    , _channels(channels)
+    , _pointers(channels)
+    , _scratch(static_cast<size_t>(AudioNode::ProcessingSizeInFrames) * channels)
+{
+    setFunction([this](ContextRenderLock& r, FunctionNode*, int channel, float* values, int frames) {
+        render(r, channel, values, frames);
+    });
+}
+
+void BlockFunctionNode::render(ContextRenderLock& r, int channel, float* values, int frames)
+{
+    if (channel == 0)
+    {
+        // FunctionNode passes each channel of its output bus in turn, at the same offset into
+        // the quantum, so where channel 0 lands locates all of them, and the block function
+        // can write the bus directly.
+        _direct = false;
+        AudioBus* bus = output(0)->bus(r);
+        if (bus && bus->numberOfChannels() == _channels)
+        {
+            const std::ptrdiff_t offset = values - bus->channel(0)->data();
+            if (offset >= 0 && offset + frames <= bus->length())
+            {
+                for (int c = 0; c < _channels; ++c)
+                    _pointers[c] = bus->channel(c)->mutableData() + offset;
+                _direct = true;
+            }
+        }
+
+        if (!_direct)
+        {
+            if (_scratch.size() < static_cast<size_t>(frames) * _channels)
+                _scratch.resize(static_cast<size_t>(frames) * _channels);
+
+            _pointers[0] = values;
+            for (int c = 1; c < _channels; ++c)
+                _pointers[c] = _scratch.data() + static_cast<size_t>(c) * frames;
+        }
+
+        if (_block)
+            _block(r, this, _pointers.data(), _channels, frames, now());
+        else
+            for (int c = 0; c < _channels; ++c)
+                std::fill(_pointers[c], _pointers[c] + frames, 0.f);
+        return;
+    }
+
+    // already written, unless the block function wrote to scratch
+    if (!_direct && channel < _channels)
+        std::copy(_pointers[channel], _pointers[channel] + frames, values);
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_BLOCKFUNCTIONNODE_H
+#define LABSOUNDDEMO_BLOCKFUNCTIONNODE_H
+
+#include "LabSound/LabSound.h"
+
+#include <functional>
+#include <vector>
+
+// BlockFunctionNode is a FunctionNode whose function is called once per quantum with every
+// output channel, rather than once per channel. A stereo synth written as a FunctionNode
+// computes everything twice, and needs a copy of its state for each channel; written as a
+// BlockFunctionNode it runs once and writes each channel from the same state.
+//
+// The function is passed the start time of the quantum, in seconds since the node started,
+// which is the same as now() on a FunctionNode.
+class BlockFunctionNode : public lab::FunctionNode
+{
+public:
+    using BlockFunction = std::function<void(lab::ContextRenderLock& r, BlockFunctionNode* me,
+                                             float* const* channels, int channelCount,
+                                             int framesToProcess, double now)>;
+
+private:
+    int _channels;
+    BlockFunction _block;
+
+    // where the block function writes this quantum
+    std::vector<float*> _pointers;
+    bool _direct = false;           // _pointers refer to the output bus
+    std::vector<float> _scratch;    // otherwise, channels after the first are written here
+
+    void render(lab::ContextRenderLock& r, int channel, float* values, int frames);
+
+public:
+    explicit BlockFunctionNode(lab::AudioContext& ac, int channels = 2);
+    virtual ~BlockFunctionNode() = default;
+
+    // set before the node is started
+    void setBlockFunction(BlockFunction fn) { _block = std::move(fn); }
+};
+
+#endif
@@ -0,0 +1,1717 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+
+#if defined(_MSC_VER)
+    #if !defined(_CRT_SECURE_NO_WARNINGS)
+        #define _CRT_SECURE_NO_WARNINGS
+    #endif
+    #if !defined(NOMINMAX)
+        #define NOMINMAX
+    #endif
+#endif
+
+#define USE_LIVE
+
+#include "LabSound/LabSound.h"
+#include "LabSound/extended/Util.h"
+#include "DemoExamples.h"
+#include "DemoKernels.h"
+#include "FastMath.h"
+#include "GraphTransaction.h"
+#include "HrtfSpatializerNode.h"
+#include "ImpulseCache.h"
+#include "KernelNode.h"
+#include "OfflineRender.h"
+#include "ParamQueueNode.h"
+#include "PartitionedConvolverNode.h"
+#include "PipelineStageNode.h"
+#include "StreamingFileNode.h"
+#include "StreamingRecorder.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <string>
+
+// In the future, this class could do all kinds of clever things, like setting up the context,
+// handling recording functionality, etc.
+
+#include <string>
+#include <vector>
+
+using namespace lab;
+
+#ifdef _MSC_VER
+#include <windows.h>
+std::string PrintCurrentDirectory()
+{
+    char buffer[MAX_PATH] = {0};
+    GetCurrentDirectory(MAX_PATH, buffer);
+    return std::string(buffer);
+}
+#endif
+
+// Releases the virtual clock, if there is one, so the render thread isn't held at the
+// clock's gate while the context shuts down.
+struct ExampleContextDeleter
+{
+    std::shared_ptr<QuantumClockNode> clock;
+
+    void operator()(lab::AudioContext* context) const
+    {
+        if (clock)
+            clock->release();
+        delete context;
+    }
+};
+
+using ExampleContext = std::unique_ptr<lab::AudioContext, ExampleContextDeleter>;
+
+struct labsound_example
+{
+    std::mt19937 randomgenerator;
+
+    std::vector<std::shared_ptr<lab::AudioNode>> _nodes;
+
+    // what plays the example, set before play(), and what the example reports back to it
+    ExampleHost const* _host = nullptr;
+    ExampleResult _result;
+
+    // what the example connects its output to, the destination or the host's output
+    std::shared_ptr<lab::AudioNode> _output;
+
+    // state of the virtual clock, if the example is running against one
+    std::shared_ptr<QuantumClockNode> _virtual_clock;
+    lab::AudioContext* _virtual_context = nullptr;
+    float _virtual_samplerate = 0;
+    double _virtual_time = 0;
+    bool _virtual_started = false;
+
+    virtual void play(int argc, char** argv) = 0;
+
+    // config is the input, output pair returned by GetDefaultAudioDeviceConfiguration
+    ExampleContext MakeExampleContext(const std::pair<AudioStreamConfig, AudioStreamConfig>& config)
+    {
+        _virtual_clock.reset();
+        _virtual_context = nullptr;
+        _output.reset();
+
+        if (!_host->virtual_clock)
+        {
+            ExampleContext context(lab::MakeRealtimeAudioContext(config.second, config.first).release());
+            _output = context->device();
+            return context;
+        }
+
+        // an hour of virtual time is far longer than any example runs
+        const float max_render_ms = 60.f * 60.f * 1000.f;
+        std::unique_ptr<lab::AudioContext> offline = lab::MakeOfflineAudioContext(config.second, max_render_ms);
+
+        auto clock = std::make_shared<QuantumClockNode>(*offline.get());
+        clock->setGated(true);
+        offline->addAutomaticPullNode(clock);
+        offline->offlineRenderCompleteCallback = [clock]() { clock->release(); };
+
+        _virtual_clock = clock;
+        _virtual_samplerate = offline->sampleRate();
+        _virtual_time = 0;
+        _virtual_started = false;
+
+        ExampleContext context(offline.release(), ExampleContextDeleter{ clock });
+        _virtual_context = context.get();
+        if (_host->output)
+            _output = _host->output(*context.get(), clock);
+        if (!_output)
+            _output = context->device();
+        return context;
+    }
+
+    // the node the example's graph is connected to, in place of the destination
+    std::shared_ptr<lab::AudioNode> const& Output() const { return _output; }
+
+    float MidiToFrequency(int midiNote)
+    {
+        return 440.0f * FastExp2((midiNote - 57.0f) / 12.0f);
+    }
+
+    template <typename Duration>
+    void Wait(Duration duration)
+    {
+        if (!_virtual_clock)
+        {
+            std::this_thread::sleep_for(duration);
+            return;
+        }
+
+        // Rendering starts at the first Wait, so that examples may hold the render lock
+        // while they build their graphs. Once it starts, the render thread is held at the
+        // clock's gate between Waits, so the render lock must not be taken again.
+        if (!_virtual_started)
+        {
+            _virtual_started = true;
+            _virtual_context->startOfflineRendering();
+        }
+
+        _virtual_time += std::chrono::duration<double>(duration).count();
+        _virtual_clock->advanceTo(static_cast<uint64_t>(_virtual_time * _virtual_samplerate));
+    }
+
+    // Commits a transaction. Once the virtual clock has started, the render thread holds
+    // the render lock at the clock's gate, so the held thread applies the edits instead.
+    void Commit(GraphTransaction& t)
+    {
+        if (_virtual_clock && _virtual_started)
+            t.commit(*_virtual_clock);
+        else
+            t.commit();
+    }
+    
+    // Returns input, output
+    std::pair<AudioStreamConfig, AudioStreamConfig> GetDefaultAudioDeviceConfiguration(const bool with_input = false)
+    {
+        AudioStreamConfig inputConfig;
+        AudioStreamConfig outputConfig;
+
+        if (_host->virtual_clock)
+        {
+            // there's no device behind the virtual clock, so render at the host's rate
+            if (with_input)
+                throw std::invalid_argument("live input is not available with the virtual clock");
+
+            outputConfig.device_index = 0;
+            outputConfig.desired_channels = LABSOUND_DEFAULT_CHANNELS;
+            outputConfig.desired_samplerate = _host->samplerate;
+            return {inputConfig, outputConfig};
+        }
+
+        const std::vector<AudioDeviceInfo> audioDevices = lab::MakeAudioDeviceList();
+        const AudioDeviceIndex default_output_device = lab::GetDefaultOutputAudioDeviceIndex();
+        const AudioDeviceIndex default_input_device = lab::GetDefaultInputAudioDeviceIndex();
+
+        AudioDeviceInfo defaultOutputInfo, defaultInputInfo;
+        for (auto & info : audioDevices)
+        {
+            if (info.index == default_output_device.index) defaultOutputInfo = info; 
+            else if (info.index == default_input_device.index) defaultInputInfo = info;
+        }
+
+        if (defaultOutputInfo.index != -1)
+        {
+            outputConfig.device_index = defaultOutputInfo.index;
+            outputConfig.desired_channels = std::min(uint32_t(2), defaultOutputInfo.num_output_channels);
+            outputConfig.desired_samplerate = defaultOutputInfo.nominal_samplerate;
+        }
+
+        if (with_input)
+        {
+            if (defaultInputInfo.index != -1)
+            {
+                inputConfig.device_index = defaultInputInfo.index;
+                inputConfig.desired_channels = std::min(uint32_t(1), defaultInputInfo.num_input_channels);
+                inputConfig.desired_samplerate = defaultInputInfo.nominal_samplerate;
+            }
+            else
+            {
+                throw std::invalid_argument("the default audio input device was requested but none were found");
+            }
+        }
+
+        return {inputConfig, outputConfig};
+    }
+
+    inline std::vector<std::string> SplitCommandLine(int argc, char ** argv)
+    {
+        // takes a string, and separates out according to embedded quoted strings
+        // the quotes are preserved, and quotes are escaped.
+        // examples
+        // * abc > abc
+        // * abc "def" > abc, "def"
+        // * a "def" ghi > a, "def", ghi
+        // * a\"bc > a\"bc
+
+        auto Separate = [](const std::string & input) -> std::vector<std::string>
+        {
+            std::vector<std::string> output;
+
+            size_t curr = 0;
+            size_t start = 0;
+            size_t end = input.length();
+            bool inQuotes = false;
+
+            while (curr < end)
+            {
+                if (input[curr] == '\\')
+                {
+                    ++curr;
+                    if (curr != end && input[curr] == '\"')
+                        ++curr;
+                }
+                else
+                {
+                    if (input[curr] == '\"')
+                    {
+                        // no empty string if not in quotes, otherwise preserve it
+                        if (inQuotes || (start != curr))
+                        {
+                            output.push_back(input.substr(start - (inQuotes ? 1 : 0), curr - start + (inQuotes ? 2 : 0)));
+                        }
+                        inQuotes = !inQuotes;
+                        start = curr + 1;
+                    }
+                    ++curr;
+                }
+            }
+
+            // catch the case of a trailing substring that was not quoted, or a completely unquoted string
+            if (curr - start > 0) output.push_back(input.substr(start, curr - start));
+
+            return output;
+        };
+
+        // join the command line together so quoted strings can be found
+        std::string cmd;
+        for (int i = 1; i < argc; ++i)
+        {
+            if (i > 1) cmd += " ";
+            cmd += std::string(argv[i]);
+        }
+
+        // separate the command line, respecting quoted strings
+        std::vector<std::string> result = Separate(cmd);
+        result.insert(result.begin(), std::string{argv[0]});
+        return result;
+    }
+
+    inline std::string SampleFilePath(char const*const name, int argc, char** argv)
+    {
+        std::string path_prefix;
+        auto cmds = SplitCommandLine(argc, argv);
+
+        if (cmds.size() > 1) path_prefix = cmds[1] + "/";  // cmds[0] is the path to the exe
+        else path_prefix = _host->asset_base;
+
+        return path_prefix + name;
+    }
+
+    inline std::shared_ptr<AudioBus> MakeBusFromSampleFile(char const*const name, int argc, char** argv)
+    {
+        const std::string path = SampleFilePath(name, argc, argv);
+        std::shared_ptr<AudioBus> bus = MakeBusFromFile(path, false);
+        if (!bus) throw std::runtime_error("couldn't open " + path);
+
+        return bus;
+    }
+};
+
+//-----------------//
+//    ex_simple    //
+//-----------------//
+
+// demonstrate the use of an audio clip loaded from disk and a basic sine oscillator.
+struct ex_simple : public labsound_example
+{
+    virtual void play(int argc, char** argv) override final
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        auto musicClip = MakeBusFromSampleFile("samples/stereo-music-clip.wav", argc, argv);
+        if (!musicClip)
+            return;
+
+        std::shared_ptr<OscillatorNode> oscillator;
+        std::shared_ptr<SampledAudioNode> musicClipNode;
+        std::shared_ptr<GainNode> gain;
+
+        oscillator = std::make_shared<OscillatorNode>(ac);
+        gain = std::make_shared<GainNode>(ac);
+        gain->gain()->setValue(0.5f);
+
+        musicClipNode = std::make_shared<SampledAudioNode>(ac);
+        {
+            ContextRenderLock r(context.get(), "ex_simple");
+            musicClipNode->setBus(r, musicClip);
+        }
+        context->connect(Output(), musicClipNode, 0, 0);
+        musicClipNode->schedule(0.0);
+
+        // osc -> gain -> destination
+        context->connect(gain, oscillator, 0, 0);
+        context->connect(Output(), gain, 0, 0);
+
+        oscillator->frequency()->setValue(440.f);
+        oscillator->setType(OscillatorType::SINE);
+        oscillator->start(0.0f);
+
+        _nodes.push_back(oscillator);
+        _nodes.push_back(musicClipNode);
+        _nodes.push_back(gain);
+
+        Wait(std::chrono::seconds(6));
+    }
+};
+
+
+
+//------------------------//
+//    ex_test_resample    //
+//------------------------//
+
+// demonstrate the use of an audio clip loaded from disk and a basic sine oscillator.
+struct ex_test_resample : public labsound_example
+{
+    virtual void play(int argc, char** argv) override final
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        auto musicClip = MakeBusFromSampleFile("samples/sin440-22050.wav", argc, argv);
+        if (!musicClip)
+            return;
+
+        std::shared_ptr<OscillatorNode> oscillator;
+        std::shared_ptr<SampledAudioNode> musicClipNode;
+        std::shared_ptr<GainNode> gain;
+
+        oscillator = std::make_shared<OscillatorNode>(ac);
+        gain = std::make_shared<GainNode>(ac);
+        gain->gain()->setValue(0.5f);
+
+        musicClipNode = std::make_shared<SampledAudioNode>(ac);
+        {
+            ContextRenderLock r(context.get(), "ex_test_resample");
+            musicClipNode->setBus(r, musicClip);
+        }
+        context->connect(Output(), musicClipNode, 0, 0);
+
+        // osc -> gain -> destination
+        context->connect(gain, oscillator, 0, 0);
+        context->connect(Output(), gain, 0, 0);
+
+        oscillator->frequency()->setValue(440.f);
+        oscillator->setType(OscillatorType::SINE);
+
+        _nodes.push_back(oscillator);
+        _nodes.push_back(musicClipNode);
+        _nodes.push_back(gain);
+
+        oscillator->start(0.0f);
+        Wait(std::chrono::seconds(1));
+        oscillator->stop(0.0f);
+        Wait(std::chrono::milliseconds(500));
+        musicClipNode->schedule(0.0);
+        Wait(std::chrono::milliseconds(500));
+        musicClipNode->detune()->setValue(1000.f);
+        Wait(std::chrono::milliseconds(500));
+    }
+};
+
+
+
+
+//-----------------//
+//    ex_osc_pop   //
+//-----------------//
+
+// ex_osc_pop to test oscillator start/stop popping (it shouldn't pop). 
+struct ex_osc_pop : public labsound_example
+{
+    virtual void play(int argc, char** argv) override final
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        std::shared_ptr<OscillatorNode> oscillator;
+        std::shared_ptr<StreamingRecorderNode> recorder;
+        std::shared_ptr<GainNode> gain;
+        {
+            oscillator = std::make_shared<OscillatorNode>(ac);
+
+            gain = std::make_shared<GainNode>(ac);
+            gain->gain()->setValue(1);
+
+            // osc -> destination
+            context->connect(gain, oscillator, 0, 0);
+            context->connect(Output(), gain, 0, 0);
+
+            oscillator->frequency()->setValue(1000.f);
+            oscillator->setType(OscillatorType::SINE);
+
+            recorder = std::make_shared<StreamingRecorderNode>(ac, defaultAudioDeviceConfigurations.second.desired_channels);
+            recorder->setBlocking(_host->virtual_clock);
+            context->addAutomaticPullNode(recorder);
+            recorder->startRecording("ex_osc_pop.wav");
+            context->connect(recorder, gain, 0, 0);
+        }
+
+        // retain nodes until demo end
+        _nodes.push_back(oscillator);
+        _nodes.push_back(recorder);
+        _nodes.push_back(gain);
+
+        // queue up 5 1/2 second chirps
+        for (float i = 0; i < 5.f; i += 1.f)
+        {
+            oscillator->start(0);
+            oscillator->stop(0.5f);
+            Wait(std::chrono::milliseconds(1000));
+        }
+
+        context->removeAutomaticPullNode(recorder);
+        recorder->stopRecording();
+
+        // wait at least one context update to allow the disconnections to occur, and for any final
+        // render quantum to finish.
+        // @TODO the only safe and reasonable thing is to expose a "join" on the context that
+        // disconnects the destination node from its graph, then waits a quantum.
+
+        // @TODO the example app should have a set<shared_ptr<AudioNode>> so that the shared_ptrs
+        // are not released until the example is finished.
+
+        context->disconnect(Output());
+        Wait(std::chrono::milliseconds(100));
+    }
+};
+
+
+//////////////////////////////
+//    ex_playback_events    //
+//////////////////////////////
+
+// ex_playback_events showcases the use of a `setOnEnded` callback on a `SampledAudioNode`
+struct ex_playback_events : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        auto musicClip = MakeBusFromSampleFile("samples/mono-music-clip.wav", argc, argv);
+        if (!musicClip)
+            return;
+
+        auto sampledAudio = std::make_shared<SampledAudioNode>(ac);
+        {
+            ContextRenderLock r(context.get(), "ex_playback_events");
+            sampledAudio->setBus(r, musicClip);
+        }
+        context->connect(Output(), sampledAudio, 0, 0);
+
+        sampledAudio->setOnEnded([]() {
+            std::cout << "sampledAudio finished..." << std::endl;
+        });
+
+        sampledAudio->schedule(0.0);
+
+        Wait(std::chrono::seconds(6));
+    }
+};
+
+////////////////////////////////
+//    ex_offline_rendering    //
+////////////////////////////////
+
+// This sample illustrates how LabSound can be used "offline," where the graph is not
+// pulled by an actual audio device, but rather a null destination. This sample shows
+// how a `RecorderNode` can be used to capture the rendered audio to disk.
+struct ex_offline_rendering : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        AudioStreamConfig offlineConfig;
+        offlineConfig.device_index = 0;
+        offlineConfig.desired_samplerate = LABSOUND_DEFAULT_SAMPLERATE;
+        offlineConfig.desired_channels = LABSOUND_DEFAULT_CHANNELS;
+
+        const float recording_time_ms = 1000.f;
+
+        std::unique_ptr<lab::AudioContext> context = lab::MakeOfflineAudioContext(offlineConfig, recording_time_ms);
+        lab::AudioContext& ac = *context.get();
+
+        std::shared_ptr<OscillatorNode> oscillator;
+        std::shared_ptr<AudioBus> musicClip = MakeBusFromSampleFile("samples/stereo-music-clip.wav", argc, argv);
+        std::shared_ptr<SampledAudioNode> musicClipNode;
+        std::shared_ptr<GainNode> gain;
+
+        auto recorder = std::make_shared<RecorderNode>(ac, offlineConfig);
+
+        context->addAutomaticPullNode(recorder);
+
+        recorder->startRecording();
+
+        {
+            ContextRenderLock r(context.get(), "ex_offline_rendering");
+
+            gain = std::make_shared<GainNode>(ac);
+            gain->gain()->setValue(0.125f);
+
+            // osc -> gain -> recorder
+            oscillator = std::make_shared<OscillatorNode>(ac);
+            context->connect(gain, oscillator, 0, 0);
+            context->connect(recorder, gain, 0, 0);
+            oscillator->frequency()->setValue(880.f);
+            oscillator->setType(OscillatorType::SINE);
+            oscillator->start(0.0f);
+
+            musicClipNode = std::make_shared<SampledAudioNode>(ac);
+            context->connect(recorder, musicClipNode, 0, 0);
+            musicClipNode->setBus(r, musicClip);
+            musicClipNode->schedule(0.0);
+        }
+
+        auto on_complete = [&context, &recorder]() {
+            recorder->stopRecording();
+
+            printf("Recorded %f seconds of audio\n", recorder->recordedLengthInSeconds());
+
+            context->removeAutomaticPullNode(recorder);
+            recorder->writeRecordingToWav("ex_offline_rendering.wav", false);
+        };
+
+        // Offline rendering happens in a separate thread and blocks until complete.
+        // It needs to acquire the graph + render locks, so it must
+        // be outside the scope of where we make changes to the graph.
+        auto render = StartOfflineRender(ac, recording_time_ms, on_complete);
+        render->wait();
+    }
+};
+
+//////////////////////
+//    ex_tremolo    //
+//////////////////////
+
+// This demonstrates the use of `connectParam` as a way of modulating one node through another. 
+// Params are effectively control signals that operate at audio rate.
+struct ex_tremolo : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        std::shared_ptr<OscillatorNode> modulator;
+        std::shared_ptr<GainNode> modulatorGain;
+        std::shared_ptr<OscillatorNode> osc;
+        {
+            modulator = std::make_shared<OscillatorNode>(ac);
+            modulator->setType(OscillatorType::SINE);
+            modulator->frequency()->setValue(8.0f);
+            modulator->start(0);
+
+            modulatorGain = std::make_shared<GainNode>(ac);
+            modulatorGain->gain()->setValue(10);
+
+            osc = std::make_shared<OscillatorNode>(ac);
+            osc->setType(OscillatorType::TRIANGLE);
+            osc->frequency()->setValue(440);
+            osc->start(0);
+
+            // Set up processing chain
+            // modulator > modulatorGain ---> osc frequency
+            //                                osc > context
+            context->connect(modulatorGain, modulator, 0, 0);
+            context->connectParam(osc->detune(), modulatorGain, 0);
+            context->connect(Output(), osc, 0, 0);
+        }
+
+        Wait(std::chrono::seconds(5));
+    }
+};
+
+///////////////////////////////////
+//    ex_frequency_modulation    //
+///////////////////////////////////
+
+// This is inspired by a patch created in the ChucK audio programming language. It showcases
+// LabSound's ability to construct arbitrary graphs of oscillators a-la FM synthesis.
+struct ex_frequency_modulation : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        UniformRandomGenerator fmrng;
+
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        std::shared_ptr<OscillatorNode> modulator;
+        std::shared_ptr<GainNode> modulatorGain;
+        std::shared_ptr<OscillatorNode> osc;
+        std::shared_ptr<ADSRNode> trigger;
+
+        std::shared_ptr<GainNode> signalGain;
+        std::shared_ptr<GainNode> feedbackTap;
+        std::shared_ptr<DelayNode> chainDelay;
+
+        {
+            modulator = std::make_shared<OscillatorNode>(ac);
+            modulator->setType(OscillatorType::SQUARE);
+            modulator->start(0);
+
+            modulatorGain = std::make_shared<GainNode>(ac);
+
+            osc = std::make_shared<OscillatorNode>(ac);
+            osc->setType(OscillatorType::SQUARE);
+            osc->frequency()->setValue(300);
+            osc->start(0);
+
+            trigger = std::make_shared<ADSRNode>(ac);
+
+            signalGain = std::make_shared<GainNode>(ac);
+            signalGain->gain()->setValue(1.0f);
+
+            feedbackTap = std::make_shared<GainNode>(ac);
+            feedbackTap->gain()->setValue(0.5f);
+
+            chainDelay = std::make_shared<DelayNode>(ac, 4);
+            chainDelay->delayTime()->setFloat(0.0f);  // passthrough delay, not sure if this has the same DSP semantic as ChucK
+
+            // Set up FM processing chain:
+            context->connect(modulatorGain, modulator, 0, 0);  // Modulator to Gain
+            context->connectParam(osc->frequency(), modulatorGain, 0);  // Gain to frequency parameter
+            context->connect(trigger, osc, 0, 0);  // Osc to ADSR
+            context->connect(signalGain, trigger, 0, 0);  // ADSR to signalGain
+            context->connect(feedbackTap, signalGain, 0, 0);  // Signal to Feedback
+            context->connect(chainDelay, feedbackTap, 0, 0);  // Feedback to Delay
+            context->connect(signalGain, chainDelay, 0, 0);  // Delay to signalGain
+            context->connect(Output(), signalGain, 0, 0);  // signalGain to DAC
+        }
+
+        double now_in_ms = 0;
+        while (true)
+        {
+            const float carrier_freq = fmrng.random_float(80.f, 440.f);
+            osc->frequency()->setValue(carrier_freq);
+
+            const float mod_freq = fmrng.random_float(4.f, 512.f);
+            modulator->frequency()->setValue(mod_freq);
+
+            const float mod_gain = fmrng.random_float(16.f, 1024.f);
+            modulatorGain->gain()->setValue(mod_gain);
+
+            const float attack_length = fmrng.random_float(0.25f, 0.5f);
+            trigger->set(attack_length, 0.50f, 0.50f, 0.25f, 0.50f, 0.1f);
+            trigger->gate()->setValue(1.f);
+
+            const uint32_t delay_time_ms = 500;
+            now_in_ms += delay_time_ms;
+
+            std::cout << "[ex_frequency_modulation] car_freq: " << carrier_freq << std::endl;
+            std::cout << "[ex_frequency_modulation] mod_freq: " << mod_freq << std::endl;
+            std::cout << "[ex_frequency_modulation] mod_gain: " << mod_gain << std::endl;
+
+            Wait(std::chrono::milliseconds(delay_time_ms));
+
+            if (now_in_ms >= 10000) break;
+        };
+    }
+};
+
+///////////////////////////////////
+//    ex_runtime_graph_update    //
+///////////////////////////////////
+
+// In most examples, nodes are not disconnected during playback. This sample shows how nodes
+// can be arbitrarily connected/disconnected during runtime while the graph is live. 
+struct ex_runtime_graph_update : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        std::shared_ptr<OscillatorNode> oscillator1, oscillator2;
+        std::shared_ptr<GainNode> gain;
+
+        {
+            ExampleContext context;
+            const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+            context = MakeExampleContext(defaultAudioDeviceConfigurations);
+            lab::AudioContext& ac = *context.get();
+
+            {
+                oscillator1 = std::make_shared<OscillatorNode>(ac);
+                oscillator2 = std::make_shared<OscillatorNode>(ac);
+
+                gain = std::make_shared<GainNode>(ac);
+                gain->gain()->setValue(0.50);
+
+                // osc -> gain -> destination
+                context->connect(gain, oscillator1, 0, 0);
+                context->connect(gain, oscillator2, 0, 0);
+                context->connect(Output(), gain, 0, 0);
+
+                oscillator1->setType(OscillatorType::SINE);
+                oscillator1->frequency()->setValue(220.f);
+                oscillator1->start(0.00f);
+
+                oscillator2->setType(OscillatorType::SINE);
+                oscillator2->frequency()->setValue(440.f);
+                oscillator2->start(0.00);
+            }
+
+            _nodes.push_back(oscillator1);
+            _nodes.push_back(oscillator2);
+            _nodes.push_back(gain);
+
+            // each swap is committed as one transaction, so there is no quantum in which
+            // both oscillators, or neither, are connected
+            GraphTransaction swap(ac);
+            for (int i = 0; i < 4; ++i)
+            {
+                Commit(swap.disconnect(oscillator1).connect(gain, oscillator2, 0, 0));
+                Wait(std::chrono::milliseconds(200));
+
+                Commit(swap.disconnect(oscillator2).connect(gain, oscillator1, 0, 0));
+                Wait(std::chrono::milliseconds(200));
+            }
+
+            Commit(swap.disconnect(oscillator1).disconnect(oscillator2));
+        }
+
+        std::cout << "OscillatorNode 1 use_count: " << oscillator1.use_count() << std::endl;
+        std::cout << "OscillatorNode 2 use_count: " << oscillator2.use_count() << std::endl;
+        std::cout << "GainNode use_count:         " << gain.use_count() << std::endl;
+    }
+};
+
+//////////////////////////////////
+//    ex_microphone_loopback    //
+//////////////////////////////////
+
+// This example simply connects an input device (e.g. a microphone) to the output audio device (e.g. your speakers). 
+// DANGER! This sample creates an open feedback loop. It is best used when the output audio device is a pair of headphones. 
+struct ex_microphone_loopback : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration(true);
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+
+        std::shared_ptr<AudioHardwareInputNode> input;
+        {
+            ContextRenderLock r(context.get(), "ex_microphone_loopback");
+            input = lab::MakeAudioHardwareInputNode(r);
+            context->connect(Output(), input, 0, 0);
+        }
+
+        Wait(std::chrono::seconds(10));
+    }
+};
+
+////////////////////////////////
+//    ex_microphone_reverb    //
+////////////////////////////////
+
+// This sample takes input from a microphone and convolves it with an impulse response to create reverb (i.e. use of the `ConvolverNode`).
+// The sample convolution is for a rather large room, so there is a delay.
+// DANGER! This sample creates an open feedback loop. It is best used when the output audio device is a pair of headphones. 
+struct ex_microphone_reverb : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration(true);
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        {
+            // the response is prepared once, and mapped from the cache on later runs
+            std::shared_ptr<const ConvolutionImpulse> impulseResponse = ImpulseCache().get(SampleFilePath("impulse/cardiod-rear-levelled.wav", argc, argv), ac.sampleRate());
+            std::shared_ptr<AudioHardwareInputNode> input;
+            std::shared_ptr<GainNode> wetGain;
+            std::shared_ptr<StreamingRecorderNode> recorder;
+
+            // the tail of the response is convolved on background threads, so the live
+            // input is reverberated without added latency
+            std::shared_ptr<PartitionedConvolverNode> convolve = std::make_shared<PartitionedConvolverNode>(ac);
+            convolve->setImpulse(impulseResponse);
+
+            {
+                ContextRenderLock r(context.get(), "ex_microphone_reverb");
+
+                input = lab::MakeAudioHardwareInputNode(r);
+
+                recorder = std::make_shared<StreamingRecorderNode>(ac, defaultAudioDeviceConfigurations.second.desired_channels);
+                recorder->setBlocking(_host->virtual_clock);
+                context->addAutomaticPullNode(recorder);
+                recorder->startRecording("ex_microphone_reverb.wav", true);
+
+                wetGain = std::make_shared<GainNode>(ac);
+                wetGain->gain()->setValue(0.6f);
+
+                context->connect(convolve, input, 0, 0);
+                context->connect(wetGain, convolve, 0, 0);
+                context->connect(Output(), wetGain, 0, 0);
+                context->connect(recorder, wetGain, 0, 0);
+            }
+
+            Wait(std::chrono::seconds(10));
+
+            context->removeAutomaticPullNode(recorder);
+            recorder->stopRecording();
+
+            context.reset();
+        }
+    }
+};
+
+//////////////////////////////
+//    ex_peak_compressor    //
+//////////////////////////////
+
+// Demonstrates the use of the `PeakCompNode` and many scheduled audio sources.
+struct ex_peak_compressor : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        std::shared_ptr<AudioBus> kick = MakeBusFromSampleFile("samples/kick.wav", argc, argv);
+        std::shared_ptr<AudioBus> hihat = MakeBusFromSampleFile("samples/hihat.wav", argc, argv);
+        std::shared_ptr<AudioBus> snare = MakeBusFromSampleFile("samples/snare.wav", argc, argv);
+
+        std::shared_ptr<SampledAudioNode> kick_node = std::make_shared<SampledAudioNode>(ac);
+        std::shared_ptr<SampledAudioNode> hihat_node = std::make_shared<SampledAudioNode>(ac);
+        std::shared_ptr<SampledAudioNode> snare_node = std::make_shared<SampledAudioNode>(ac);
+
+        std::shared_ptr<BiquadFilterNode> filter;
+        std::shared_ptr<PeakCompNode> peakComp;
+
+        {
+            ContextRenderLock r(context.get(), "ex_peak_compressor");
+
+            filter = std::make_shared<BiquadFilterNode>(ac);
+            filter->setType(lab::FilterType::LOWPASS);
+            filter->frequency()->setValue(1800.f);
+
+            peakComp = std::make_shared<PeakCompNode>(ac);
+            context->connect(peakComp, filter, 0, 0);
+            context->connect(Output(), peakComp, 0, 0);
+
+            kick_node->setBus(r, kick);
+            context->connect(filter, kick_node, 0, 0);
+
+            hihat_node->setBus(r, hihat);
+            context->connect(filter, hihat_node, 0, 0);
+            //hihat_node->gain()->setValue(0.2f);
+
+            snare_node->setBus(r, snare);
+            context->connect(filter, snare_node, 0, 0);
+
+            _nodes.push_back(kick_node);
+            _nodes.push_back(hihat_node);
+            _nodes.push_back(snare_node);
+            _nodes.push_back(peakComp);
+            _nodes.push_back(filter);
+        }
+
+        // Speed Metal
+        float startTime = 0.1f;
+        float bpm = 30.f;
+        float bar_length = 60.f / bpm;
+        float eighthNoteTime = bar_length / 8.0f;
+        for (float bar = 0; bar < 8; bar += 1)
+        {
+            float time = startTime + bar * bar_length;
+
+            kick_node->schedule(time);
+            kick_node->schedule(time + 4 * eighthNoteTime);
+
+            snare_node->schedule(time + 2 * eighthNoteTime);
+            snare_node->schedule(time + 6 * eighthNoteTime);
+                
+            float hihat_beat = 8;
+            for (float i = 0; i < hihat_beat; i += 1)
+                hihat_node->schedule(time + bar_length * i / hihat_beat);
+        }
+
+        Wait(std::chrono::seconds(10));
+    }
+};
+
+/////////////////////////////
+//    ex_stereo_panning    //
+/////////////////////////////
+
+// This illustrates the use of equal-power stereo panning.
+struct ex_stereo_panning : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        // the clip is streamed from disk, rather than decoded up front
+        std::shared_ptr<StreamingFileNode> audioClipNode = std::make_shared<StreamingFileNode>(ac);
+        const std::string path = SampleFilePath("samples/trainrolling.wav", argc, argv);
+        audioClipNode->setLoop(true);
+        if (!audioClipNode->open(path)) throw std::runtime_error("couldn't open " + path);
+        auto stereoPanner = std::make_shared<StereoPannerNode>(ac);
+
+        // the control thread's pan changes are applied on the render thread, on the sample
+        // they were sent for
+        auto controls = std::make_shared<ParamQueueNode>(ac);
+        const int pan = controls->addParam(stereoPanner->pan());
+
+        {
+            ContextRenderLock r(context.get(), "ex_stereo_panning");
+
+            context->connect(stereoPanner, audioClipNode, 0, 0);
+            audioClipNode->start(0.f);
+
+            context->connect(controls, stereoPanner, 0, 0);
+            context->connect(Output(), controls, 0, 0);
+        }
+
+        if (audioClipNode)
+        {
+            _nodes.push_back(audioClipNode);
+            _nodes.push_back(stereoPanner);
+            _nodes.push_back(controls);
+
+            const int seconds = 8;
+
+            auto sweep = [this, &controls, pan, seconds]() {
+                float halfTime = seconds * 0.5f;
+                for (float i = 0; i < seconds; i += 0.01f)
+                {
+                    float x = (i - halfTime) / halfTime;
+                    controls->setValue(pan, x);
+                    Wait(std::chrono::milliseconds(10));
+                }
+            };
+
+            if (_host->virtual_clock)
+            {
+                // rendered time can only be advanced from one thread
+                sweep();
+            }
+            else
+            {
+                std::thread controlThreadTest(sweep);
+
+                Wait(std::chrono::seconds(seconds));
+
+                controlThreadTest.join();
+            }
+        }
+        else
+        {
+            std::cerr << "Couldn't initialize train node to play" << std::endl;
+        }
+    }
+};
+
+//////////////////////////////////
+//    ex_hrtf_spatialization    //
+//////////////////////////////////
+
+// This illustrates 3d sound spatialization. Headphones are recommended for this sample.
+struct ex_hrtf_spatialization : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        std::shared_ptr<StreamingFileNode> audioClipNode = std::make_shared<StreamingFileNode>(ac);
+        const std::string path = SampleFilePath("samples/trainrolling.wav", argc, argv);
+        audioClipNode->setLoop(true);
+        if (!audioClipNode->open(path)) throw std::runtime_error("couldn't open " + path);
+        std::cout << "Sample Rate is: " << context->sampleRate() << std::endl;
+
+        // the compiled hrtf database, compiled into the user's cache the first time it's
+        // used at this rate
+        auto spatializer = std::make_shared<HrtfSpatializerNode>(ac, HrtfDatabase::load(SampleFilePath("hrtf", argc, argv), ac.sampleRate()), 1);
+
+        // Put position a +up && +front, because if it goes right through the
+        // listener at (0, 0, 0) it abruptly switches from left to right.
+        spatializer->setPosition(0, -1.f, 0.1f, 0.1f);
+
+        {
+            ContextRenderLock r(context.get(), "ex_hrtf_spatialization");
+
+            context->connect(Output(), spatializer, 0, 0);
+            context->connect(spatializer, audioClipNode, 0, 0);
+            audioClipNode->start(0.f);
+        }
+
+        if (audioClipNode)
+        {
+            _nodes.push_back(audioClipNode);
+            _nodes.push_back(spatializer);
+
+            // positions are relative to the listener, and are smoothed by the spatializer
+            const int seconds = 10;
+            float halfTime = seconds * 0.5f;
+            for (float i = 0; i < seconds; i += 0.01f)
+            {
+                float x = (i - halfTime) / halfTime;
+                spatializer->setPosition(0, x, 0.1f, 0.1f);
+
+                Wait(std::chrono::milliseconds(10));
+            }
+        }
+        else
+        {
+            std::cerr << "Couldn't initialize train node to play" << std::endl;
+        }
+    }
+};
+
+////////////////////////////////
+//    ex_convolution_reverb    //
+////////////////////////////////
+
+// This shows the use of the `ConvolverNode` to produce reverb from an arbitrary impulse response.
+struct ex_convolution_reverb : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        const std::string impulsePath = SampleFilePath("impulse/cardiod-rear-levelled.wav", argc, argv);
+        std::shared_ptr<const ConvolutionImpulse> impulseResponse = ImpulseCache().get(impulsePath, ac.sampleRate());
+        if (!impulseResponse) throw std::runtime_error("couldn't open " + impulsePath);
+
+        std::shared_ptr<AudioBus> voiceClip = MakeBusFromSampleFile("samples/voice.ogg", argc, argv);
+
+        std::shared_ptr<GainNode> wetGain;
+        std::shared_ptr<GainNode> dryGain;
+        std::shared_ptr<SampledAudioNode> voiceNode;
+        std::shared_ptr<GainNode> outputGain = std::make_shared<GainNode>(ac);
+
+        // the tail of the response is convolved on background threads
+        std::shared_ptr<PartitionedConvolverNode> convolve = std::make_shared<PartitionedConvolverNode>(ac);
+        convolve->setImpulse(impulseResponse);
+
+        {
+            // voice --+-> dry -------------------+
+            //         |                          |
+            //         +---> convolve ---> wet ---+--->out ---> device
+
+            ContextRenderLock r(context.get(), "ex_convolution_reverb");
+
+            wetGain = std::make_shared<GainNode>(ac);
+            wetGain->gain()->setValue(0.5f);
+            dryGain = std::make_shared<GainNode>(ac);
+            dryGain->gain()->setValue(0.1f);
+
+            context->connect(wetGain, convolve, 0, 0);
+            context->connect(outputGain, wetGain, 0, 0);
+            context->connect(outputGain, dryGain, 0, 0);
+            context->connect(convolve, dryGain, 0, 0);
+
+            outputGain->gain()->setValue(0.5f);
+
+            voiceNode = std::make_shared<SampledAudioNode>(ac);
+            voiceNode->setBus(r, voiceClip);
+            context->connect(dryGain, voiceNode, 0, 0);
+
+            voiceNode->schedule(0.0);
+
+            context->connect(Output(), outputGain, 0, 0);
+        }
+
+        _nodes.push_back(convolve);
+        _nodes.push_back(wetGain);
+        _nodes.push_back(dryGain);
+        _nodes.push_back(voiceNode);
+        _nodes.push_back(outputGain);
+
+        Wait(std::chrono::seconds(20));
+    }
+};
+
+///////////////////
+//    ex_misc    //
+///////////////////
+
+// An example with a several of nodes to verify api + functionality changes/improvements/regressions
+struct ex_misc : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        std::array<int, 8> majorScale = {0, 2, 4, 5, 7, 9, 11, 12};
+        std::array<int, 8> naturalMinorScale = {0, 2, 3, 5, 7, 9, 11, 12};
+        std::array<int, 6> pentatonicMajor = {0, 2, 4, 7, 9, 12};
+        std::array<int, 8> pentatonicMinor = {0, 3, 5, 7, 10, 12};
+        std::array<int, 8> delayTimes = {266, 533, 399};
+
+        auto randomFloat = std::uniform_real_distribution<float>(0, 1);
+        auto randomScaleDegree = std::uniform_int_distribution<int>(0, int(pentatonicMajor.size()) - 1);
+        auto randomTimeIndex = std::uniform_int_distribution<int>(0, static_cast<int>(delayTimes.size()) - 1);
+
+        std::shared_ptr<AudioBus> audioClip = MakeBusFromSampleFile("samples/cello_pluck/cello_pluck_As0.wav", argc, argv);
+        std::shared_ptr<SampledAudioNode> audioClipNode = std::make_shared<SampledAudioNode>(ac);
+        std::shared_ptr<PingPongDelayNode> pingping = std::make_shared<PingPongDelayNode>(ac, 240.0f);
+
+        {
+            ContextRenderLock r(context.get(), "ex_misc");
+
+            pingping->BuildSubgraph(*context.get());
+            pingping->SetFeedback(.75f);
+            pingping->SetDelayIndex(lab::TempoSync::TS_16);
+
+            context->connect(Output(), pingping->output, 0, 0);
+
+            audioClipNode->setBus(r, audioClip);
+
+            context->connect(pingping->input, audioClipNode, 0, 0);
+
+            audioClipNode->schedule(0.25);
+        }
+
+        _nodes.push_back(audioClipNode);
+        //_nodes.push_back(pingping);
+
+        Wait(std::chrono::seconds(10));
+    }
+};
+
+///////////////////////////
+//    ex_dalek_filter    //
+///////////////////////////
+
+// Send live audio to a Dalek filter, constructed according to the recipe at http://webaudio.prototyping.bbc.co.uk/ring-modulator/.
+// This is used as an example of a complex graph constructed using the LabSound API.
+struct ex_dalek_filter : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        // Live input from the microphone, or the voice clip when USE_LIVE isn't defined, or
+        // against the virtual clock, where there's no input device to record from.
+#ifdef USE_LIVE
+        const bool live = !_host->virtual_clock;
+#else
+        const bool live = false;
+#endif
+
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration(live);
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        // ogg can't be read in place, so the first run decodes it to a sidecar that is
+        // streamed from then on
+        std::shared_ptr<StreamingFileNode> audioClipNode;
+        if (!live)
+        {
+            audioClipNode = std::make_shared<StreamingFileNode>(ac, 1);
+            audioClipNode->setLoop(true);
+            const std::string path = SampleFilePath("samples/voice.ogg", argc, argv);
+            if (!audioClipNode->open(path)) throw std::runtime_error("couldn't open " + path);
+        }
+
+        std::shared_ptr<AudioHardwareInputNode> input;
+
+        std::shared_ptr<OscillatorNode> vIn;
+        std::shared_ptr<GainNode> vInGain;
+        std::shared_ptr<GainNode> vInInverter1;
+        std::shared_ptr<GainNode> vInInverter2;
+        std::shared_ptr<GainNode> vInInverter3;
+        std::shared_ptr<DiodeNode> vInDiode1;
+        std::shared_ptr<DiodeNode> vInDiode2;
+        std::shared_ptr<GainNode> vcInverter1;
+        std::shared_ptr<DiodeNode> vcDiode3;
+        std::shared_ptr<DiodeNode> vcDiode4;
+        std::shared_ptr<GainNode> outGain;
+        std::shared_ptr<DynamicsCompressorNode> compressor;
+
+        // pipeline stages must be destroyed before the context, so they aren't retained in _nodes
+        std::shared_ptr<PipelineStageNode> modulatorStage;
+        std::shared_ptr<PipelineStageNode> compressorStage;
+
+        {
+            ContextRenderLock r(context.get(), "ex_dalek_filter");
+
+            vIn = std::make_shared<OscillatorNode>(ac);
+            vIn->frequency()->setValue(30.0f);
+            vIn->start(0.f);
+
+            vInGain = std::make_shared<GainNode>(ac);
+            vInGain->gain()->setValue(0.5f);
+
+            // GainNodes can take negative gain which represents phase inversion
+            vInInverter1 = std::make_shared<GainNode>(ac);
+            vInInverter1->gain()->setValue(-1.0f);
+            vInInverter2 = std::make_shared<GainNode>(ac);
+            vInInverter2->gain()->setValue(-1.0f);
+
+            vInDiode1 = std::make_shared<DiodeNode>(ac);
+            vInDiode2 = std::make_shared<DiodeNode>(ac);
+
+            vInInverter3 = std::make_shared<GainNode>(ac);
+            vInInverter3->gain()->setValue(-1.0f);
+
+            // Now we create the objects on the Vc side of the graph
+            vcInverter1 = std::make_shared<GainNode>(ac);
+            vcInverter1->gain()->setValue(-1.0f);
+
+            vcDiode3 = std::make_shared<DiodeNode>(ac);
+            vcDiode4 = std::make_shared<DiodeNode>(ac);
+
+            // A gain node to control master output levels
+            outGain = std::make_shared<GainNode>(ac);
+            outGain->gain()->setValue(1.0f);
+
+            // A small addition to the graph given in Parker's paper is a compressor node
+            // immediately before the output. This ensures that the user's volume remains
+            // somewhat constant when the distortion is increased.
+            compressor = std::make_shared<DynamicsCompressorNode>(ac);
+            compressor->threshold()->setValue(-14.0f);
+
+            // Now we connect up the graph following the block diagram above (on the web page).
+            // When working on complex graphs it helps to have a pen and paper handy!
+
+            if (live)
+            {
+                input = lab::MakeAudioHardwareInputNode(r);
+                context->connect(vcInverter1, input, 0, 0);
+                context->connect(vcDiode4, input, 0, 0);
+            }
+            else
+            {
+                context->connect(vcInverter1, audioClipNode, 0, 0);
+                context->connect(vcDiode4, audioClipNode, 0, 0);
+                audioClipNode->start(0.f);
+            }
+
+            context->connect(vcDiode3, vcInverter1, 0, 0);
+
+            // Then the Vin side
+            context->connect(vInGain, vIn, 0, 0);
+            context->connect(vInInverter1, vInGain, 0, 0);
+            context->connect(vcInverter1, vInGain, 0, 0);
+            context->connect(vcDiode4, vInGain, 0, 0);
+
+            context->connect(vInInverter2, vInInverter1, 0, 0);
+            context->connect(vInDiode2, vInInverter1, 0, 0);
+            context->connect(vInDiode1, vInInverter2, 0, 0);
+
+            // Finally connect the four diodes to the destination via the output-stage compressor and master gain node
+            context->connect(vInInverter3, vInDiode1, 0, 0);
+            context->connect(vInInverter3, vInDiode2, 0, 0);
+
+            if (_host->pipeline)
+            {
+                // the ring modulator, the compressor and the output gain each render on their own thread
+                modulatorStage = std::make_shared<PipelineStageNode>(ac);
+                compressorStage = std::make_shared<PipelineStageNode>(ac);
+
+                context->connect(modulatorStage, vInInverter3, 0, 0);
+                context->connect(modulatorStage, vcDiode3, 0, 0);
+                context->connect(modulatorStage, vcDiode4, 0, 0);
+                context->connect(compressor, modulatorStage, 0, 0);
+                context->connect(compressorStage, compressor, 0, 0);
+                context->connect(outGain, compressorStage, 0, 0);
+                _result.latency = 2.0 * PipelineStageNode::latencyFrames() / ac.sampleRate();
+            }
+            else
+            {
+                context->connect(compressor, vInInverter3, 0, 0);
+                context->connect(compressor, vcDiode3, 0, 0);
+                context->connect(compressor, vcDiode4, 0, 0);
+                context->connect(outGain, compressor, 0, 0);
+            }
+
+            context->connect(Output(), outGain, 0, 0);
+        }
+
+        if (input)
+            _nodes.push_back(input);
+        if (audioClipNode)
+            _nodes.push_back(audioClipNode);
+        _nodes.push_back(vIn);
+        _nodes.push_back(vInGain);
+        _nodes.push_back(vInInverter1);
+        _nodes.push_back(vInInverter2);
+        _nodes.push_back(vInInverter3);
+        _nodes.push_back(vInDiode1);
+        _nodes.push_back(vInDiode2);
+        _nodes.push_back(vcDiode3);
+        _nodes.push_back(vcDiode4);
+        _nodes.push_back(vcInverter1);
+        _nodes.push_back(outGain);
+        _nodes.push_back(compressor);
+
+        Wait(std::chrono::seconds(30));
+    }
+};
+
+/////////////////////////////////
+//    ex_redalert_synthesis    //
+/////////////////////////////////
+
+// This is another example of a non-trival graph constructed with the LabSound API. Furthermore, it incorporates
+// the use of several `KernelNodes`, which implement complex DSP as inlined kernels without modifying
+// LabSound internals directly.
+struct ex_redalert_synthesis : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        std::shared_ptr<KernelNode<RedAlertSweep, 1>> sweep;
+        std::shared_ptr<KernelNode<RedAlertGate, 1>> outputGainFunction;
+
+        std::shared_ptr<OscillatorNode> osc;
+        std::shared_ptr<GainNode> oscGain;
+        std::shared_ptr<OscillatorNode> resonator;
+        std::shared_ptr<GainNode> resonatorGain;
+        std::shared_ptr<GainNode> resonanceSum;
+
+        std::shared_ptr<DelayNode> delay[5];
+
+        std::shared_ptr<GainNode> delaySum;
+        std::shared_ptr<GainNode> filterSum;
+
+        std::shared_ptr<BiquadFilterNode> filter[5];
+
+        {
+            ContextRenderLock r(context.get(), "ex_redalert_synthesis");
+
+            sweep = std::make_shared<KernelNode<RedAlertSweep, 1>>(ac);
+
+            sweep->start(0);
+
+            outputGainFunction = std::make_shared<KernelNode<RedAlertGate, 1>>(ac);
+
+            outputGainFunction->start(0);
+
+            osc = std::make_shared<OscillatorNode>(ac);
+            osc->setType(OscillatorType::SAWTOOTH);
+            osc->frequency()->setValue(220);
+            osc->start(0);
+            oscGain = std::make_shared<GainNode>(ac);
+            oscGain->gain()->setValue(0.5f);
+
+            resonator = std::make_shared<OscillatorNode>(ac);
+            resonator->setType(OscillatorType::SINE);
+            resonator->frequency()->setValue(220);
+            resonator->start(0);
+
+            resonatorGain = std::make_shared<GainNode>(ac);
+            resonatorGain->gain()->setValue(0.0f);
+
+            resonanceSum = std::make_shared<GainNode>(ac);
+            resonanceSum->gain()->setValue(0.5f);
+
+            // sweep drives oscillator frequency
+            context->connectParam(osc->frequency(), sweep, 0);
+
+            // oscillator drives resonator frequency
+            context->connectParam(resonator->frequency(), osc, 0);
+
+            // osc --> oscGain -------------+
+            // resonator -> resonatorGain --+--> resonanceSum
+            context->connect(oscGain, osc, 0, 0);
+            context->connect(resonanceSum, oscGain, 0, 0);
+            context->connect(resonatorGain, resonator, 0, 0);
+            context->connect(resonanceSum, resonatorGain, 0, 0);
+
+            delaySum = std::make_shared<GainNode>(ac);
+            delaySum->gain()->setValue(0.2f);
+
+            // resonanceSum --+--> delay0 --+
+            //                +--> delay1 --+
+            //                + ...    .. --+
+            //                +--> delay4 --+---> delaySum
+            float delays[5] = {0.015f, 0.022f, 0.035f, 0.024f, 0.011f};
+            for (int i = 0; i < 5; ++i)
+            {
+                delay[i] = std::make_shared<DelayNode>(ac, 0.04f);
+                delay[i]->delayTime()->setFloat(delays[i]);
+                context->connect(delay[i], resonanceSum, 0, 0);
+                context->connect(delaySum, delay[i], 0, 0);
+            }
+
+            filterSum = std::make_shared<GainNode>(ac);
+            filterSum->gain()->setValue(0.2f);
+
+            // delaySum --+--> filter0 --+
+            //            +--> filter1 --+
+            //            +--> filter2 --+
+            //            +--> filter3 --+
+            //            +--------------+----> filterSum
+            //
+            context->connect(filterSum, delaySum, 0, 0);
+
+            float centerFrequencies[4] = {740.f, 1400.f, 1500.f, 1600.f};
+            for (int i = 0; i < 4; ++i)
+            {
+                filter[i] = std::make_shared<BiquadFilterNode>(ac);
+                filter[i]->frequency()->setValue(centerFrequencies[i]);
+                filter[i]->q()->setValue(12.f);
+                context->connect(filter[i], delaySum, 0, 0);
+                context->connect(filterSum, filter[i], 0, 0);
+            }
+
+            // filterSum --> destination
+            context->connectParam(filterSum->gain(), outputGainFunction, 0);
+            context->connect(Output(), filterSum, 0, 0);
+        }
+
+        _nodes.push_back(sweep);
+        _nodes.push_back(outputGainFunction);
+        _nodes.push_back(osc);
+        _nodes.push_back(oscGain);
+        _nodes.push_back(resonator);
+        _nodes.push_back(resonatorGain);
+        _nodes.push_back(resonanceSum);
+        _nodes.push_back(delaySum);
+        _nodes.push_back(filterSum);
+        for (int i = 0; i < 5; ++i) _nodes.push_back(delay[i]);
+        for (int i = 0; i < 5; ++i) _nodes.push_back(filter[i]);
+
+        Wait(std::chrono::seconds(10));
+    }
+};
+
+//////////////////////////
+//    ex_wavepot_dsp    //
+//////////////////////////
+
+// "Unexpected Token" from Wavepot. Original by Stagas: http://wavepot.com/stagas/unexpected-token (MIT License)
+// Wavepot is effectively ShaderToy but for the WebAudio API. 
+// This sample shows the utility of LabSound as an experimental playground for DSP (synthesis + processing), with the groove box rendered by a `KernelNode`.
+struct ex_wavepot_dsp : public labsound_example
+{
+    virtual void play(int argc, char ** argv) override
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        std::shared_ptr<KernelNode<WavepotGrooveBox, 2>> grooveBox;
+        std::shared_ptr<ADSRNode> envelope;
+
+        float songLenSeconds = 12.0f;
+        {
+            envelope = std::make_shared<ADSRNode>(ac);
+            envelope->set(6.0f, 0.75f, 0.125, 14.0f, 0.0f, songLenSeconds);
+
+            grooveBox = std::make_shared<KernelNode<WavepotGrooveBox, 2>>(ac);
+            grooveBox->start(0);
+            envelope->gate()->setValue(1.f);
+
+            context->connect(envelope, grooveBox, 0, 0);
+            context->connect(Output(), envelope, 0, 0);
+        }
+
+        _nodes.push_back(grooveBox);
+        _nodes.push_back(envelope);
+
+        Wait(std::chrono::seconds(1 + (int) songLenSeconds));
+        context.reset();
+    }
+};
+
+///////////////////////////////
+//    ex_granulation_node    //
+///////////////////////////////
+
+struct ex_granulation_node : public labsound_example
+{
+    virtual void play(int argc, char** argv) override final
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        auto grain_source = MakeBusFromSampleFile("samples/voice.ogg", argc, argv);
+        if (!grain_source) return;
+
+        std::shared_ptr<GranulationNode> granulation_node = std::make_shared<GranulationNode>(ac);
+        std::shared_ptr<GainNode> gain = std::make_shared<GainNode>(ac);
+        std::shared_ptr<PipelineStageNode> stage;   // destroyed before the context, so not retained in _nodes
+        std::shared_ptr<StreamingRecorderNode> recorder;
+        gain->gain()->setValue(0.75f);
+
+        {
+            ContextRenderLock r(context.get(), "ex_granulation_node");
+            recorder = std::make_shared<StreamingRecorderNode>(ac, defaultAudioDeviceConfigurations.second.desired_channels);
+            recorder->setBlocking(_host->virtual_clock);
+            context->addAutomaticPullNode(recorder);
+            recorder->startRecording("ex_granulation_node.wav");
+
+            granulation_node->setGrainSource(r, grain_source);
+        }
+
+        if (_host->pipeline)
+        {
+            // the grains are rendered on a thread of their own
+            stage = std::make_shared<PipelineStageNode>(ac);
+            context->connect(stage, granulation_node, 0, 0);
+            context->connect(gain, stage, 0, 0);
+            _result.latency = static_cast<double>(PipelineStageNode::latencyFrames()) / ac.sampleRate();
+        }
+        else
+            context->connect(gain, granulation_node, 0, 0);
+
+        context->connect(Output(), gain, 0, 0);
+        context->connect(recorder, gain, 0, 0);
+
+        granulation_node->start(0.0f);
+
+        _nodes.push_back(granulation_node);
+        _nodes.push_back(gain);
+        _nodes.push_back(recorder);
+
+        Wait(std::chrono::seconds(10));
+
+        context->removeAutomaticPullNode(recorder);
+        recorder->stopRecording();
+    }
+};
+
+////////////////////////
+//    ex_poly_blep    //
+////////////////////////
+
+struct ex_poly_blep : public labsound_example
+{
+    virtual void play(int argc, char** argv) override final
+    {
+        ExampleContext context;
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration();
+        context = MakeExampleContext(defaultAudioDeviceConfigurations);
+        lab::AudioContext& ac = *context.get();
+
+        std::shared_ptr<PolyBLEPNode> polyBlep = std::make_shared<PolyBLEPNode>(ac);
+        std::shared_ptr<GainNode> gain = std::make_shared<GainNode>(ac);
+
+        gain->gain()->setValue(1.0f);
+        context->connect(gain, polyBlep, 0, 0);
+        context->connect(Output(), gain, 0, 0);
+
+        polyBlep->frequency()->setValue(220.f);
+        polyBlep->setType(PolyBLEPType::TRIANGLE);
+        polyBlep->start(0.0f);
+
+        std::vector<PolyBLEPType> blepWaveforms = 
+        {
+            PolyBLEPType::TRIANGLE,
+            PolyBLEPType::SQUARE,
+            PolyBLEPType::RECTANGLE,
+            PolyBLEPType::SAWTOOTH,
+            PolyBLEPType::RAMP,
+            PolyBLEPType::MODIFIED_TRIANGLE,
+            PolyBLEPType::MODIFIED_SQUARE,
+            PolyBLEPType::HALF_WAVE_RECTIFIED_SINE,
+            PolyBLEPType::FULL_WAVE_RECTIFIED_SINE,
+            PolyBLEPType::TRIANGULAR_PULSE,
+            PolyBLEPType::TRAPEZOID_FIXED,
+            PolyBLEPType::TRAPEZOID_VARIABLE
+        };
+
+        _nodes.push_back(polyBlep);
+        _nodes.push_back(gain);
+
+        double now_in_ms = 0;
+        int waveformIndex = 0;
+        while (true)
+        {
+            const uint32_t delay_time_ms = 500;
+            now_in_ms += delay_time_ms;
+
+            auto waveform = blepWaveforms[waveformIndex % blepWaveforms.size()];
+            polyBlep->setType(waveform);
+
+            Wait(std::chrono::milliseconds(delay_time_ms));
+
+            waveformIndex++;
+            if (now_in_ms >= 10000) break;
+        };
+    }
+};
+
+namespace
+{
+    // The examples are too large to instantiate all at once on the stack on small machines,
+    // so each play makes a fresh one on the heap.
+    template <typename T>
+    ExampleResult Play(ExampleHost const& host, int argc, char** argv)
+    {
+        std::unique_ptr<T> example(new T);
+        example->_host = &host;
+        example->play(argc, argv);
+        return example->_result;
+    }
+}
+
+std::vector<DemoExample> const& DemoExamples()
+{
+    static const std::vector<DemoExample> examples = {
+        { "simple", Play<ex_simple>, true },
+        { "test_resample", Play<ex_test_resample>, true },
+        { "osc_pop", Play<ex_osc_pop>, true },
+        { "playback_events", Play<ex_playback_events>, true },
+        { "offline_rendering", Play<ex_offline_rendering>, false },
+        { "tremolo", Play<ex_tremolo>, true },
+        { "frequency_modulation", Play<ex_frequency_modulation>, true },
+        { "runtime_graph_update", Play<ex_runtime_graph_update>, true },
+        { "microphone_loopback", Play<ex_microphone_loopback>, false },
+        { "microphone_reverb", Play<ex_microphone_reverb>, false },
+        { "peak_compressor", Play<ex_peak_compressor>, true },
+        { "stereo_panning", Play<ex_stereo_panning>, true },
+        { "hrtf_spatialization", Play<ex_hrtf_spatialization>, true },
+        { "convolution_reverb", Play<ex_convolution_reverb>, true },
+        { "misc", Play<ex_misc>, true },
+        { "dalek_filter", Play<ex_dalek_filter>, true },
+        { "redalert_synthesis", Play<ex_redalert_synthesis>, true },
+        { "wavepot_dsp", Play<ex_wavepot_dsp>, true },
+        { "granulation", Play<ex_granulation_node>, true },
+        { "poly_blep", Play<ex_poly_blep>, true },
+    };
+    return examples;
+}
+
+DemoExample const* FindDemoExample(const std::string& name)
+{
+    for (auto& e : DemoExamples())
+        if (name == e.name)
+            return &e;
+    return nullptr;
+}
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_DEMOEXAMPLES_H
+#define LABSOUNDDEMO_DEMOEXAMPLES_H
+
+#include "LabSound/LabSound.h"
+#include "OfflineRender.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The ex_* examples played by LabSoundDemo. Against the virtual clock they render into an
+// offline context, so LabSoundBench renders the same examples, through a host that puts its
+// own nodes between each example and the destination.
+
+struct ExampleHost
+{
+    std::string asset_base;         // used when the command line doesn't give an asset path
+    bool virtual_clock = false;     // play on an offline context, with rendered time in place of sleeping
+    float samplerate = LABSOUND_DEFAULT_SAMPLERATE;     // of the virtual clock's context
+    bool pipeline = false;          // split the examples that support it into PipelineStageNode stages
+
+    // Called with each context an example makes against the virtual clock, and the clock that
+    // drives it. Returns the node the example connects its output to, in place of the
+    // destination; the host connects that node onward. If unset, or nullptr is returned, the
+    // example is connected to the destination.
+    std::function<std::shared_ptr<lab::AudioNode>(lab::AudioContext&, std::shared_ptr<QuantumClockNode> const&)> output;
+};
+
+// what an example reports to its host once it has played
+struct ExampleResult
+{
+    double latency = 0;     // seconds added by pipeline stages, if any
+};
+
+struct DemoExample
+{
+    char const* name;
+    ExampleResult (*play)(ExampleHost const& host, int argc, char** argv);
+
+    // false for the examples that need a live input, or that render a context of their own,
+    // so that nothing reaches the host's output
+    bool hosted;
+};
+
+std::vector<DemoExample> const& DemoExamples();
+
+// returns nullptr if there is no example of that name
+DemoExample const* FindDemoExample(const std::string& name);
+
+#endif
@@ -0,0 +1,375 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#if defined(_MSC_VER)
+    #if !defined(_CRT_SECURE_NO_WARNINGS)
+        #define _CRT_SECURE_NO_WARNINGS
+    #endif
+    #if !defined(NOMINMAX)
+        #define NOMINMAX
+    #endif
+#endif
+
+#include "DemoGraphs.h"
+#include "ExpressionNode.h"
+#include "FastMath.h"
+#include "HrtfSpatializerNode.h"
+#include "KernelNode.h"
+#include "PartitionedConvolverNode.h"
+#include "VoicePoolNode.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace lab;
+
+namespace
+{
+    std::shared_ptr<AudioBus> LoadSample(DemoGraphSetup const& setup, char const* const name)
+    {
+        std::shared_ptr<AudioBus> bus = setup.load(name, setup.ac.sampleRate());
+        if (!bus)
+            throw std::runtime_error(std::string("couldn't open ") + name);
+        return bus;
+    }
+
+    /////////////////////////
+    //    offline_starter  //
+    /////////////////////////
+
+    // the graph rendered by LabSoundOfflineStarter
+    DemoGraph build_offline_starter(DemoGraphSetup const& setup)
+    {
+        auto& ac = setup.ac;
+        DemoGraph g;
+
+        auto musicClip = LoadSample(setup, "samples/stereo-music-clip.wav");
+
+        auto gain = std::make_shared<GainNode>(ac);
+        gain->gain()->setValue(setup.param("gain", 0.125f));
+
+        auto oscillator = std::make_shared<OscillatorNode>(ac);
+        auto musicClipNode = std::make_shared<SampledAudioNode>(ac);
+        {
+            ContextRenderLock r(&ac, "offline_starter");
+            musicClipNode->setBus(r, musicClip);
+        }
+
+        // osc -> gain --+--> mix
+        // music clip ---+
+        auto mix = std::make_shared<GainNode>(ac);
+        ac.connect(gain, oscillator, 0, 0);
+        ac.connect(mix, gain, 0, 0);
+        ac.connect(mix, musicClipNode, 0, 0);
+
+        oscillator->frequency()->setValue(setup.param("frequency", 880.f));
+        oscillator->setType(OscillatorType::SINE);
+        oscillator->start(0.0f);
+        musicClipNode->schedule(0.0);
+
+        g.output = mix;
+        g.nodes = { oscillator, gain, musicClipNode, mix };
+        return g;
+    }
+
+    ////////////////////
+    //    voice_pool  //
+    ////////////////////
+
+    // the Speed Metal beat of LabSoundDemo's ex_peak_compressor, under a dense layer of
+    // overlapping hits, all played by one VoicePoolNode
+    DemoGraph build_voice_pool(DemoGraphSetup const& setup)
+    {
+        auto& ac = setup.ac;
+        DemoGraph g;
+
+        const int voices = static_cast<int>(setup.param("voices", 256.f));
+        const float density = setup.param("density", 400.f);   // layered hits per second
+
+        float startTime = 0.1f;
+        float bpm = 30.f;
+        float bar_length = 60.f / bpm;
+        float eighthNoteTime = bar_length / 8.0f;
+        const int bars = static_cast<int>(std::ceil(std::max(0.0, setup.duration - startTime) / bar_length));
+        const size_t hits = static_cast<size_t>(bars) * 12 + static_cast<size_t>(density * setup.duration) + 1;
+
+        // every hit is posted up front, so the queue has to hold all of them
+        auto pool = std::make_shared<VoicePoolNode>(ac, voices, 2, hits);
+        const int kick = pool->addSample(LoadSample(setup, "samples/kick.wav"));
+        const int hihat = pool->addSample(LoadSample(setup, "samples/hihat.wav"));
+        const int snare = pool->addSample(LoadSample(setup, "samples/snare.wav"));
+
+        auto filter = std::make_shared<BiquadFilterNode>(ac);
+        filter->setType(lab::FilterType::LOWPASS);
+        filter->frequency()->setValue(1800.f);
+
+        auto peakComp = std::make_shared<PeakCompNode>(ac);
+        ac.connect(peakComp, filter, 0, 0);
+        ac.connect(filter, pool, 0, 0);
+
+        for (int bar = 0; bar < bars; ++bar)
+        {
+            float time = startTime + bar * bar_length;
+
+            pool->trigger(kick, time);
+            pool->trigger(kick, time + 4 * eighthNoteTime);
+
+            pool->trigger(snare, time + 2 * eighthNoteTime);
+            pool->trigger(snare, time + 6 * eighthNoteTime);
+
+            float hihat_beat = 8;
+            for (float i = 0; i < hihat_beat; i += 1)
+                pool->trigger(hihat, time + bar_length * i / hihat_beat);
+        }
+
+        std::mt19937 rng(1);
+        auto random_float = [&rng](float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng); };
+        const int layer[] = { kick, hihat, snare };
+        const int layered = static_cast<int>(density * setup.duration);
+        for (int i = 0; i < layered; ++i)
+        {
+            const double time = startTime + random_float(0.f, static_cast<float>(setup.duration));
+            pool->trigger(layer[i % 3], time, random_float(0.01f, 0.05f), random_float(-1.f, 1.f));
+        }
+
+        pool->start(0.f);
+
+        g.output = peakComp;
+        g.nodes = { pool, filter, peakComp };
+        return g;
+    }
+
+    //////////////////////
+    //    hrtf_crowd    //
+    //////////////////////
+
+    // a chirping emitter, the kernel of a KernelNode. It circles the listener, and sets its
+    // own position on the spatializer each quantum, which is read once the spatializer has
+    // pulled its inputs.
+    struct CrowdEmitter
+    {
+        HrtfSpatializerNode* spatializer = nullptr;
+        int index = 0;
+        float frequency = 2000.f;   // of the chirps
+        float rate = 2.f;           // chirps per second
+        float orbit = 0.05f;        // turns per second
+        float angle = 0.f;          // in turns, at the start
+        float radius = 4.f;
+        float height = 0.f;
+        float phase = 0.f;
+
+        void operator()(float* const* channels, int, int frames, double now, float sampleRate)
+        {
+            const float t = static_cast<float>(now);
+            const float turns = angle + orbit * t;
+            spatializer->setPosition(index, -radius * FastSinTurns(turns), height, -radius * FastCosTurns(turns));
+
+            // each chirp lasts a tenth of its period, and decays linearly
+            const float dt = 1.f / sampleRate;
+            const float step = frequency * dt;
+            float* out = channels[0];
+            for (int i = 0; i < frames; ++i)
+            {
+                const float local = FastPhaseWrap((t + i * dt) * rate);
+                const float envelope = local < 0.1f ? 1.f - local * 10.f : 0.f;
+                out[i] = 0.25f * envelope * FastSinTurns(phase);
+                phase = FastPhaseWrap(phase + step);
+            }
+        }
+    };
+
+    // emitters circling the listener, as many as the sources parameter, all spatialized by
+    // one HrtfSpatializerNode with the compiled hrtf database
+    DemoGraph build_hrtf_crowd(DemoGraphSetup const& setup)
+    {
+        auto& ac = setup.ac;
+        DemoGraph g;
+
+        const int sources = std::max(1, static_cast<int>(setup.param("sources", 256.f)));
+        auto spatializer = std::make_shared<HrtfSpatializerNode>(ac, HrtfDatabase::load(setup.asset_base + "/hrtf", ac.sampleRate()), sources);
+
+        auto masterGain = std::make_shared<GainNode>(ac);
+        masterGain->gain()->setValue(4.f / std::sqrt(static_cast<float>(sources)));
+        ac.connect(masterGain, spatializer, 0, 0);
+        g.output = masterGain;
+        g.nodes = { masterGain, spatializer };
+
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        for (int i = 0; i < sources; ++i)
+        {
+            CrowdEmitter e;
+            e.spatializer = spatializer.get();
+            e.index = i;
+            e.frequency = 1000.f + 3000.f * unit(random);
+            e.rate = 1.f + 3.f * unit(random);
+            e.orbit = 0.02f + 0.1f * unit(random);
+            e.angle = unit(random);
+            e.radius = 1.f + 9.f * unit(random);
+            e.height = 4.f * unit(random) - 2.f;
+
+            auto emitter = std::make_shared<KernelNode<CrowdEmitter, 1>>(ac, e);
+            ac.connect(spatializer, emitter, i, 0);
+            emitter->start(0.f);
+            g.nodes.push_back(emitter);
+        }
+        return g;
+    }
+
+    //////////////////////////////
+    //    convolver_reverbs     //
+    //////////////////////////////
+
+    // the graph of LabSoundDemo's ex_convolution_reverb, looped, convolved by LabSound's
+    // ConvolverNode or by a PartitionedConvolverNode, so the two can be compared
+    DemoGraph build_reverb(DemoGraphSetup const& setup, bool partitioned)
+    {
+        auto& ac = setup.ac;
+        DemoGraph g;
+
+        auto impulseResponseClip = LoadSample(setup, "impulse/cardiod-rear-levelled.wav");
+        auto voiceClip = LoadSample(setup, "samples/voice.ogg");
+
+        auto masterGain = std::make_shared<GainNode>(ac);
+        masterGain->gain()->setValue(0.5f);
+
+        std::shared_ptr<AudioNode> convolve;
+        if (partitioned)
+        {
+            auto convolver = std::make_shared<PartitionedConvolverNode>(ac);
+            convolver->setImpulse(impulseResponseClip);
+            convolve = convolver;
+        }
+        else
+        {
+            auto convolver = std::make_shared<ConvolverNode>(ac);
+            convolver->setImpulse(impulseResponseClip);
+            convolve = convolver;
+        }
+
+        auto wetGain = std::make_shared<GainNode>(ac);
+        wetGain->gain()->setValue(0.5f);
+        auto dryGain = std::make_shared<GainNode>(ac);
+        dryGain->gain()->setValue(0.1f);
+
+        auto voiceNode = std::make_shared<SampledAudioNode>(ac);
+        {
+            ContextRenderLock r(&ac, "convolver_reverb");
+            voiceNode->setBus(r, voiceClip);
+        }
+
+        // voice --> dry --+----------------------+
+        //                 |                      |
+        //                 +-> convolve --> wet --+--> master -->
+        ac.connect(dryGain, voiceNode, 0, 0);
+        ac.connect(convolve, dryGain, 0, 0);
+        ac.connect(wetGain, convolve, 0, 0);
+        ac.connect(masterGain, wetGain, 0, 0);
+        ac.connect(masterGain, dryGain, 0, 0);
+        voiceNode->schedule(0.0, -1);
+
+        g.output = masterGain;
+        g.nodes = { masterGain, convolve, wetGain, dryGain, voiceNode };
+        return g;
+    }
+
+    DemoGraph build_convolver_node_reverb(DemoGraphSetup const& setup)
+    {
+        return build_reverb(setup, false);
+    }
+
+    DemoGraph build_partitioned_convolver_reverb(DemoGraphSetup const& setup)
+    {
+        return build_reverb(setup, true);
+    }
+
+    //////////////////////
+    //    reverb_rooms  //
+    //////////////////////
+
+    // voices reverberated in rooms of their own, each a PartitionedConvolverNode, all of
+    // which share one prepared response
+    DemoGraph build_reverb_rooms(DemoGraphSetup const& setup)
+    {
+        auto& ac = setup.ac;
+        DemoGraph g;
+
+        const int rooms = std::max(1, static_cast<int>(setup.param("rooms", 8.f)));
+        auto impulse = ConvolutionImpulse::prepare(*LoadSample(setup, "impulse/cardiod-rear-levelled.wav"), ac.sampleRate());
+        auto voiceClip = LoadSample(setup, "samples/voice.ogg");
+
+        auto masterGain = std::make_shared<GainNode>(ac);
+        masterGain->gain()->setValue(0.5f / rooms);
+        g.output = masterGain;
+        g.nodes.push_back(masterGain);
+
+        for (int i = 0; i < rooms; ++i)
+        {
+            auto voiceNode = std::make_shared<SampledAudioNode>(ac);
+            {
+                ContextRenderLock r(&ac, "reverb_rooms");
+                voiceNode->setBus(r, voiceClip);
+            }
+
+            auto convolver = std::make_shared<PartitionedConvolverNode>(ac);
+            convolver->setImpulse(impulse);
+
+            // voice --> convolve --> master -->
+            ac.connect(convolver, voiceNode, 0, 0);
+            ac.connect(masterGain, convolver, 0, 0);
+            voiceNode->schedule(0.25 * i, -1);
+
+            g.nodes.push_back(voiceNode);
+            g.nodes.push_back(convolver);
+        }
+        return g;
+    }
+
+    ///////////////////////
+    //  expression_dsp   //
+    ///////////////////////
+
+    // the groove LabSoundInteractive starts its editor with
+    DemoGraph build_expression_dsp(DemoGraphSetup const& setup)
+    {
+        auto& ac = setup.ac;
+        DemoGraph g;
+
+        auto expression = std::make_shared<ExpressionNode>(ac, 2);
+        std::string error;
+        if (!expression->compile(ExpressionNode::exampleProgram(), error))
+            throw std::runtime_error("expression_dsp: " + error);
+
+        auto gain = std::make_shared<GainNode>(ac);
+        gain->gain()->setValue(setup.param("gain", 0.5f));
+        ac.connect(gain, expression, 0, 0);
+        expression->start(0);
+
+        g.output = gain;
+        g.nodes = { expression, gain };
+        return g;
+    }
+}
+
+std::vector<DemoGraphBuilder> const& DemoGraphBuilders()
+{
+    static const std::vector<DemoGraphBuilder> builders = {
+        { "offline_starter", build_offline_starter },
+        { "voice_pool", build_voice_pool },
+        { "hrtf_crowd", build_hrtf_crowd },
+        { "convolver_node_reverb", build_convolver_node_reverb },
+        { "partitioned_convolver_reverb", build_partitioned_convolver_reverb },
+        { "reverb_rooms", build_reverb_rooms },
+        { "expression_dsp", build_expression_dsp },
+    };
+    return builders;
+}
+
+DemoGraphBuilder const* FindDemoGraph(const std::string& name)
+{
+    for (auto& b : DemoGraphBuilders())
+        if (name == b.name)
+            return &b;
+    return nullptr;
+}
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_DEMOGRAPHS_H
+#define LABSOUNDDEMO_DEMOGRAPHS_H
+
+#include "LabSound/LabSound.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Graphs that LabSoundBench renders alongside the LabSoundDemo examples, to measure what
+// the examples don't exercise, such as dense voice pools and crowds of spatialized sources,
+// and the graph rendered by LabSoundOfflineStarter. They can be instantiated in any context,
+// including offline ones, and are controlled only by scheduled parameter automation, so they
+// render identically however fast they are pulled.
+
+using SampleLoader = std::function<std::shared_ptr<lab::AudioBus>(char const* const name, float sampleRate)>;
+
+struct DemoGraphSetup
+{
+    lab::AudioContext& ac;
+    SampleLoader load;
+    std::string asset_base;     // for assets that are searched for, such as the hrtf database
+    double duration = 10.0;     // seconds of automation to schedule
+
+    // optional overrides of a graph's settings, such as "frequency" or "gain". Graphs
+    // ignore parameters they don't know.
+    std::map<std::string, float> params;
+
+    float param(const std::string& name, float fallback) const
+    {
+        auto it = params.find(name);
+        return it != params.end() ? it->second : fallback;
+    }
+};
+
+struct DemoGraph
+{
+    std::shared_ptr<lab::AudioNode> output;                 // connect this to the destination
+    std::vector<std::shared_ptr<lab::AudioNode>> nodes;     // retained for as long as the graph renders
+    std::vector<std::shared_ptr<void>> state;               // non-node objects the graph depends on
+};
+
+struct DemoGraphBuilder
+{
+    char const* name;
+    DemoGraph (*build)(DemoGraphSetup const&);
+};
+
+std::vector<DemoGraphBuilder> const& DemoGraphBuilders();
+
+// returns nullptr if there is no graph of that name
+DemoGraphBuilder const* FindDemoGraph(const std::string& name);
+
+#endif
@@ -0,0 +1,272 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_DEMOKERNELS_H
+#define LABSOUNDDEMO_DEMOKERNELS_H
+
+#include "FastMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// The synthesis kernels of the demos that render with a KernelNode, shared by LabSoundDemo
+// and LabSoundInteractive. See KernelNode.h for the form of a kernel.
+
+// the frequency sweep of the klaxon, 0 to 1 in 900 ms with a 300 ms gap in between
+struct RedAlertSweep
+{
+    void operator()(float* const* channels, int, int frames, double now, float sampleRate)
+    {
+        const double dt = 1.0 / sampleRate;
+        double t = fmod(now, 1.2f);
+        float* values = channels[0];
+
+        for (int i = 0; i < frames; ++i)
+        {
+            if (t > 0.9)
+                values[i] = 487.f + 360.f;
+            else
+                values[i] = std::sqrt((float) t * 1.f / 0.9f) * 487.f + 360.f;
+
+            t += dt;
+        }
+    }
+};
+
+// gates the klaxon off during the gap between sweeps
+struct RedAlertGate
+{
+    void operator()(float* const* channels, int, int frames, double now, float sampleRate)
+    {
+        const double dt = 1.0 / sampleRate;
+        double t = fmod(now, 1.2f);
+        float* values = channels[0];
+
+        for (int i = 0; i < frames; ++i)
+        {
+            values[i] = t > 0.9 ? 0 : 0.333f;
+            t += dt;
+        }
+    }
+};
+
+// "Unexpected Token" from Wavepot. Original by Stagas: http://wavepot.com/stagas/unexpected-token (MIT License)
+struct WavepotGrooveBox
+{
+    static float note(int n, int octave = 0)
+    {
+        return FastExp2((n - 33.f + (12.f * octave)) / 12.0f) * 440.f;
+    }
+
+    std::vector<std::vector<int>> bassline = {
+        {7, 7, 7, 12, 10, 10, 10, 15},
+        {7, 7, 7, 15, 15, 17, 10, 29},
+        {7, 7, 7, 24, 10, 10, 10, 19},
+        {7, 7, 7, 15, 29, 24, 15, 10} };
+
+    std::vector<int> melody = {
+        7, 15, 7, 15,
+        7, 15, 10, 15,
+        10, 12, 24, 19,
+        7, 12, 10, 19 };
+
+    std::vector<std::vector<int>> chords = { {7, 12, 17, 10}, {10, 15, 19, 24} };
+
+    // The oscillators depend only on time, so they are computed a block at a time with the
+    // vectorized approximations in FastMath.h. t holds the time of each frame in the block.
+    static const int BlockFrames = 128;
+
+    // sin(2 pi (t + offset) x)
+    static void blockSin(const float* t, float x, float offset, float* out, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            out[i] = (t[i] + offset) * x;
+        FastSinTurnsBlock(out, out, n);
+    }
+
+    // a falling sawtooth, 1 - 2 fmod(t + offset, 1 / x) x
+    static void blockSaw(const float* t, float x, float offset, float* out, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            out[i] = (t[i] + offset) * x;
+        FastPhaseWrapBlock(out, out, n);
+        for (int i = 0; i < n; ++i)
+            out[i] = 1.0f - 2.0f * out[i];
+    }
+
+    static float sqr(float sine)
+    {
+        return sine > 0 ? 1.f : -1.f;
+    }
+
+    static float perc(float wave, float decay, float o, float t)
+    {
+        float env = std::max(0.f, 0.889f - (o * decay) / ((o * decay) + 1.f));
+        return wave * env;
+    }
+
+    static float hardClip(float n, float x)
+    {
+        return x > n ? n : x < -n ? -n : x;
+    }
+
+    struct FastLowpass
+    {
+        float v = 0;
+        float operator()(float n, float input)
+        {
+            return v += (input - v) / n;
+        }
+    };
+
+    struct FastHighpass
+    {
+        float v = 0;
+        float operator()(float n, float input)
+        {
+            return v += input - v * n;
+        }
+    };
+
+    // http://www.musicdsp.org/showone.php?id=24
+    // A Moog-style 24db resonant lowpass
+    struct MoogFilter
+    {
+        float y1 = 0, y2 = 0, y3 = 0, y4 = 0;
+        float oldx = 0, oldy1 = 0, oldy2 = 0, oldy3 = 0;
+
+        float process(float cutoff_, float resonance, float sample, float sampleRate)
+        {
+            float cutoff = 2.0f * cutoff_ / sampleRate;
+            float p = cutoff * (1.8f - 0.8f * cutoff);
+            float k = 2.f * FastSinTurns(cutoff * 0.25f) - 1.0f;
+            float t1 = (1.0f - p) * 1.386249f;
+            float t2 = 12.0f + t1 * t1;
+            float r = resonance * (t2 + 6.0f * t1) / (t2 - 6.0f * t1);
+
+            float x = sample - r * y4;
+
+            // Four cascaded one-pole filters (bilinear transform)
+            y1 = x * p + oldx * p - k * y1;
+            y2 = y1 * p + oldy1 * p - k * y2;
+            y3 = y2 * p + oldy2 * p - k * y3;
+            y4 = y3 * p + oldy3 * p - k * y4;
+
+            // Clipping band-limited sigmoid
+            y4 -= (y4 * y4 * y4) / 6.f;
+
+            oldx = x;
+            oldy1 = y1;
+            oldy2 = y2;
+            oldy3 = y3;
+            return y4;
+        }
+    };
+
+    MoogFilter lp_a;
+    MoogFilter lp_b;
+    MoogFilter lp_c;
+    FastLowpass fastlp_a;
+    FastHighpass fasthp_c;
+
+    // the kernel of a KernelNode. Every channel carries the same signal, so it is computed once.
+    void operator()(float* const* channels, int channelCount, int framesToProcess, double quantumStart, float sampleRate)
+    {
+        const float dt = 1.f / sampleRate;
+        for (int start = 0; start < framesToProcess; start += BlockFrames)
+        {
+            const int n = std::min(BlockFrames, framesToProcess - start);
+            render(channels, channelCount, start, n, static_cast<float>(quantumStart) + start * dt, dt, sampleRate);
+        }
+    }
+
+    void render(float* const* channels, int channelCount, int offset, int n, float now, float dt, float sampleRate)
+    {
+        int nextMeasure = int((now / 2)) % bassline.size();
+        auto const& bm = bassline[nextMeasure];
+
+        int nextNote = int((now * 4.f)) % bm.size();
+        float bn = note(bm[nextNote], 0);
+
+        auto const& p = chords[int(now / 4) % chords.size()];
+
+        auto mn = note(melody[int(now * 3.f) % melody.size()], int(2 - (now * 3)) % 4);
+        const float kn = note(7, -1);
+
+        float t[BlockFrames], tmp[BlockFrames];
+        float lfo_a[BlockFrames], lfo_b[BlockFrames], resonance[BlockFrames];
+        float bassWaveform[BlockFrames], padWaveform[BlockFrames];
+        float kickWaveform[BlockFrames], kickBase[BlockFrames];
+        float synthWaveform[BlockFrames], degrade[BlockFrames];
+        FastRamp(now, dt, t, n);
+
+        blockSin(t, 2.0f, 0.f, lfo_a, n);
+        blockSin(t, 1.0f / 32.0f, 0.f, lfo_b, n);
+        blockSin(t, 0.5f, 0.75f, resonance, n);
+
+        // Bass
+        blockSaw(t, bn, 0.f, bassWaveform, n);
+        blockSin(t, bn / 2.f, 0.f, tmp, n);
+        for (int i = 0; i < n; ++i)
+            bassWaveform[i] = bassWaveform[i] * 1.9f + sqr(tmp[i]) * 1.0f + tmp[i] * 2.2f;
+        blockSin(t, bn * 3.f, 0.f, tmp, n);
+        for (int i = 0; i < n; ++i)
+            bassWaveform[i] += sqr(tmp[i]) * 3.f;
+
+        // Pad
+        blockSaw(t, note(p[0], 1), 0.f, padWaveform, n);
+        for (int i = 0; i < n; ++i)
+            padWaveform[i] *= 5.1f;
+        blockSaw(t, note(p[1], 2), 0.f, tmp, n);
+        for (int i = 0; i < n; ++i)
+            padWaveform[i] += 3.9f * tmp[i];
+        blockSaw(t, note(p[2], 1), 0.f, tmp, n);
+        for (int i = 0; i < n; ++i)
+            padWaveform[i] += 4.0f * tmp[i];
+        blockSin(t, note(p[3], 0), 0.f, tmp, n);
+        for (int i = 0; i < n; ++i)
+            padWaveform[i] += 3.0f * sqr(tmp[i]);
+
+        // Kick
+        blockSin(t, kn, 0.f, kickWaveform, n);
+        blockSaw(t, kn * 0.2f, 0.f, tmp, n);
+        for (int i = 0; i < n; ++i)
+            kickWaveform[i] = hardClip(0.37f, kickWaveform[i]) * 2.0f + hardClip(0.07f, tmp[i]) * 4.00f;
+        blockSaw(t, 2.f, 0.f, kickBase, n);
+
+        // Synth
+        blockSaw(t, mn, 1.0f, synthWaveform, n);
+        blockSin(t, mn * 2.02f, 0.f, tmp, n);
+        for (int i = 0; i < n; ++i)
+            synthWaveform[i] += sqr(tmp[i]) * 0.4f;
+        blockSin(t, mn * 3.f, 2.f, tmp, n);
+        for (int i = 0; i < n; ++i)
+            synthWaveform[i] += sqr(tmp[i]);
+        blockSin(t, note(5, 2), 0.f, degrade, n);
+
+        // the filters carry state from sample to sample
+        for (int i = 0; i < n; ++i)
+        {
+            const float time = t[i];
+
+            float percussiveWaveform = perc(bassWaveform[i] / 3.f, 48.0f, 0.125f * FastPhaseWrap(time * 8.f), time) * 1.0f;
+            float bassSample = lp_a.process(1000.f + (lfo_b[i] * 140.f), resonance[i] * 0.2f, percussiveWaveform, sampleRate);
+
+            float padSample = 1.0f - ((lfo_a[i] * 0.28f) + 0.5f) * fasthp_c(0.5f, lp_c.process(1100.f + (lfo_a[i] * 150.f), 0.05f, padWaveform[i] * 0.03f, sampleRate));
+
+            float kickSample = kickBase[i] * 0.054f + fastlp_a(240.0f, perc(hardClip(0.6f, kickWaveform[i]), 54.f, 0.5f * FastPhaseWrap(time * 2.f), time)) * 2.f;
+
+            float synthPercussive = lp_b.process(3200.0f + (lfo_a[i] * 400.f), 0.1f, perc(synthWaveform[i], 1.6f, 4.f * FastPhaseWrap(time * 0.25f), time) * 1.7f, sampleRate) * 1.8f;
+            float synthDegradedWaveform = synthPercussive * degrade[i];
+            float synthSample = 0.4f * synthPercussive + 0.05f * synthDegradedWaveform;
+
+            // Mixer
+            const float sample = (0.66f * hardClip(0.65f, bassSample)) + (0.50f * padSample) + (0.66f * synthSample) + (2.75f * kickSample);
+            for (int c = 0; c < channelCount; ++c)
+                channels[c][offset + i] = sample;
+        }
+    }
+};
+
+#endif
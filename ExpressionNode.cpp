@@ -0,0 +1,803 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "ExpressionNode.h"
+#include "FastMath.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <vector>
+
+using namespace lab;
+
+namespace
+{
+    // the number of samples each register holds
+    const int BlockFrames = 128;
+
+    // registers are 16 bit indices; a program that needs more than this is surely a mistake
+    const int MaxRegisters = 4096;
+
+    enum class Op : uint8_t
+    {
+        Add, Sub, Mul, Div, Mod, Neg,
+        Less, Greater, LessEqual, GreaterEqual,
+        Sin, Cos, Tanh, Exp2, Log2, Sqrt, Abs, Floor, Wrap, SoftClip,
+        Pow, Min, Max, Clamp, Note,
+        SinOsc, SawOsc, SqrOsc, TriOsc, Noise,
+        Lowpass, Highpass, Moog,
+        Perc, Seq
+    };
+
+    struct Builtin
+    {
+        const char* name;
+        Op op;
+        int arity;      // -1 for any number of at least two
+        int state;      // floats of state kept between blocks
+        bool foldable;  // depends only on its arguments, so constant arguments give a constant
+    };
+
+    const Builtin Builtins[] = {
+        {"sin", Op::Sin, 1, 0, true},
+        {"cos", Op::Cos, 1, 0, true},
+        {"tanh", Op::Tanh, 1, 0, true},
+        {"exp2", Op::Exp2, 1, 0, true},
+        {"log2", Op::Log2, 1, 0, true},
+        {"sqrt", Op::Sqrt, 1, 0, true},
+        {"abs", Op::Abs, 1, 0, true},
+        {"floor", Op::Floor, 1, 0, true},
+        {"wrap", Op::Wrap, 1, 0, true},
+        {"softclip", Op::SoftClip, 1, 0, true},
+        {"pow", Op::Pow, 2, 0, true},
+        {"min", Op::Min, 2, 0, true},
+        {"max", Op::Max, 2, 0, true},
+        {"clamp", Op::Clamp, 3, 0, true},
+        {"note", Op::Note, 1, 0, true},
+        {"sinosc", Op::SinOsc, 1, 1, false},
+        {"sawosc", Op::SawOsc, 1, 1, false},
+        {"sqrosc", Op::SqrOsc, 1, 1, false},
+        {"triosc", Op::TriOsc, 1, 1, false},
+        {"noise", Op::Noise, 0, 2, false},
+        {"lp", Op::Lowpass, 2, 1, false},
+        {"hp", Op::Highpass, 2, 1, false},
+        {"moog", Op::Moog, 3, 8, false},
+        {"perc", Op::Perc, 2, 0, false},    // these two read t
+        {"seq", Op::Seq, -1, 0, false},
+    };
+
+    struct Instruction
+    {
+        Op op;
+        uint16_t dst;
+        uint16_t a, b, c;   // argument registers. For Seq, a is the rate, and the c steps
+                            // are listed in the program's args from index b.
+        uint32_t state;     // offset of the op's state
+    };
+
+    // the registers holding t, sr and pi
+    const uint16_t TimeRegister = 0;
+    const uint16_t RateRegister = 1;
+    const uint16_t PiRegister = 2;
+}
+
+struct ExpressionProgram
+{
+    struct StateSlot
+    {
+        Op op;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    std::vector<Instruction> code;
+    std::vector<uint16_t> args;
+    std::vector<float> registers;       // BlockFrames floats per register
+    std::vector<float> state;
+    std::vector<StateSlot> slots;       // the stateful instructions, in program order
+    std::vector<int> outputs;           // the register each channel plays, or -1
+    float sample_rate = 0;
+
+    ExpressionProgram* next_retired = nullptr;
+
+    float* reg(int r) { return registers.data() + static_cast<size_t>(r) * BlockFrames; }
+    void execute(const Instruction& in, int n);
+};
+
+void ExpressionProgram::execute(const Instruction& in, int n)
+{
+    float* d = reg(in.dst);
+    const float* a = reg(in.a);
+    const float* b = reg(in.b);
+    const float* c = reg(in.c);
+    float* s = state.data() + in.state;
+    const float sr = sample_rate;
+
+    switch (in.op)
+    {
+    case Op::Add: for (int i = 0; i < n; ++i) d[i] = a[i] + b[i]; break;
+    case Op::Sub: for (int i = 0; i < n; ++i) d[i] = a[i] - b[i]; break;
+    case Op::Mul: for (int i = 0; i < n; ++i) d[i] = a[i] * b[i]; break;
+    case Op::Div: for (int i = 0; i < n; ++i) d[i] = a[i] / b[i]; break;
+    case Op::Mod: for (int i = 0; i < n; ++i) d[i] = a[i] - b[i] * std::floor(a[i] / b[i]); break;
+    case Op::Neg: for (int i = 0; i < n; ++i) d[i] = -a[i]; break;
+
+    case Op::Less: for (int i = 0; i < n; ++i) d[i] = a[i] < b[i] ? 1.f : 0.f; break;
+    case Op::Greater: for (int i = 0; i < n; ++i) d[i] = a[i] > b[i] ? 1.f : 0.f; break;
+    case Op::LessEqual: for (int i = 0; i < n; ++i) d[i] = a[i] <= b[i] ? 1.f : 0.f; break;
+    case Op::GreaterEqual: for (int i = 0; i < n; ++i) d[i] = a[i] >= b[i] ? 1.f : 0.f; break;
+
+    case Op::Sin: FastSinBlock(a, d, n); break;
+    case Op::Cos:
+        for (int i = 0; i < n; ++i) d[i] = a[i] * 0.15915494309189535f;
+        FastCosTurnsBlock(d, d, n);
+        break;
+    case Op::Tanh: FastTanhBlock(a, d, n); break;
+    case Op::Exp2: FastExp2Block(a, d, n); break;
+    case Op::Log2: for (int i = 0; i < n; ++i) d[i] = FastLog2(std::max(a[i], 1e-30f)); break;
+    case Op::Sqrt: for (int i = 0; i < n; ++i) d[i] = std::sqrt(std::max(a[i], 0.f)); break;
+    case Op::Abs: for (int i = 0; i < n; ++i) d[i] = std::fabs(a[i]); break;
+    case Op::Floor: for (int i = 0; i < n; ++i) d[i] = std::floor(a[i]); break;
+    case Op::Wrap: FastPhaseWrapBlock(a, d, n); break;
+    case Op::SoftClip: FastSoftClipBlock(a, d, n); break;
+
+    case Op::Pow: for (int i = 0; i < n; ++i) d[i] = a[i] > 0 ? FastPow(a[i], b[i]) : 0.f; break;
+    case Op::Min: for (int i = 0; i < n; ++i) d[i] = std::min(a[i], b[i]); break;
+    case Op::Max: for (int i = 0; i < n; ++i) d[i] = std::max(a[i], b[i]); break;
+    case Op::Clamp: for (int i = 0; i < n; ++i) d[i] = std::min(std::max(a[i], b[i]), c[i]); break;
+    case Op::Note:
+        for (int i = 0; i < n; ++i) d[i] = (a[i] - 69.f) * (1.f / 12.f);
+        FastExp2Block(d, d, n);
+        for (int i = 0; i < n; ++i) d[i] *= 440.f;
+        break;
+
+    case Op::SinOsc:
+    case Op::SawOsc:
+    case Op::SqrOsc:
+    case Op::TriOsc:
+    {
+        float phase = s[0];
+        const float inv_sr = 1.f / sr;
+        for (int i = 0; i < n; ++i)
+        {
+            const float f = a[i];
+            d[i] = phase;
+            phase = FastPhaseWrap(phase + f * inv_sr);
+        }
+        s[0] = phase;
+
+        if (in.op == Op::SinOsc)
+            FastSinTurnsBlock(d, d, n);
+        else if (in.op == Op::SawOsc)
+            for (int i = 0; i < n; ++i) d[i] = 2.f * d[i] - 1.f;
+        else if (in.op == Op::SqrOsc)
+            for (int i = 0; i < n; ++i) d[i] = d[i] < 0.5f ? 1.f : -1.f;
+        else
+            for (int i = 0; i < n; ++i) d[i] = 4.f * std::fabs(d[i] - 0.5f) - 1.f;
+        break;
+    }
+
+    case Op::Noise:
+    {
+        // xorshift32, its state kept as two 16 bit halves so that it survives as floats
+        uint32_t x = static_cast<uint32_t>(s[0]) << 16 | static_cast<uint32_t>(s[1]);
+        for (int i = 0; i < n; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            d[i] = static_cast<float>(x >> 8) * (2.f / 16777216.f) - 1.f;
+        }
+        s[0] = static_cast<float>(x >> 16);
+        s[1] = static_cast<float>(x & 0xffff);
+        break;
+    }
+
+    case Op::Lowpass:
+    case Op::Highpass:
+    {
+        // y += g (x - y), with g = 1 - e^(-2 pi f / sr)
+        float y = s[0];
+        const float k = -6.283185307179586f * 1.4426950408889634f / sr;
+        for (int i = 0; i < n; ++i)
+        {
+            const float x = a[i];
+            const float g = 1.f - FastExp2(std::max(b[i], 0.f) * k);
+            y += g * (x - y);
+            d[i] = in.op == Op::Lowpass ? y : x - y;
+        }
+        s[0] = y;
+        break;
+    }
+
+    case Op::Moog:
+    {
+        // the filter of the wavepot examples; s holds y1-y4, then oldx and oldy1-oldy3
+        float y1 = s[0], y2 = s[1], y3 = s[2], y4 = s[3];
+        float oldx = s[4], oldy1 = s[5], oldy2 = s[6], oldy3 = s[7];
+        for (int i = 0; i < n; ++i)
+        {
+            const float cutoff = 2.f * b[i] / sr;
+            const float p = cutoff * (1.8f - 0.8f * cutoff);
+            const float k = 2.f * FastSin(cutoff * 1.5707963267948966f) - 1.f;
+            const float t1 = (1.f - p) * 1.386249f;
+            const float t2 = 12.f + t1 * t1;
+            const float r = c[i] * (t2 + 6.f * t1) / (t2 - 6.f * t1);
+
+            const float x = a[i] - r * y4;
+            y1 = x * p + oldx * p - k * y1;
+            y2 = y1 * p + oldy1 * p - k * y2;
+            y3 = y2 * p + oldy2 * p - k * y3;
+            y4 = y3 * p + oldy3 * p - k * y4;
+            y4 -= (y4 * y4 * y4) / 6.f;
+
+            oldx = x;
+            oldy1 = y1;
+            oldy2 = y2;
+            oldy3 = y3;
+            d[i] = y4;
+        }
+        s[0] = y1; s[1] = y2; s[2] = y3; s[3] = y4;
+        s[4] = oldx; s[5] = oldy1; s[6] = oldy2; s[7] = oldy3;
+        break;
+    }
+
+    case Op::Perc:
+    {
+        const float* t = reg(TimeRegister);
+        for (int i = 0; i < n; ++i)
+        {
+            const float period = a[i];
+            const float o = period > 0 ? period * FastPhaseWrap(t[i] / period) : t[i];
+            const float od = o * b[i];
+            d[i] = std::max(0.f, 0.889f - od / (od + 1.f));
+        }
+        break;
+    }
+
+    case Op::Seq:
+    {
+        const float* t = reg(TimeRegister);
+        const uint16_t* steps = args.data() + in.b;
+        const int count = in.c;
+        for (int i = 0; i < n; ++i)
+        {
+            int step = static_cast<int>(std::floor(t[i] * a[i])) % count;
+            if (step < 0)
+                step += count;
+            d[i] = reg(steps[step])[i];
+        }
+        break;
+    }
+    }
+}
+
+namespace
+{
+    struct CompileError : std::runtime_error
+    {
+        CompileError(int line, const std::string& message)
+            : std::runtime_error("line " + std::to_string(line) + ": " + message) {}
+    };
+
+    // A recursive descent parser that emits code as it goes. Precedence, lowest first, is
+    // comparison, + -, * / %, unary minus, then numbers, names, calls and parentheses.
+    class Compiler
+    {
+        enum class Token { Number, Name, Symbol, Separator, End };
+
+        const std::string& _source;
+        ExpressionProgram& _program;
+        size_t _pos = 0;
+        int _line = 1;
+
+        Token _token = Token::End;
+        std::string _text;          // of a name or symbol
+        float _number = 0;
+        int _token_line = 1;
+
+        std::map<std::string, uint16_t> _names;
+        std::vector<bool> _constant;    // per register, filled at compile time
+
+        void fail(const std::string& message) const { throw CompileError(_token_line, message); }
+
+        void next()
+        {
+            // skip blanks and comments, but not line ends, which separate statements
+            for (;;)
+            {
+                while (_pos < _source.size() && (_source[_pos] == ' ' || _source[_pos] == '\t' || _source[_pos] == '\r'))
+                    ++_pos;
+                if (_pos < _source.size() && _source[_pos] == '#')
+                {
+                    while (_pos < _source.size() && _source[_pos] != '\n')
+                        ++_pos;
+                    continue;
+                }
+                break;
+            }
+
+            _token_line = _line;
+            if (_pos >= _source.size())
+            {
+                _token = Token::End;
+                return;
+            }
+
+            const char ch = _source[_pos];
+            if (ch == '\n' || ch == ';')
+            {
+                if (ch == '\n')
+                    ++_line;
+                ++_pos;
+                _token = Token::Separator;
+            }
+            else if (std::isdigit(static_cast<unsigned char>(ch)) || (ch == '.' && _pos + 1 < _source.size() && std::isdigit(static_cast<unsigned char>(_source[_pos + 1]))))
+            {
+                const char* begin = _source.c_str() + _pos;
+                char* end = nullptr;
+                _number = std::strtof(begin, &end);
+                _pos += end - begin;
+                _token = Token::Number;
+            }
+            else if (std::isalpha(static_cast<unsigned char>(ch)) || ch == '_')
+            {
+                const size_t begin = _pos;
+                while (_pos < _source.size() && (std::isalnum(static_cast<unsigned char>(_source[_pos])) || _source[_pos] == '_'))
+                    ++_pos;
+                _text = _source.substr(begin, _pos - begin);
+                _token = Token::Name;
+            }
+            else if ((ch == '<' || ch == '>') && _pos + 1 < _source.size() && _source[_pos + 1] == '=')
+            {
+                _text = _source.substr(_pos, 2);
+                _pos += 2;
+                _token = Token::Symbol;
+            }
+            else if (std::string("+-*/%()<>,=").find(ch) != std::string::npos)
+            {
+                _text = std::string(1, ch);
+                ++_pos;
+                _token = Token::Symbol;
+            }
+            else
+            {
+                _token_line = _line;
+                fail(std::string("unexpected character '") + ch + "'");
+            }
+        }
+
+        bool symbol(const char* s) const { return _token == Token::Symbol && _text == s; }
+
+        void expect(const char* s)
+        {
+            if (!symbol(s))
+                fail(std::string("expected '") + s + "'");
+            next();
+        }
+
+        uint16_t allocate()
+        {
+            const size_t count = _constant.size();
+            if (count >= MaxRegisters)
+                fail("the program is too long");
+            _program.registers.resize((count + 1) * BlockFrames);
+            _constant.push_back(false);
+            return static_cast<uint16_t>(count);
+        }
+
+        uint16_t constant(float value)
+        {
+            const uint16_t r = allocate();
+            std::fill(_program.reg(r), _program.reg(r) + BlockFrames, value);
+            _constant[r] = true;
+            return r;
+        }
+
+        uint16_t emit(Op op, int stateSize, bool foldable, uint16_t a, uint16_t b = 0, uint16_t c = 0)
+        {
+            Instruction in;
+            in.op = op;
+            in.dst = allocate();
+            in.a = a;
+            in.b = b;
+            in.c = c;
+            in.state = static_cast<uint32_t>(_program.state.size());
+
+            if (stateSize)
+            {
+                _program.slots.push_back({op, in.state, static_cast<uint32_t>(stateSize)});
+                _program.state.resize(_program.state.size() + stateSize, 0.f);
+                if (op == Op::Noise)
+                {
+                    // a different, non zero, seed for each generator
+                    _program.state[in.state] = static_cast<float>(0x2545 + _program.slots.size());
+                    _program.state[in.state + 1] = static_cast<float>(0xf491);
+                }
+            }
+
+            if (foldable && _constant[a] && _constant[b] && _constant[c])
+            {
+                _program.execute(in, BlockFrames);
+                _constant[in.dst] = true;
+            }
+            else
+                _program.code.push_back(in);
+            return in.dst;
+        }
+
+        uint16_t call(const std::string& name)
+        {
+            const Builtin* fn = nullptr;
+            for (const Builtin& b : Builtins)
+                if (name == b.name)
+                    fn = &b;
+            if (!fn)
+                fail("unknown function '" + name + "'");
+
+            std::vector<uint16_t> args;
+            expect("(");
+            if (!symbol(")"))
+            {
+                args.push_back(expression());
+                while (symbol(","))
+                {
+                    next();
+                    args.push_back(expression());
+                }
+            }
+            expect(")");
+
+            if (fn->arity < 0)
+            {
+                if (args.size() < 2)
+                    fail(name + " needs a rate and at least one step");
+                const uint16_t first = static_cast<uint16_t>(_program.args.size());
+                _program.args.insert(_program.args.end(), args.begin() + 1, args.end());
+                return emit(fn->op, 0, false, args[0], first, static_cast<uint16_t>(args.size() - 1));
+            }
+
+            if (static_cast<int>(args.size()) != fn->arity)
+                fail(name + " takes " + std::to_string(fn->arity) + (fn->arity == 1 ? " argument" : " arguments"));
+
+            // unused arguments refer to a constant, so they don't stop the call being folded
+            args.resize(3, RateRegister);
+            return emit(fn->op, fn->state, fn->foldable, args[0], args[1], args[2]);
+        }
+
+        uint16_t primary()
+        {
+            if (_token == Token::Number)
+            {
+                const float value = _number;
+                next();
+                return constant(value);
+            }
+            if (_token == Token::Name)
+            {
+                const std::string name = _text;
+                next();
+                if (symbol("("))
+                    return call(name);
+
+                auto it = _names.find(name);
+                if (it == _names.end())
+                    fail("'" + name + "' is not defined");
+                return it->second;
+            }
+            if (symbol("("))
+            {
+                next();
+                const uint16_t r = expression();
+                expect(")");
+                return r;
+            }
+            fail(_token == Token::Separator || _token == Token::End ? "expected a value" : "unexpected '" + _text + "'");
+            return 0;
+        }
+
+        uint16_t unary()
+        {
+            if (symbol("-"))
+            {
+                next();
+                const uint16_t a = unary();
+                return emit(Op::Neg, 0, true, a, a, a);
+            }
+            return primary();
+        }
+
+        uint16_t multiplicative()
+        {
+            uint16_t a = unary();
+            for (;;)
+            {
+                Op op;
+                if (symbol("*")) op = Op::Mul;
+                else if (symbol("/")) op = Op::Div;
+                else if (symbol("%")) op = Op::Mod;
+                else return a;
+                next();
+                const uint16_t b = unary();
+                a = emit(op, 0, true, a, b, b);
+            }
+        }
+
+        uint16_t additive()
+        {
+            uint16_t a = multiplicative();
+            for (;;)
+            {
+                Op op;
+                if (symbol("+")) op = Op::Add;
+                else if (symbol("-")) op = Op::Sub;
+                else return a;
+                next();
+                const uint16_t b = multiplicative();
+                a = emit(op, 0, true, a, b, b);
+            }
+        }
+
+        uint16_t expression()
+        {
+            const uint16_t a = additive();
+            Op op;
+            if (symbol("<")) op = Op::Less;
+            else if (symbol(">")) op = Op::Greater;
+            else if (symbol("<=")) op = Op::LessEqual;
+            else if (symbol(">=")) op = Op::GreaterEqual;
+            else return a;
+            next();
+            const uint16_t b = additive();
+            return emit(op, 0, true, a, b, b);
+        }
+
+        void statement()
+        {
+            if (_token != Token::Name)
+                fail("expected a name to assign to");
+            const std::string name = _text;
+            next();
+            expect("=");
+            const uint16_t r = expression();
+            if (_token != Token::Separator && _token != Token::End)
+                fail("unexpected '" + _text + "' after the expression");
+
+            const int channels = static_cast<int>(_program.outputs.size());
+            if (name == "out")
+                std::fill(_program.outputs.begin(), _program.outputs.end(), r);
+            else if (name.size() > 3 && name.compare(0, 3, "out") == 0 &&
+                     name.find_first_not_of("0123456789", 3) == std::string::npos)
+            {
+                const int channel = std::atoi(name.c_str() + 3);
+                if (channel >= channels)
+                    fail(name + " is not an output; the node has " + std::to_string(channels) + " channels");
+                _program.outputs[channel] = r;
+            }
+            else if (name == "t" || name == "sr" || name == "pi")
+                fail("'" + name + "' can't be assigned");
+            else
+                _names[name] = r;
+        }
+
+    public:
+        Compiler(const std::string& source, ExpressionProgram& program)
+            : _source(source), _program(program)
+        {
+            allocate();
+            constant(program.sample_rate);
+            constant(3.14159265358979f);
+            _names["t"] = TimeRegister;
+            _names["sr"] = RateRegister;
+            _names["pi"] = PiRegister;
+        }
+
+        void compile()
+        {
+            next();
+            for (;;)
+            {
+                while (_token == Token::Separator)
+                    next();
+                if (_token == Token::End)
+                    break;
+                statement();
+            }
+
+            if (std::find_if(_program.outputs.begin(), _program.outputs.end(), [](int r) { return r >= 0; }) == _program.outputs.end())
+                throw CompileError(_line, "nothing is assigned to out");
+        }
+    };
+
+    bool ReadFile(const std::string& path, std::string& contents)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        contents = buffer.str();
+        return true;
+    }
+
+    std::time_t ModifiedTime(const std::string& path)
+    {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+    }
+}
+
+ExpressionNode::ExpressionNode(AudioContext& ac, int channels)
+    : BlockFunctionNode(ac, channels)
+    , _channels(channels)
+    , _sample_rate(ac.sampleRate())
+{
+    setBlockFunction([this](ContextRenderLock&, BlockFunctionNode*, float* const* channels, int channelCount, int frames, double now) {
+        render(channels, channelCount, frames, now);
+    });
+}
+
+ExpressionNode::~ExpressionNode()
+{
+    delete _pending.exchange(nullptr);
+    delete _current;
+    collectRetired();
+}
+
+bool ExpressionNode::compile(const std::string& source, std::string& error)
+{
+    collectRetired();
+
+    std::unique_ptr<ExpressionProgram> program(new ExpressionProgram());
+    program->sample_rate = _sample_rate;
+    program->outputs.assign(_channels, -1);
+    try
+    {
+        Compiler(source, *program).compile();
+    }
+    catch (const CompileError& e)
+    {
+        error = e.what();
+        return false;
+    }
+
+    error.clear();
+
+    // a program the render thread never picked up can be deleted here
+    delete _pending.exchange(program.release());
+    return true;
+}
+
+bool ExpressionNode::compileFile(const std::string& path, std::string& error)
+{
+    // remembered even if it can't be read yet, so that reloadIfChanged() picks it up once it can
+    _path = path;
+    _modified = ModifiedTime(path);
+
+    std::string source;
+    if (!ReadFile(path, source))
+    {
+        _modified = 0;
+        error = "couldn't read " + path;
+        return false;
+    }
+    return compile(source, error);
+}
+
+const char* ExpressionNode::exampleProgram()
+{
+    return R"(# bass, stepping through a two bar line
+root = seq(0.5, 31, 31, 34, 29)
+bass = moog(sawosc(note(root + seq(4, 0, 0, 12, 0, 7, 0, 12, 10))), 400 + 300 * sinosc(0.125), 0.5)
+
+# a pad on the root's fifth, panned apart
+pad = 0.08 * (triosc(note(root + 19)) + triosc(note(root + 24) * 1.003))
+
+kick = sinosc(60 + 80 * perc(0.5, 60)) * perc(0.5, 20)
+hat = hp(noise(), 8000) * perc(0.125, 120) * 0.3
+
+mix = bass * perc(0.25, 10) * 0.5 + kick + hat
+out0 = softclip(mix + pad * 0.7)
+out1 = softclip(mix + pad * 1.3)
+)";
+}
+
+bool ExpressionNode::reloadIfChanged(std::string& error)
+{
+    error.clear();
+    collectRetired();
+    if (_path.empty())
+        return false;
+
+    const std::time_t modified = ModifiedTime(_path);
+    if (!modified || modified == _modified)
+        return false;
+
+    // an editor may still be writing the file; if it can't be read, try again next time
+    std::string source;
+    if (!ReadFile(_path, source))
+        return false;
+
+    _modified = modified;
+    compile(source, error);
+    return true;
+}
+
+void ExpressionNode::collectRetired()
+{
+    ExpressionProgram* program = _retired.exchange(nullptr);
+    while (program)
+    {
+        ExpressionProgram* next = program->next_retired;
+        delete program;
+        program = next;
+    }
+}
+
+void ExpressionNode::render(float* const* channels, int channelCount, int frames, double now)
+{
+    if (ExpressionProgram* program = _pending.exchange(nullptr))
+    {
+        if (_current)
+        {
+            // carry state across to the same kinds of op, in order
+            const size_t count = std::min(_current->slots.size(), program->slots.size());
+            for (size_t i = 0; i < count; ++i)
+            {
+                const ExpressionProgram::StateSlot& from = _current->slots[i];
+                const ExpressionProgram::StateSlot& to = program->slots[i];
+                if (from.op != to.op)
+                    break;
+                std::copy(_current->state.begin() + from.offset, _current->state.begin() + from.offset + from.size,
+                          program->state.begin() + to.offset);
+            }
+
+            // the control thread deletes it; don't free memory on the render thread
+            _current->next_retired = _retired.load();
+            while (!_retired.compare_exchange_weak(_current->next_retired, _current)) {}
+        }
+        _current = program;
+    }
+
+    ExpressionProgram* program = _current;
+    if (!program)
+    {
+        for (int c = 0; c < channelCount; ++c)
+            std::fill(channels[c], channels[c] + frames, 0.f);
+        return;
+    }
+
+    const double dt = 1.0 / program->sample_rate;
+    for (int start = 0; start < frames; start += BlockFrames)
+    {
+        const int n = std::min(BlockFrames, frames - start);
+
+        // each sample's t is computed in double from the block's start, so rounding doesn't
+        // accumulate, though the register holds it as a float
+        float* t = program->reg(TimeRegister);
+        const double t0 = now + start * dt;
+        for (int i = 0; i < n; ++i)
+            t[i] = static_cast<float>(t0 + i * dt);
+
+        for (const Instruction& in : program->code)
+            program->execute(in, n);
+
+        for (int c = 0; c < channelCount; ++c)
+        {
+            const int r = c < static_cast<int>(program->outputs.size()) ? program->outputs[c] : -1;
+            if (r < 0)
+                std::fill(channels[c] + start, channels[c] + start + n, 0.f);
+            else
+                std::copy(program->reg(r), program->reg(r) + n, channels[c] + start);
+        }
+    }
+}
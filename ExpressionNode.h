@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_EXPRESSIONNODE_H
+#define LABSOUNDDEMO_EXPRESSIONNODE_H
+
+#include "BlockFunctionNode.h"
+
+#include <atomic>
+#include <ctime>
+#include <string>
+
+struct ExpressionProgram;
+
+// ExpressionNode synthesizes sound from a small expression language, in the style of
+// Wavepot, so that a sound can be reworked while it plays instead of being rebuilt as C++.
+//
+// A program is a list of statements, one per line or separated by ';'. '#' starts a comment.
+//
+//   name = expr        names a value for later statements
+//   out = expr         writes every output channel
+//   out0 = expr        writes one channel, out1 the next, and so on
+//
+// Expressions are made of numbers, names, + - * / % (a modulo that wraps negative values),
+// < > <= >= (1 or 0), unary minus, parentheses and calls. The names t, the time in seconds
+// since the node started, sr, the sample rate, and pi are predefined. Like every register,
+// t holds floats, which resolve it to within a sample at 48 kHz only for the first four
+// minutes or so, so pitches are better made with the oscillators than from t. Functions are
+//
+//   sin cos tanh exp2 log2 sqrt abs floor wrap softclip   of one value; wrap is x - floor(x)
+//   pow(x, y) min(a, b) max(a, b) clamp(x, lo, hi)
+//   note(n)                    the frequency of midi note n
+//   sinosc(f) sawosc(f) sqrosc(f) triosc(f)
+//                              oscillators that keep their own phase, so f may be modulated
+//   noise()                    white noise
+//   lp(x, f) hp(x, f)          one pole filters, with cutoff f in Hz
+//   moog(x, f, resonance)      a Moog-style 24 dB resonant lowpass
+//   perc(period, decay)        a percussive envelope, retriggered every period seconds
+//   seq(rate, a, b, ...)       steps through a, b, ... at rate steps per second
+//
+// For example,
+//
+//   bass = moog(sawosc(note(seq(4, 31, 31, 31, 36))), 800 + 400 * sin(2 * pi * t / 8), 0.3)
+//   out = softclip(bass * perc(0.25, 40) + 0.2 * lp(noise(), 3000) * perc(0.5, 80))
+//
+// A program is compiled to bytecode for a register machine whose registers each hold a
+// block of samples, so each instruction is dispatched once per block rather than once per
+// sample, and the arithmetic and oscillator loops are vectorized with FastMath.h.
+//
+// compile() may be called at any time from the control thread. The render thread switches
+// to the new program at the start of its next quantum; filters and oscillators that
+// appear in the same order in both programs keep their state across the switch, so edits
+// don't click.
+class ExpressionNode : public BlockFunctionNode
+{
+    ExpressionProgram* _current = nullptr;          // render thread only
+    std::atomic<ExpressionProgram*> _pending{nullptr};
+    std::atomic<ExpressionProgram*> _retired{nullptr};  // programs the render thread is done with
+
+    int _channels;
+    float _sample_rate;
+    std::string _path;
+    std::time_t _modified = 0;
+
+    void render(float* const* channels, int channelCount, int frames, double now);
+    void collectRetired();
+
+public:
+    explicit ExpressionNode(lab::AudioContext& ac, int channels = 2);
+    virtual ~ExpressionNode();
+
+    // Compiles source and plays it from the next quantum. On failure the current program
+    // keeps playing, and error describes the problem and its line.
+    bool compile(const std::string& source, std::string& error);
+
+    // compile the contents of a file, and remember it for reloadIfChanged(), even if it
+    // couldn't be read or compiled
+    bool compileFile(const std::string& path, std::string& error);
+
+    // the groove the demos play, in the spirit of wavepot_dsp, as a starting point for edits
+    static const char* exampleProgram();
+
+    // Recompiles the file given to compileFile if it has been modified since. Returns true if
+    // the file had changed; error is empty if its new contents compiled. Call it from the
+    // control thread as often as edits should be picked up.
+    bool reloadIfChanged(std::string& error);
+};
+
+#endif
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "FastMath.h"
+
+// The block functions use the widest instruction set the build targets. AVX2 is only used
+// if it is enabled for this file, see LABSOUNDDEMO_AVX2 in CMakeLists.txt.
+#if defined(__AVX2__)
+    #define FASTMATH_AVX2
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define FASTMATH_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define FASTMATH_NEON
+    #include <arm_neon.h>
+#endif
+
+using namespace fastmath_detail;
+
+namespace
+{
+#if defined(FASTMATH_AVX2)
+
+    struct SimdOps
+    {
+        using V = __m256;
+        using I = __m256i;
+        static const int width = 8;
+
+        static V load(const float* p) { return _mm256_loadu_ps(p); }
+        static void store(float* p, V a) { _mm256_storeu_ps(p, a); }
+
+        static V set1(float x) { return _mm256_set1_ps(x); }
+        static V add(V a, V b) { return _mm256_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm256_div_ps(a, b); }
+        static V min(V a, V b) { return _mm256_min_ps(a, b); }
+        static V max(V a, V b) { return _mm256_max_ps(a, b); }
+
+        static I bits(V a) { return _mm256_castps_si256(a); }
+        static V from_bits(I i) { return _mm256_castsi256_ps(i); }
+
+        static V gt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static V and_(V a, V b) { return _mm256_and_ps(a, b); }
+        static V or_(V a, V b) { return _mm256_or_ps(a, b); }
+        static V andnot(V a, V b) { return _mm256_andnot_ps(a, b); }
+        static V select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+
+        static I iset1(int32_t x) { return _mm256_set1_epi32(x); }
+        static I iadd(I a, I b) { return _mm256_add_epi32(a, b); }
+        static I isub(I a, I b) { return _mm256_sub_epi32(a, b); }
+        static I iand(I a, I b) { return _mm256_and_si256(a, b); }
+        static I ior(I a, I b) { return _mm256_or_si256(a, b); }
+        template <int n> static I shl(I a) { return _mm256_slli_epi32(a, n); }
+        template <int n> static I shr(I a) { return _mm256_srli_epi32(a, n); }
+        static I to_int(V a) { return _mm256_cvttps_epi32(a); }
+        static V to_float(I a) { return _mm256_cvtepi32_ps(a); }
+    };
+
+    const char* const isa = "avx2";
+
+#elif defined(FASTMATH_SSE2)
+
+    struct SimdOps
+    {
+        using V = __m128;
+        using I = __m128i;
+        static const int width = 4;
+
+        static V load(const float* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, V a) { _mm_storeu_ps(p, a); }
+
+        static V set1(float x) { return _mm_set1_ps(x); }
+        static V add(V a, V b) { return _mm_add_ps(a, b); }
+        static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+        static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+        static V div(V a, V b) { return _mm_div_ps(a, b); }
+        static V min(V a, V b) { return _mm_min_ps(a, b); }
+        static V max(V a, V b) { return _mm_max_ps(a, b); }
+
+        static I bits(V a) { return _mm_castps_si128(a); }
+        static V from_bits(I i) { return _mm_castsi128_ps(i); }
+
+        static V gt(V a, V b) { return _mm_cmpgt_ps(a, b); }
+        static V and_(V a, V b) { return _mm_and_ps(a, b); }
+        static V or_(V a, V b) { return _mm_or_ps(a, b); }
+        static V andnot(V a, V b) { return _mm_andnot_ps(a, b); }
+        static V select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+        static I iset1(int32_t x) { return _mm_set1_epi32(x); }
+        static I iadd(I a, I b) { return _mm_add_epi32(a, b); }
+        static I isub(I a, I b) { return _mm_sub_epi32(a, b); }
+        static I iand(I a, I b) { return _mm_and_si128(a, b); }
+        static I ior(I a, I b) { return _mm_or_si128(a, b); }
+        template <int n> static I shl(I a) { return _mm_slli_epi32(a, n); }
+        template <int n> static I shr(I a) { return _mm_srli_epi32(a, n); }
+        static I to_int(V a) { return _mm_cvttps_epi32(a); }
+        static V to_float(I a) { return _mm_cvtepi32_ps(a); }
+    };
+
+    const char* const isa = "sse2";
+
+#elif defined(FASTMATH_NEON)
+
+    struct SimdOps
+    {
+        using V = float32x4_t;
+        using I = int32x4_t;
+        static const int width = 4;
+
+        static V load(const float* p) { return vld1q_f32(p); }
+        static void store(float* p, V a) { vst1q_f32(p, a); }
+
+        static V set1(float x) { return vdupq_n_f32(x); }
+        static V add(V a, V b) { return vaddq_f32(a, b); }
+        static V sub(V a, V b) { return vsubq_f32(a, b); }
+        static V mul(V a, V b) { return vmulq_f32(a, b); }
+        static V div(V a, V b)
+        {
+    #if defined(__aarch64__)
+            return vdivq_f32(a, b);
+    #else
+            // a reciprocal estimate, refined twice, is within an ulp or two
+            V r = vrecpeq_f32(b);
+            r = vmulq_f32(vrecpsq_f32(b, r), r);
+            r = vmulq_f32(vrecpsq_f32(b, r), r);
+            return vmulq_f32(a, r);
+    #endif
+        }
+        static V min(V a, V b) { return vminq_f32(a, b); }
+        static V max(V a, V b) { return vmaxq_f32(a, b); }
+
+        static I bits(V a) { return vreinterpretq_s32_f32(a); }
+        static V from_bits(I i) { return vreinterpretq_f32_s32(i); }
+
+        static V gt(V a, V b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+        static V and_(V a, V b) { return from_bits(vandq_s32(bits(a), bits(b))); }
+        static V or_(V a, V b) { return from_bits(vorrq_s32(bits(a), bits(b))); }
+        static V andnot(V a, V b) { return from_bits(vbicq_s32(bits(b), bits(a))); }
+        static V select(V mask, V a, V b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+
+        static I iset1(int32_t x) { return vdupq_n_s32(x); }
+        static I iadd(I a, I b) { return vaddq_s32(a, b); }
+        static I isub(I a, I b) { return vsubq_s32(a, b); }
+        static I iand(I a, I b) { return vandq_s32(a, b); }
+        static I ior(I a, I b) { return vorrq_s32(a, b); }
+        template <int n> static I shl(I a) { return vshlq_n_s32(a, n); }
+        template <int n> static I shr(I a) { return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a), n)); }
+        static I to_int(V a) { return vcvtq_s32_f32(a); }
+        static V to_float(I a) { return vcvtq_f32_s32(a); }
+    };
+
+    const char* const isa = "neon";
+
+#else
+
+    struct SimdOps : ScalarOps
+    {
+        static const int width = 1;
+        static V load(const float* p) { return *p; }
+        static void store(float* p, V a) { *p = a; }
+    };
+
+    const char* const isa = "scalar";
+
+#endif
+
+    // applies f to whole registers, then the scalar version of f to the remainder
+    template <typename F, typename G>
+    inline void Apply(const float* in, float* out, int n, F f, G scalar)
+    {
+        int i = 0;
+        for (; i + SimdOps::width <= n; i += SimdOps::width)
+            SimdOps::store(out + i, f(SimdOps::load(in + i)));
+        for (; i < n; ++i)
+            out[i] = scalar(in[i]);
+    }
+}
+
+void FastSinTurnsBlock(const float* turns, float* out, int n)
+{
+    Apply(turns, out, n, [](SimdOps::V t) { return SinTurns<SimdOps>(t); }, FastSinTurns);
+}
+
+void FastCosTurnsBlock(const float* turns, float* out, int n)
+{
+    Apply(turns, out, n,
+          [](SimdOps::V t) { return SinTurns<SimdOps>(SimdOps::add(t, SimdOps::set1(0.25f))); },
+          FastCosTurns);
+}
+
+void FastSinBlock(const float* x, float* out, int n)
+{
+    Apply(x, out, n,
+          [](SimdOps::V v) { return SinTurns<SimdOps>(SimdOps::mul(v, SimdOps::set1(0.15915494309189535f))); },
+          FastSin);
+}
+
+void FastExp2Block(const float* x, float* out, int n)
+{
+    Apply(x, out, n, [](SimdOps::V v) { return Exp2<SimdOps>(v); }, FastExp2);
+}
+
+void FastTanhBlock(const float* x, float* out, int n)
+{
+    Apply(x, out, n, [](SimdOps::V v) { return Tanh<SimdOps>(v); }, FastTanh);
+}
+
+void FastSoftClipBlock(const float* x, float* out, int n)
+{
+    Apply(x, out, n, [](SimdOps::V v) { return SoftClip<SimdOps>(v); }, FastSoftClip);
+}
+
+void FastPhaseWrapBlock(const float* x, float* out, int n)
+{
+    Apply(x, out, n, [](SimdOps::V v) { return PhaseWrap<SimdOps>(v); }, FastPhaseWrap);
+}
+
+void FastRamp(float start, float step, float* out, int n)
+{
+    for (int i = 0; i < n; ++i)
+        out[i] = start + static_cast<float>(i) * step;
+}
+
+void FastMulAddBlock(const float* in, float gain, float* out, int n)
+{
+    const SimdOps::V g = SimdOps::set1(gain);
+    int i = 0;
+    for (; i + SimdOps::width <= n; i += SimdOps::width)
+        SimdOps::store(out + i, SimdOps::add(SimdOps::load(out + i), SimdOps::mul(SimdOps::load(in + i), g)));
+    for (; i < n; ++i)
+        out[i] += in[i] * gain;
+}
+
+const char* FastMathIsa()
+{
+    return isa;
+}
+
+void DisableDenormals()
+{
+#if defined(FASTMATH_AVX2) || defined(FASTMATH_SSE2)
+    // FTZ is bit 15 of the MXCSR, DAZ bit 6
+    _mm_setcsr(_mm_getcsr() | 0x8040);
+#elif defined(FASTMATH_NEON) && defined(__aarch64__)
+    // FZ is bit 24 of the FPCR, which flushes inputs as well as results
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | (uint64_t(1) << 24)));
+#elif defined(FASTMATH_NEON) && defined(__GNUC__)
+    uint32_t fpscr;
+    __asm__ __volatile__("vmrs %0, fpscr" : "=r"(fpscr));
+    __asm__ __volatile__("vmsr fpscr, %0" : : "r"(fpscr | (1u << 24)));
+#endif
+}
@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_FASTMATH_H
+#define LABSOUNDDEMO_FASTMATH_H
+
+#include <cstdint>
+#include <cstring>
+
+// Approximate math for procedural DSP, in place of per sample calls to libm. Each function
+// comes as an inline scalar version, for use inside loops that carry state from sample to
+// sample such as filters, and as a block version in FastMath.cpp that processes arrays with
+// SSE2, AVX2 or NEON, whichever the build targets; see FastMathIsa(). Both are computed by
+// the same code below, so a block and a loop over the scalar version give the same results.
+//
+// Measured error bounds, over the stated domains:
+//
+//   FastSinTurns(t)    sin(2 pi t)             |t| < 2^22 turns     absolute 2e-7
+//   FastCosTurns(t)    cos(2 pi t)             |t| < 2^22 turns     absolute 2e-7
+//   FastSin(x)         sin(x)                  |x| < 2^24           absolute 2e-7 + 1e-7 |x|,
+//   FastCos(x)         cos(x)                                       from rounding x / 2 pi
+//   FastExp2(x)        2^x                     -126 <= x <= 126     relative 2.5e-7
+//   FastLog2(x)        log2(x)                 normal x > 0         absolute 2.5e-7
+//   FastPow(x, y)      x^y                     normal x > 0         relative 2.5e-7 + 2e-7 |y|
+//   FastTanh(x)        tanh(x)                 any x                absolute 2e-7
+//   FastPhaseWrap(x)   x - floor(x)            |x| < 2^22           exact, in [0, 1]
+//   FastSoftClip(x)    1.5 x - 0.5 x^3, with x clamped to [-1, 1]   exact
+//
+// Values outside the domains are clamped, or lose precision; none of the functions are
+// suitable where exact libm results are required.
+
+namespace fastmath_detail
+{
+    // The operations the approximations are written in terms of, for plain floats. FastMath.cpp
+    // provides the same operations for SIMD registers.
+    struct ScalarOps
+    {
+        using V = float;
+        using I = int32_t;
+
+        static V set1(float x) { return x; }
+        static V add(V a, V b) { return a + b; }
+        static V sub(V a, V b) { return a - b; }
+        static V mul(V a, V b) { return a * b; }
+        static V div(V a, V b) { return a / b; }
+        static V min(V a, V b) { return a < b ? a : b; }
+        static V max(V a, V b) { return a > b ? a : b; }
+
+        static I bits(V a) { I i; std::memcpy(&i, &a, sizeof(i)); return i; }
+        static V from_bits(I i) { V a; std::memcpy(&a, &i, sizeof(a)); return a; }
+
+        // masks are all ones, or all zeros, in the bits of a float
+        static V gt(V a, V b) { return from_bits(a > b ? -1 : 0); }
+        static V and_(V a, V b) { return from_bits(bits(a) & bits(b)); }
+        static V or_(V a, V b) { return from_bits(bits(a) | bits(b)); }
+        static V andnot(V a, V b) { return from_bits(~bits(a) & bits(b)); }
+        static V select(V mask, V a, V b) { return bits(mask) ? a : b; }
+
+        static I iset1(int32_t x) { return x; }
+        static I iadd(I a, I b) { return a + b; }
+        static I isub(I a, I b) { return a - b; }
+        static I iand(I a, I b) { return a & b; }
+        static I ior(I a, I b) { return a | b; }
+        template <int n> static I shl(I a) { return static_cast<I>(static_cast<uint32_t>(a) << n); }
+        template <int n> static I shr(I a) { return static_cast<I>(static_cast<uint32_t>(a) >> n); }
+        static I to_int(V a) { return static_cast<I>(a); }  // truncates
+        static V to_float(I a) { return static_cast<V>(a); }
+    };
+
+    // rounds to nearest, for |x| < 2^22
+    template <typename S>
+    inline typename S::V Round(typename S::V x)
+    {
+        const typename S::V magic = S::set1(12582912.f);    // 1.5 * 2^23
+        return S::sub(S::add(x, magic), magic);
+    }
+
+    template <typename S>
+    inline typename S::V PhaseWrap(typename S::V x)
+    {
+        using V = typename S::V;
+        V r = Round<S>(x);
+        V floor = S::sub(r, S::and_(S::gt(r, x), S::set1(1.f)));
+        return S::sub(x, floor);
+    }
+
+    // sin(2 pi t): reduce to a quarter turn about zero, then a degree 11 polynomial
+    template <typename S>
+    inline typename S::V SinTurns(typename S::V t)
+    {
+        using V = typename S::V;
+        V r = S::sub(t, Round<S>(t));                           // [-0.5, 0.5]
+        V half = S::or_(S::set1(0.5f), S::and_(r, S::set1(-0.f)));
+        V a = S::andnot(S::set1(-0.f), r);
+        r = S::select(S::gt(a, S::set1(0.25f)), S::sub(half, r), r);  // [-0.25, 0.25]
+
+        V r2 = S::mul(r, r);
+        V p = S::set1(-15.094642576822984f);
+        p = S::add(S::mul(p, r2), S::set1(42.058693944897634f));
+        p = S::add(S::mul(p, r2), S::set1(-76.70585975306136f));
+        p = S::add(S::mul(p, r2), S::set1(81.60524927607504f));
+        p = S::add(S::mul(p, r2), S::set1(-41.341702240399755f));
+        p = S::add(S::mul(p, r2), S::set1(6.283185307179586f));
+        return S::mul(p, r);
+    }
+
+    // 2^x: 2^round(x) from the exponent bits, times a degree 6 polynomial for the fraction
+    template <typename S>
+    inline typename S::V Exp2(typename S::V x)
+    {
+        using V = typename S::V;
+        using I = typename S::I;
+        x = S::min(S::max(x, S::set1(-126.f)), S::set1(126.f));
+        V i = Round<S>(x);
+        V f = S::sub(x, i);                                     // [-0.5, 0.5]
+
+        V p = S::set1(0.00015403530393381606f);
+        p = S::add(S::mul(p, f), S::set1(0.0013333558146428441f));
+        p = S::add(S::mul(p, f), S::set1(0.009618129107628477f));
+        p = S::add(S::mul(p, f), S::set1(0.055504108664821576f));
+        p = S::add(S::mul(p, f), S::set1(0.2402265069591007f));
+        p = S::add(S::mul(p, f), S::set1(0.6931471805599453f));
+        p = S::add(S::mul(p, f), S::set1(1.f));
+
+        I e = S::template shl<23>(S::iadd(S::to_int(i), S::iset1(127)));
+        return S::mul(p, S::from_bits(e));
+    }
+
+    // log2(x): the exponent bits, plus a series in (m - 1) / (m + 1) for the mantissa m
+    template <typename S>
+    inline typename S::V Log2(typename S::V x)
+    {
+        using V = typename S::V;
+        using I = typename S::I;
+        I b = S::bits(x);
+        I e = S::isub(S::template shr<23>(b), S::iset1(127));
+        V m = S::from_bits(S::ior(S::iand(b, S::iset1(0x007fffff)), S::iset1(0x3f800000)));   // [1, 2)
+
+        V big = S::gt(m, S::set1(1.41421356f));
+        m = S::select(big, S::mul(m, S::set1(0.5f)), m);   // [0.707, 1.414]
+        V exponent = S::add(S::to_float(e), S::and_(big, S::set1(1.f)));
+
+        V s = S::div(S::sub(m, S::set1(1.f)), S::add(m, S::set1(1.f)));
+        V s2 = S::mul(s, s);
+        V p = S::set1(0.4121985831111324f);
+        p = S::add(S::mul(p, s2), S::set1(0.5770780163555853f));
+        p = S::add(S::mul(p, s2), S::set1(0.9617966939259756f));
+        p = S::add(S::mul(p, s2), S::set1(2.8853900817779268f));
+        return S::add(exponent, S::mul(p, s));
+    }
+
+    template <typename S>
+    inline typename S::V Tanh(typename S::V x)
+    {
+        using V = typename S::V;
+        x = S::min(S::max(x, S::set1(-9.f)), S::set1(9.f));
+        V e = Exp2<S>(S::mul(x, S::set1(2.8853900817779268f)));   // e^2x
+        return S::div(S::sub(e, S::set1(1.f)), S::add(e, S::set1(1.f)));
+    }
+
+    template <typename S>
+    inline typename S::V SoftClip(typename S::V x)
+    {
+        x = S::min(S::max(x, S::set1(-1.f)), S::set1(1.f));
+        return S::mul(x, S::sub(S::set1(1.5f), S::mul(S::set1(0.5f), S::mul(x, x))));
+    }
+}
+
+inline float FastPhaseWrap(float x) { return fastmath_detail::PhaseWrap<fastmath_detail::ScalarOps>(x); }
+inline float FastSinTurns(float t) { return fastmath_detail::SinTurns<fastmath_detail::ScalarOps>(t); }
+inline float FastCosTurns(float t) { return FastSinTurns(t + 0.25f); }
+inline float FastSin(float x) { return FastSinTurns(x * 0.15915494309189535f); }
+inline float FastCos(float x) { return FastCosTurns(x * 0.15915494309189535f); }
+inline float FastExp2(float x) { return fastmath_detail::Exp2<fastmath_detail::ScalarOps>(x); }
+inline float FastLog2(float x) { return fastmath_detail::Log2<fastmath_detail::ScalarOps>(x); }
+inline float FastPow(float x, float y) { return FastExp2(y * FastLog2(x)); }
+inline float FastTanh(float x) { return fastmath_detail::Tanh<fastmath_detail::ScalarOps>(x); }
+inline float FastSoftClip(float x) { return fastmath_detail::SoftClip<fastmath_detail::ScalarOps>(x); }
+
+// the frequency of a midi note, equal tempered with A4, note 69, at 440 Hz
+inline float FastMidiToFrequency(float note) { return 440.f * FastExp2((note - 69.f) * (1.f / 12.f)); }
+
+// Block versions, out[i] = f(in[i]) for n values. in and out may be the same array.
+void FastSinTurnsBlock(const float* turns, float* out, int n);
+void FastCosTurnsBlock(const float* turns, float* out, int n);
+void FastSinBlock(const float* x, float* out, int n);
+void FastExp2Block(const float* x, float* out, int n);
+void FastTanhBlock(const float* x, float* out, int n);
+void FastSoftClipBlock(const float* x, float* out, int n);
+void FastPhaseWrapBlock(const float* x, float* out, int n);
+
+// out[i] = start + i * step, computed without accumulating rounding error, for the phase or
+// time of each sample in a block
+void FastRamp(float start, float step, float* out, int n);
+
+// out[i] += in[i] * gain, for mixing a source into a bus
+void FastMulAddBlock(const float* in, float gain, float* out, int n);
+
+// the instruction set the block versions were built for: "avx2", "sse2", "neon" or "scalar"
+const char* FastMathIsa();
+
+// Sets flush to zero, and on x86 denormals are zero, for the calling thread, as the audio
+// device does for the render thread. Threads that render on its behalf should call it once
+// when they start, or decaying filters and reverb tails slow to a crawl in denormals.
+void DisableDenormals();
+
+#endif
@@ -0,0 +1,251 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "Fft.h"
+
+#include <cmath>
+#include <utility>
+
+RealFft::RealFft(int size)
+    : _size(size)
+    , _half(size / 2)
+    , _bit_reverse(_half)
+    , _cos(_half / 2 + 1)
+    , _sin(_half / 2 + 1)
+    , _split_cos(_half + 1)
+    , _split_sin(_half + 1)
+    , _re(_half + 1)
+    , _im(_half + 1)
+{
+    int bits = 0;
+    while ((1 << bits) < _half)
+        ++bits;
+    for (int i = 0; i < _half; ++i)
+    {
+        int r = 0;
+        for (int b = 0; b < bits; ++b)
+            if (i & (1 << b))
+                r |= 1 << (bits - 1 - b);
+        _bit_reverse[i] = r;
+    }
+
+    // in double, so that large transforms don't accumulate the error of the tables
+    const double pi = 3.14159265358979323846;
+    for (int i = 0; i <= _half / 2; ++i)
+    {
+        _cos[i] = static_cast<float>(std::cos(2.0 * pi * i / _half));
+        _sin[i] = static_cast<float>(std::sin(2.0 * pi * i / _half));
+    }
+    for (int i = 0; i <= _half; ++i)
+    {
+        _split_cos[i] = static_cast<float>(std::cos(2.0 * pi * i / _size));
+        _split_sin[i] = static_cast<float>(std::sin(2.0 * pi * i / _size));
+    }
+}
+
+void RealFft::transform(float* re, float* im, bool inverse) const
+{
+    const int n = _half;
+    for (int i = 0; i < n; ++i)
+    {
+        const int j = _bit_reverse[i];
+        if (j > i)
+        {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+
+    // iterative radix 2, decimated in time. The twiddle for a butterfly is e^-2πij/len,
+    // or its conjugate for the inverse.
+    const float sign = inverse ? 1.f : -1.f;
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        const int half = len >> 1;
+        const int step = n / len;
+        for (int j = 0; j < half; ++j)
+        {
+            const float wr = _cos[j * step];
+            const float wi = sign * _sin[j * step];
+            for (int i = j; i < n; i += len)
+            {
+                const int k = i + half;
+                const float tr = re[k] * wr - im[k] * wi;
+                const float ti = re[k] * wi + im[k] * wr;
+                re[k] = re[i] - tr;
+                im[k] = im[i] - ti;
+                re[i] += tr;
+                im[i] += ti;
+            }
+        }
+    }
+}
+
+namespace
+{
+    // a butterfly of each of RealFft::Lanes transforms. The rows never overlap, which
+    // __restrict tells the compiler, so that it vectorizes the lanes.
+    inline void ButterflyLanes(float* __restrict ar, float* __restrict ai, float* __restrict br, float* __restrict bi, float wr, float wi)
+    {
+        for (int l = 0; l < RealFft::Lanes; ++l)
+        {
+            const float tr = br[l] * wr - bi[l] * wi;
+            const float ti = br[l] * wi + bi[l] * wr;
+            br[l] = ar[l] - tr;
+            bi[l] = ai[l] - ti;
+            ar[l] += tr;
+            ai[l] += ti;
+        }
+    }
+
+    // a row of each of RealFft::Lanes transforms, packed from a row of even samples and a
+    // row of odd ones
+    inline void PackLanes(const float* __restrict even, const float* __restrict odd, float* __restrict re, float* __restrict im)
+    {
+        for (int l = 0; l < RealFft::Lanes; ++l)
+        {
+            re[l] = even[l];
+            im[l] = odd[l];
+        }
+    }
+
+    // bin k of each of RealFft::Lanes spectra, separated from rows k and n - k of the
+    // transforms as forward() separates them
+    inline void SplitLanes(const float* __restrict ar, const float* __restrict ai, const float* __restrict br, const float* __restrict bi,
+                           float wr, float wi, float* __restrict re, float* __restrict im)
+    {
+        for (int l = 0; l < RealFft::Lanes; ++l)
+        {
+            const float er = 0.5f * (ar[l] + br[l]), ei = 0.5f * (ai[l] - bi[l]);
+            const float or_ = 0.5f * (ai[l] + bi[l]), oi = -0.5f * (ar[l] - br[l]);
+            re[l] = er + or_ * wr - oi * wi;
+            im[l] = ei + or_ * wi + oi * wr;
+        }
+    }
+
+    // the first two passes of the transform over four rows at once, whose twiddles are 1
+    // and -i, so they need no multiplies
+    inline void Radix4Lanes(float* __restrict re, float* __restrict im)
+    {
+        const int L = RealFft::Lanes;
+        for (int l = 0; l < L; ++l)
+        {
+            const float t0r = re[l] + re[L + l], t0i = im[l] + im[L + l];
+            const float t1r = re[l] - re[L + l], t1i = im[l] - im[L + l];
+            const float t2r = re[2 * L + l] + re[3 * L + l], t2i = im[2 * L + l] + im[3 * L + l];
+            const float t3r = re[2 * L + l] - re[3 * L + l], t3i = im[2 * L + l] - im[3 * L + l];
+            re[l] = t0r + t2r;
+            im[l] = t0i + t2i;
+            re[2 * L + l] = t0r - t2r;
+            im[2 * L + l] = t0i - t2i;
+            re[L + l] = t1r + t3i;
+            im[L + l] = t1i - t3r;
+            re[3 * L + l] = t1r - t3i;
+            im[3 * L + l] = t1i + t3r;
+        }
+    }
+}
+
+// as transform(), forward only, of input already in bit reversed order, with each butterfly
+// applied to every lane
+void RealFft::transformLanes(float* re, float* im) const
+{
+    const int n = _half;
+    int len = 2;
+    if (n >= 4)
+    {
+        for (int i = 0; i < n; i += 4)
+            Radix4Lanes(re + i * Lanes, im + i * Lanes);
+        len = 8;
+    }
+
+    for (; len <= n; len <<= 1)
+    {
+        const int half = len >> 1;
+        const int step = n / len;
+        for (int j = 0; j < half; ++j)
+        {
+            const float wr = _cos[j * step];
+            const float wi = -_sin[j * step];
+            for (int i = j; i < n; i += len)
+                ButterflyLanes(re + i * Lanes, im + i * Lanes, re + (i + half) * Lanes, im + (i + half) * Lanes, wr, wi);
+        }
+    }
+}
+
+void RealFft::forward(const float* in, float* re, float* im)
+{
+    // pack the even samples as the real part and the odd as the imaginary, and transform
+    const int n = _half;
+    for (int i = 0; i < n; ++i)
+    {
+        _re[i] = in[2 * i];
+        _im[i] = in[2 * i + 1];
+    }
+    transform(_re.data(), _im.data(), false);
+    _re[n] = _re[0];
+    _im[n] = _im[0];
+
+    // separate the spectra of the even and odd samples, E and O, and combine them as
+    // X[k] = E[k] + e^-2πik/size O[k]
+    for (int k = 0; k <= n; ++k)
+    {
+        const float ar = _re[k], ai = _im[k];
+        const float br = _re[n - k], bi = -_im[n - k];     // conjugate of Z[n - k]
+        const float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+        const float or_ = 0.5f * (ai - bi), oi = -0.5f * (ar - br);  // (a - b) / 2i
+        const float wr = _split_cos[k], wi = -_split_sin[k];
+        re[k] = er + or_ * wr - oi * wi;
+        im[k] = ei + or_ * wi + oi * wr;
+    }
+}
+
+void RealFft::forwardLanes(const float* in, float* re, float* im)
+{
+    const int n = _half;
+    if (_lanes_re.empty())
+    {
+        _lanes_re.resize(static_cast<size_t>(n + 1) * Lanes);
+        _lanes_im.resize(static_cast<size_t>(n + 1) * Lanes);
+    }
+
+    float* zr = _lanes_re.data();
+    float* zi = _lanes_im.data();
+    for (int i = 0; i < n; ++i)
+        PackLanes(in + 2 * i * Lanes, in + (2 * i + 1) * Lanes, zr + _bit_reverse[i] * Lanes, zi + _bit_reverse[i] * Lanes);
+    transformLanes(zr, zi);
+    for (int l = 0; l < Lanes; ++l)
+    {
+        zr[n * Lanes + l] = zr[l];
+        zi[n * Lanes + l] = zi[l];
+    }
+
+    for (int k = 0; k <= n; ++k)
+        SplitLanes(zr + k * Lanes, zi + k * Lanes, zr + (n - k) * Lanes, zi + (n - k) * Lanes,
+                   _split_cos[k], -_split_sin[k], re + k * Lanes, im + k * Lanes);
+}
+
+void RealFft::inverse(const float* re, const float* im, float* out)
+{
+    // recover E and O from X, recombine them as Z = E + iO, and transform back
+    const int n = _half;
+    for (int k = 0; k < n; ++k)
+    {
+        const float ar = re[k], ai = im[k];
+        const float br = re[n - k], bi = -im[n - k];       // conjugate of X[n - k]
+        const float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+        const float dr = 0.5f * (ar - br), di = 0.5f * (ai - bi);
+        const float wr = _split_cos[k], wi = _split_sin[k];
+        const float or_ = dr * wr - di * wi, oi = dr * wi + di * wr;
+        _re[k] = er - oi;
+        _im[k] = ei + or_;
+    }
+    transform(_re.data(), _im.data(), true);
+
+    const float scale = 1.f / n;
+    for (int i = 0; i < n; ++i)
+    {
+        out[2 * i] = _re[i] * scale;
+        out[2 * i + 1] = _im[i] * scale;
+    }
+}
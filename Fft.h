@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_FFT_H
+#define LABSOUNDDEMO_FFT_H
+
+#include <vector>
+
+// A forward and inverse FFT of real signals, of a power of two size, for block convolution.
+// The real signal is transformed as a complex signal of half the size, so a transform costs
+// about half of a complex one. Spectra are kept as separate arrays of real and imaginary
+// parts, size / 2 + 1 bins each, which is the layout the convolver multiplies in.
+//
+// forwardLanes() transforms Lanes signals at once, interleaved so that each step of the
+// transform is the same operation on Lanes adjacent floats, which compilers vectorize. It
+// suits many short signals that are transformed together, such as a batch of sources.
+//
+// The tables are built by the constructor; the transforms don't allocate, but use scratch
+// space in the object, so an RealFft must only be used by one thread at a time.
+class RealFft
+{
+public:
+    enum : int { Lanes = 8 };
+
+private:
+    int _size;
+    int _half;
+    std::vector<int> _bit_reverse;      // of the half size transform
+    std::vector<float> _cos;            // twiddles of the half size transform
+    std::vector<float> _sin;
+    std::vector<float> _split_cos;      // twiddles separating the even and odd spectra
+    std::vector<float> _split_sin;
+    std::vector<float> _re;
+    std::vector<float> _im;
+    std::vector<float> _lanes_re;       // allocated by the first forwardLanes()
+    std::vector<float> _lanes_im;
+
+    void transform(float* re, float* im, bool inverse) const;
+    void transformLanes(float* re, float* im) const;
+
+public:
+    // identifies the algorithm, whose spectra may be kept on disk. Bump it when a change
+    // alters the values transforms produce.
+    enum : int { Version = 1 };
+
+    // size must be a power of two, at least 4
+    explicit RealFft(int size);
+
+    int size() const { return _size; }
+    int bins() const { return _half + 1; }
+
+    // in is size samples; re and im receive bins() values
+    void forward(const float* in, float* re, float* im);
+
+    // As forward, for Lanes signals interleaved: sample i of lane l is in[i * Lanes + l],
+    // and bin k of lane l is re[k * Lanes + l] and im[k * Lanes + l].
+    void forwardLanes(const float* in, float* re, float* im);
+
+    // re and im are bins() values; out receives size samples, scaled by 1 / size so that
+    // inverse(forward(x)) is x
+    void inverse(const float* re, const float* im, float* out);
+};
+
+#endif
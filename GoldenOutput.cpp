@@ -0,0 +1,310 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#if defined(_MSC_VER)
+    #if !defined(_CRT_SECURE_NO_WARNINGS)
+        #define _CRT_SECURE_NO_WARNINGS
+    #endif
+    #if !defined(NOMINMAX)
+        #define NOMINMAX
+    #endif
+#endif
+
+#include "GoldenOutput.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+using namespace lab;
+
+namespace
+{
+    const int FingerprintHopFrames = FingerprintWindowFrames / 2;
+    const int FingerprintBlockWindows = FingerprintBlockFrames / FingerprintHopFrames;
+    const double FingerprintLowestBand = 125.0;     // Hz, the upper edge of the first band
+
+    int BandOfFrequency(double hz)
+    {
+        if (hz < FingerprintLowestBand)
+            return 0;
+        return std::min(FingerprintBands - 1, 1 + static_cast<int>(std::floor(std::log2(hz / FingerprintLowestBand))));
+    }
+
+    std::string BandName(int band)
+    {
+        std::ostringstream name;
+        if (band == 0)
+            name << "below " << FingerprintLowestBand << " Hz";
+        else if (band == FingerprintBands - 1)
+            name << FingerprintLowestBand * (1 << (band - 1)) << " Hz and up";
+        else
+            name << FingerprintLowestBand * (1 << (band - 1)) << "-" << FingerprintLowestBand * (1 << band) << " Hz";
+        return name.str();
+    }
+}
+
+OutputFingerprintNode::OutputFingerprintNode(AudioContext& ac, uint64_t expected_frames,
+                                             std::shared_ptr<QuantumClockNode> gate, int channelCount)
+    : PassThroughInspectorNode(ac, *desc(), channelCount)
+    , _channels(std::max(1, channelCount))
+    , _fft(FingerprintWindowFrames)
+    , _window(FingerprintWindowFrames)
+    , _band_of_bin(_fft.bins())
+    , _history(static_cast<size_t>(_channels) * FingerprintWindowFrames)
+    , _windowed(FingerprintWindowFrames)
+    , _re(_fft.bins())
+    , _im(_fft.bins())
+    , _block_energy(static_cast<size_t>(_channels) * FingerprintBands)
+    , _gate(std::move(gate))
+{
+    // a periodic Hann window, whose copies overlapping by half sum to one, so every frame
+    // counts equally
+    const double pi = 3.14159265358979323846;
+    double sum_of_squares = 0;
+    for (int i = 0; i < FingerprintWindowFrames; ++i)
+    {
+        _window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / FingerprintWindowFrames));
+        sum_of_squares += static_cast<double>(_window[i]) * _window[i];
+    }
+
+    // by Parseval, the energy of a window's spectrum is its size times the energy of the
+    // windowed frames, which for a steady signal is its mean square times the window's
+    _scale = 1.0 / (static_cast<double>(FingerprintWindowFrames) * sum_of_squares);
+
+    const double hz_per_bin = static_cast<double>(ac.sampleRate()) / FingerprintWindowFrames;
+    for (int k = 0; k < _fft.bins(); ++k)
+        _band_of_bin[k] = BandOfFrequency(k * hz_per_bin);
+
+    _levels.reserve(static_cast<size_t>(expected_frames / FingerprintBlockFrames + 2) * _block_energy.size());
+    initialize();
+}
+
+AudioNodeDescriptor* OutputFingerprintNode::desc()
+{
+    static AudioNodeDescriptor d {nullptr, nullptr};
+    return &d;
+}
+
+void OutputFingerprintNode::process(ContextRenderLock& r, int bufferSize)
+{
+    if (_gate && _gate->released())
+    {
+        passThrough(r);
+        return;
+    }
+
+    AudioBus* inputBus = input(0)->bus(r);
+    const bool connected = inputBus && input(0)->isConnected();
+    const int inputChannels = connected ? static_cast<int>(inputBus->numberOfChannels()) : 0;
+
+    for (int i = 0; i < bufferSize; ++i)
+    {
+        for (int c = 0; c < inputChannels; ++c)
+        {
+            const float v = inputBus->channel(c)->data()[i];
+            const int16_t q = static_cast<int16_t>(std::lrint(std::max(-1.f, std::min(1.f, v)) * 32767.f));
+            _hash = (_hash ^ static_cast<uint16_t>(q)) * 1099511628211ull;     // FNV-1a prime
+        }
+    }
+
+    for (int i = 0; i < bufferSize;)
+    {
+        const int n = std::min(bufferSize - i, FingerprintWindowFrames - _filled);
+        for (int c = 0; c < _channels; ++c)
+        {
+            float* h = &_history[static_cast<size_t>(c) * FingerprintWindowFrames + _filled];
+            if (inputChannels)
+            {
+                const float* x = inputBus->channel(std::min(c, inputChannels - 1))->data() + i;
+                std::copy(x, x + n, h);
+            }
+            else
+                std::fill(h, h + n, 0.f);
+        }
+
+        _filled += n;
+        i += n;
+        if (_filled == FingerprintWindowFrames)
+            analyze();
+    }
+
+    passThrough(r);
+}
+
+void OutputFingerprintNode::analyze()
+{
+    const int bins = _fft.bins();
+    for (int c = 0; c < _channels; ++c)
+    {
+        float* h = &_history[static_cast<size_t>(c) * FingerprintWindowFrames];
+        for (int i = 0; i < FingerprintWindowFrames; ++i)
+            _windowed[i] = h[i] * _window[i];
+        _fft.forward(_windowed.data(), _re.data(), _im.data());
+
+        double* energy = &_block_energy[static_cast<size_t>(c) * FingerprintBands];
+        for (int k = 0; k < bins; ++k)
+        {
+            // the bins between DC and Nyquist stand for their negative frequencies as well
+            const double weight = (k == 0 || k == bins - 1) ? 1.0 : 2.0;
+            energy[_band_of_bin[k]] += weight * (static_cast<double>(_re[k]) * _re[k] + static_cast<double>(_im[k]) * _im[k]);
+        }
+
+        // the next window starts half way through this one
+        std::copy(h + FingerprintHopFrames, h + FingerprintWindowFrames, h);
+    }
+    _filled = FingerprintHopFrames;
+
+    if (++_block_windows < FingerprintBlockWindows)
+        return;
+
+    if (_levels.size() + _block_energy.size() <= _levels.capacity())
+    {
+        for (double e : _block_energy)
+            _levels.push_back(static_cast<float>(std::sqrt(e * _scale / FingerprintBlockWindows)));
+    }
+    std::fill(_block_energy.begin(), _block_energy.end(), 0.0);
+    _block_windows = 0;
+}
+
+// Each line of a fingerprints file is
+//
+//   name seconds samplerate hash channels levels...
+//
+// with the hash in hex, and each line of a budgets file is
+//
+//   name seconds samplerate budget_ms
+//
+// Lines starting with # are comments.
+
+std::vector<OutputFingerprint> ReadFingerprints(const std::string& path)
+{
+    std::vector<OutputFingerprint> fingerprints;
+    std::ifstream file(path);
+    if (!file)
+        return fingerprints;
+
+    std::string line;
+    for (int line_number = 1; std::getline(file, line); ++line_number)
+    {
+        std::istringstream fields(line);
+        OutputFingerprint f;
+        if (!(fields >> f.name) || f.name[0] == '#')
+            continue;
+
+        const std::string where = path + ":" + std::to_string(line_number) + ": ";
+        if (!(fields >> f.seconds >> f.samplerate >> std::hex >> f.hash >> std::dec >> f.channels) || f.channels < 1)
+            throw std::runtime_error(where + "expected name, seconds, samplerate, hash and channels");
+
+        float v;
+        while (fields >> v)
+            f.levels.push_back(v);
+        if (f.levels.size() % (static_cast<size_t>(f.channels) * FingerprintBands))
+            throw std::runtime_error(where + "expected " + std::to_string(FingerprintBands) + " levels per channel per block");
+
+        fingerprints.push_back(f);
+    }
+    return fingerprints;
+}
+
+void WriteFingerprints(const std::string& path, std::vector<OutputFingerprint> const& fingerprints)
+{
+    std::ofstream file(path);
+    if (!file)
+        throw std::runtime_error("couldn't write " + path);
+
+    file << "# Output fingerprints of the LabSoundDemo examples and the graphs of DemoGraphs.h, see\n";
+    file << "# GoldenOutput.h. Written by LabSoundBench --update-fingerprints; a change that means to\n";
+    file << "# alter what something renders records its fingerprint again, in the same commit.\n";
+    file << "#\n";
+    file << "# name seconds samplerate hash channels rms_per_block_channel_and_band...\n";
+    for (auto& f : fingerprints)
+    {
+        file << f.name << " " << f.seconds << " " << f.samplerate << " "
+             << std::hex << f.hash << std::dec << " " << f.channels;
+        for (float v : f.levels)
+            file << " " << v;
+        file << "\n";
+    }
+}
+
+std::vector<RenderBudget> ReadBudgets(const std::string& path)
+{
+    std::vector<RenderBudget> budgets;
+    std::ifstream file(path);
+    if (!file)
+        return budgets;
+
+    std::string line;
+    for (int line_number = 1; std::getline(file, line); ++line_number)
+    {
+        std::istringstream fields(line);
+        RenderBudget b;
+        if (!(fields >> b.name) || b.name[0] == '#')
+            continue;
+
+        if (!(fields >> b.seconds >> b.samplerate >> b.budget_ms))
+            throw std::runtime_error(path + ":" + std::to_string(line_number) + ": expected name, seconds, samplerate and budget");
+
+        budgets.push_back(b);
+    }
+    return budgets;
+}
+
+void WriteBudgets(const std::string& path, std::vector<RenderBudget> const& budgets)
+{
+    std::ofstream file(path);
+    if (!file)
+        throw std::runtime_error("couldn't write " + path);
+
+    file << "# written by LabSoundBench --update-budgets, for this machine only\n";
+    file << "# name seconds samplerate budget_ms\n";
+    for (auto& b : budgets)
+        file << b.name << " " << b.seconds << " " << b.samplerate << " " << b.budget_ms << "\n";
+}
+
+std::string CompareFingerprints(OutputFingerprint const& expected, OutputFingerprint const& actual, double tolerance)
+{
+    if (actual.hash == expected.hash)
+        return {};
+
+    if (actual.channels != expected.channels)
+        return "channel count changed";
+    if (actual.levels.size() != expected.levels.size())
+        return "output length changed";
+
+    float peak = 0;
+    for (float v : expected.levels)
+        peak = std::max(peak, v);
+
+    // silence must stay silent to within the 16 bit quantization
+    const double allowed = std::max(static_cast<double>(peak) * tolerance, 1.0 / 32768.0);
+
+    // report the worst level, since the first is often only the edge of the change
+    size_t worst = 0;
+    double worst_diff = 0;
+    for (size_t i = 0; i < actual.levels.size(); ++i)
+    {
+        const double diff = std::fabs(actual.levels[i] - expected.levels[i]);
+        if (diff > worst_diff)
+        {
+            worst = i;
+            worst_diff = diff;
+        }
+    }
+
+    if (worst_diff <= allowed)
+        return {};
+
+    const size_t per_block = static_cast<size_t>(expected.channels) * FingerprintBands;
+    const size_t block = worst / per_block;
+    const int channel = static_cast<int>(worst % per_block) / FingerprintBands;
+    const int band = static_cast<int>(worst % FingerprintBands);
+
+    std::ostringstream why;
+    why << "channel " << channel << ", " << BandName(band) << ", is " << actual.levels[worst]
+        << " rather than " << expected.levels[worst] << " at "
+        << static_cast<double>(block) * FingerprintBlockFrames / expected.samplerate << " s";
+    return why.str();
+}
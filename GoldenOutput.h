@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_GOLDENOUTPUT_H
+#define LABSOUNDDEMO_GOLDENOUTPUT_H
+
+#include "LabSound/LabSound.h"
+#include "Fft.h"
+#include "OfflineRender.h"
+#include "PassThroughInspectorNode.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Golden outputs pin down what each example and graph renders, and how long it takes, so
+// that changes to the DSP can be checked against the sound and speed they had before. The
+// two are kept in separate files. Output fingerprints depend only on the code, so they are
+// committed, in fingerprints.txt beside the sources. Render budgets depend on the machine,
+// so they are recorded on the machine that checks them.
+//
+// A render's fingerprint is a hash of its samples, quantized to 16 bits, and the level of
+// each channel in each of FingerprintBands octave bands, over consecutive blocks of
+// FingerprintBlockFrames. Identical hashes mean identical output. When the hashes differ,
+// the levels are compared within a tolerance, so that changes in rounding pass, while a
+// change of pitch, filtering, mix or timing moves energy between bands or blocks and fails.
+
+// the levels are measured with Hann windows of this many frames, overlapping by half
+const int FingerprintWindowFrames = 1024;
+const int FingerprintBlockFrames = 8192;
+const int FingerprintBands = 8;     // octaves up from 125 Hz, with everything below in the first
+
+// OutputFingerprintNode is a PassThroughInspectorNode that fingerprints everything it renders.
+class OutputFingerprintNode : public PassThroughInspectorNode
+{
+    uint64_t _hash = 14695981039346656037ull;   // FNV-1a offset basis
+    int _channels;
+    RealFft _fft;
+    std::vector<float> _window;
+    std::vector<int> _band_of_bin;
+    double _scale;                              // from a window's spectrum to its mean square
+
+    std::vector<float> _history;                // the window being filled, per channel
+    int _filled = 0;
+    std::vector<float> _windowed;
+    std::vector<float> _re;
+    std::vector<float> _im;
+    std::vector<double> _block_energy;          // per channel and band
+    int _block_windows = 0;
+    std::vector<float> _levels;
+    std::shared_ptr<QuantumClockNode> _gate;
+
+    void analyze();
+
+public:
+    // expected_frames reserves the levels, so the render thread doesn't allocate. channelCount
+    // channels are fingerprinted; a mono input is fingerprinted as each of them. Given the
+    // gated clock of a virtual clock's context, nothing rendered after the clock is released
+    // is fingerprinted, since the render runs on until the context is destroyed.
+    OutputFingerprintNode(lab::AudioContext& ac, uint64_t expected_frames,
+                          std::shared_ptr<QuantumClockNode> gate = nullptr, int channelCount = 2);
+    virtual ~OutputFingerprintNode() = default;
+
+    static const char* static_name() { return "OutputFingerprint"; }
+    virtual const char* name() const override { return static_name(); }
+    static lab::AudioNodeDescriptor* desc();
+
+    virtual void process(lab::ContextRenderLock&, int bufferSize) override;
+
+    // only valid once rendering has finished
+    uint64_t hash() const { return _hash; }
+    int channels() const { return _channels; }
+
+    // RMS level per block, channel and band, in that order of nesting. A final partial
+    // block is left out, so the levels depend only on whole blocks.
+    std::vector<float> const& levels() const { return _levels; }
+};
+
+struct OutputFingerprint
+{
+    std::string name;
+    double seconds = 0;
+    float samplerate = 0;
+    uint64_t hash = 0;
+    int channels = 0;
+    std::vector<float> levels;      // as OutputFingerprintNode::levels
+};
+
+struct RenderBudget
+{
+    std::string name;
+    double seconds = 0;
+    float samplerate = 0;
+    double budget_ms = 0;           // a render taking longer than this is a regression
+};
+
+// Both throw if the file exists but can't be parsed; a missing file reads as empty.
+std::vector<OutputFingerprint> ReadFingerprints(const std::string& path);
+void WriteFingerprints(const std::string& path, std::vector<OutputFingerprint> const& fingerprints);
+
+std::vector<RenderBudget> ReadBudgets(const std::string& path);
+void WriteBudgets(const std::string& path, std::vector<RenderBudget> const& budgets);
+
+// returns an empty string if actual matches expected, otherwise what differs. Levels match
+// if each is within tolerance of the expected level, relative to the expected peak level.
+std::string CompareFingerprints(OutputFingerprint const& expected, OutputFingerprint const& actual, double tolerance);
+
+#endif
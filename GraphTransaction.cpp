@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "GraphTransaction.h"
+#include "OfflineRender.h"
+
+using namespace lab;
+
+GraphTransaction& GraphTransaction::connect(std::shared_ptr<AudioNode> destination, std::shared_ptr<AudioNode> source,
+                                            int destinationIndex, int sourceIndex)
+{
+    Edit e;
+    e.op = Op::Connect;
+    e.destination = std::move(destination);
+    e.source = std::move(source);
+    e.destination_index = destinationIndex;
+    e.source_index = sourceIndex;
+    _edits.push_back(std::move(e));
+    return *this;
+}
+
+GraphTransaction& GraphTransaction::disconnect(std::shared_ptr<AudioNode> destination, std::shared_ptr<AudioNode> source,
+                                               int destinationIndex, int sourceIndex)
+{
+    Edit e;
+    e.op = Op::Disconnect;
+    e.destination = std::move(destination);
+    e.source = std::move(source);
+    e.destination_index = destinationIndex;
+    e.source_index = sourceIndex;
+    _edits.push_back(std::move(e));
+    return *this;
+}
+
+GraphTransaction& GraphTransaction::disconnect(std::shared_ptr<AudioNode> node, int sourceIndex)
+{
+    // a null destination disconnects the output from everything it feeds
+    return disconnect(nullptr, std::move(node), 0, sourceIndex);
+}
+
+GraphTransaction& GraphTransaction::setValue(std::shared_ptr<AudioParam> param, float value)
+{
+    Edit e;
+    e.op = Op::SetValue;
+    e.param = std::move(param);
+    e.value = value;
+    _edits.push_back(std::move(e));
+    return *this;
+}
+
+GraphTransaction& GraphTransaction::start(std::shared_ptr<AudioNode> node, double when)
+{
+    Edit e;
+    e.op = Op::Start;
+    e.source = std::move(node);
+    e.value = when;
+    _edits.push_back(std::move(e));
+    return *this;
+}
+
+bool GraphTransaction::issue()
+{
+    bool connections = false;
+    for (Edit& e : _edits)
+    {
+        switch (e.op)
+        {
+        case Op::Connect:
+            _ac.connect(e.destination, e.source, e.destination_index, e.source_index);
+            connections = true;
+            break;
+
+        case Op::Disconnect:
+            _ac.disconnect(e.destination, e.source, e.destination_index, e.source_index);
+            connections = true;
+            break;
+
+        case Op::SetValue:
+            e.param->setValue(static_cast<float>(e.value));
+            break;
+
+        case Op::Start:
+            e.source->_scheduler.start(e.value);
+            break;
+        }
+    }
+    _edits.clear();
+    return connections;
+}
+
+void GraphTransaction::commit(bool wait)
+{
+    if (_edits.empty())
+        return;
+
+    bool connections = false;
+    {
+        // no quantum renders while the lock is held, so the context applies all of the
+        // connections at its next update
+        ContextRenderLock r(&_ac, "GraphTransaction");
+        connections = issue();
+    }
+
+    if (wait && connections)
+        _ac.synchronizeConnections();
+}
+
+void GraphTransaction::commit(QuantumClockNode& gate)
+{
+    if (_edits.empty())
+        return;
+
+    // the held render thread already owns the render lock, and renders nothing until the
+    // gate opens again
+    if (!gate.runHeld([this](ContextRenderLock&) { issue(); }))
+        issue();
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_GRAPHTRANSACTION_H
+#define LABSOUNDDEMO_GRAPHTRANSACTION_H
+
+#include "LabSound/LabSound.h"
+
+#include <memory>
+#include <vector>
+
+class QuantumClockNode;
+
+// GraphTransaction batches edits to a context's graph, so that they reach the render thread
+// together. Connecting or disconnecting an edge and then synchronizing, one edge at a time,
+// costs a round trip to the render thread per edge, and lets the render thread see the
+// graph half edited; switching between two graphs of a few dozen edges takes as many
+// quanta, some of them with both graphs connected or neither.
+//
+// Edges, param values and node starts are recorded, and nothing happens until commit().
+// commit() issues every edit while holding the context's render lock, so no quantum renders
+// between the edits, and the context applies the connections together at its next update.
+// Values and starts apply as they are issued, so they can be heard up to an update before
+// the connections. Then commit() waits, once, for the connections to take effect.
+//
+// The render thread of a context stepped by a gated QuantumClockNode holds the render lock
+// at the gate, so commit(gate) has the held render thread issue the edits instead.
+//
+// A transaction that is destroyed without being committed is discarded.
+class GraphTransaction
+{
+    enum class Op { Connect, Disconnect, SetValue, Start };
+
+    struct Edit
+    {
+        Op op;
+        std::shared_ptr<lab::AudioNode> destination;
+        std::shared_ptr<lab::AudioNode> source;
+        std::shared_ptr<lab::AudioParam> param;
+        int destination_index = 0;
+        int source_index = 0;
+        double value = 0;
+    };
+
+    lab::AudioContext& _ac;
+    std::vector<Edit> _edits;
+
+    // returns whether any edit was a connection
+    bool issue();
+
+public:
+    explicit GraphTransaction(lab::AudioContext& ac) : _ac(ac) {}
+
+    GraphTransaction& connect(std::shared_ptr<lab::AudioNode> destination, std::shared_ptr<lab::AudioNode> source,
+                              int destinationIndex = 0, int sourceIndex = 0);
+    GraphTransaction& disconnect(std::shared_ptr<lab::AudioNode> destination, std::shared_ptr<lab::AudioNode> source,
+                                 int destinationIndex = 0, int sourceIndex = 0);
+
+    // disconnects everything the node's output feeds
+    GraphTransaction& disconnect(std::shared_ptr<lab::AudioNode> node, int sourceIndex = 0);
+
+    GraphTransaction& setValue(std::shared_ptr<lab::AudioParam> param, float value);
+
+    // starts a scheduled node at when, in the context's time
+    GraphTransaction& start(std::shared_ptr<lab::AudioNode> node, double when = 0);
+
+    size_t size() const { return _edits.size(); }
+    bool empty() const { return _edits.empty(); }
+
+    // Applies the edits, and clears the transaction so it can be reused. If wait is true,
+    // returns once the context has made the connections.
+    void commit(bool wait = true);
+
+    // Applies the edits on the render thread held at the gate, without taking the render
+    // lock or waiting; the connections take effect at the context's next update. Falls back
+    // to issuing them directly if the gate was released, as nothing renders after that.
+    void commit(QuantumClockNode& gate);
+};
+
+#endif
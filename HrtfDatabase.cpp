@@ -0,0 +1,378 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#if defined(_MSC_VER)
+    #if !defined(_CRT_SECURE_NO_WARNINGS)
+        #define _CRT_SECURE_NO_WARNINGS
+    #endif
+    #if !defined(NOMINMAX)
+        #define NOMINMAX
+    #endif
+#endif
+
+#include "HrtfDatabase.h"
+#include "Fft.h"
+#include "MappedAudioFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+using namespace lab;
+
+namespace
+{
+    const size_t lshr_header_size = 64;
+    const size_t lshr_rate_size = 32;
+    const uint32_t lshr_version = 1;
+    const size_t lshr_alignment = 64;
+
+    // the grid of the IRCAM sets
+    const int AzimuthStep = 15;
+    const int FirstElevation = -45;
+    const int ElevationStep = 15;
+    const int Elevations = 10;
+
+    // a response starts where it first reaches this fraction of its peak. A few frames
+    // before that are kept, so the onset isn't cut short.
+    const float OnsetThreshold = 0.1f;
+    const int PreRoll = 4;
+
+    // the end of a kernel is faded out over this many frames
+    const int FadeLength = 16;
+
+    void put_u32(uint8_t* p, uint32_t v) { memcpy(p, &v, 4); }
+    uint32_t get_u32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+    float get_f32(const uint8_t* p) { float v; memcpy(&v, p, 4); return v; }
+    uint64_t get_u64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+    size_t Align(size_t offset) { return (offset + lshr_alignment - 1) / lshr_alignment * lshr_alignment; }
+
+    // at least 5 ms of response from the onset, as LabSound's own HRTF kernels hold
+    int KernelLength(float sampleRate)
+    {
+        int length = 2 * HrtfDatabase::Block;
+        while (length < sampleRate * 0.005f)
+            length *= 2;
+        return length;
+    }
+
+    int Onset(const float* h, int length)
+    {
+        float peak = 0;
+        for (int i = 0; i < length; ++i)
+            peak = std::max(peak, std::fabs(h[i]));
+        for (int i = 0; i < length; ++i)
+            if (std::fabs(h[i]) >= peak * OnsetThreshold)
+                return i;
+        return 0;
+    }
+
+    bool FileExists(const std::string& path)
+    {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f)
+            return false;
+        fclose(f);
+        return true;
+    }
+
+    std::mutex open_mutex;
+    std::map<std::string, std::weak_ptr<const HrtfDatabase>> open_databases;
+}
+
+std::shared_ptr<const HrtfDatabase> HrtfDatabase::open(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(open_mutex);
+    auto it = open_databases.find(path);
+    if (it != open_databases.end())
+    {
+        if (std::shared_ptr<const HrtfDatabase> db = it->second.lock())
+            return db;
+    }
+
+    std::shared_ptr<MappedFile> file = MappedFile::open(path);
+    if (!file || file->size() < lshr_header_size)
+        return {};
+
+    const uint8_t* p = file->data();
+    const size_t size = file->size();
+    if (memcmp(p, "LSHR", 4) != 0 || get_u32(p + 4) != lshr_version || get_u32(p + 8) != Block
+        || get_u32(p + 36) != static_cast<uint32_t>(RealFft::Version))
+        return {};
+
+    auto db = std::make_shared<HrtfDatabase>();
+    db->_file = file;
+    db->_azimuths = static_cast<int>(get_u32(p + 12));
+    db->_elevations = static_cast<int>(get_u32(p + 16));
+    db->_azimuth_step = get_f32(p + 20);
+    db->_first_elevation = get_f32(p + 24);
+    db->_elevation_step = get_f32(p + 28);
+    const uint32_t rates = get_u32(p + 32);
+    if (db->_azimuths < 1 || db->_elevations < 2 || lshr_header_size + rates * lshr_rate_size > size)
+        return {};
+
+    const size_t points = static_cast<size_t>(db->points());
+    for (uint32_t r = 0; r < rates; ++r)
+    {
+        const uint8_t* entry = p + lshr_header_size + r * lshr_rate_size;
+        const int partitions = static_cast<int>(get_u32(entry + 4));
+        const uint64_t delays = get_u64(entry + 8);
+        const uint64_t kernels = get_u64(entry + 16);
+        const size_t kernelBytes = points * 2 * partitions * 2 * (Block + 1) * sizeof(float);
+        if (partitions < 1 || delays % lshr_alignment || kernels % lshr_alignment
+            || delays + points * 2 * sizeof(float) > size || kernels + kernelBytes > size)
+            return {};
+
+        Rate rate;
+        rate.sampleRate = get_f32(entry);
+        rate.partitions = partitions;
+        rate.delays = reinterpret_cast<const float*>(p + delays);
+        rate.kernels = reinterpret_cast<const float*>(p + kernels);
+        db->_rates.push_back(rate);
+    }
+
+    // drop the entries of databases that have since been closed, so the map doesn't grow
+    // with every path ever opened
+    for (auto e = open_databases.begin(); e != open_databases.end();)
+        e = e->second.expired() ? open_databases.erase(e) : std::next(e);
+
+    open_databases[path] = db;
+    return db;
+}
+
+void HrtfDatabase::compile(const std::string& directory, const std::string& subject, const std::vector<float>& sampleRates, const std::string& path)
+{
+    const int azimuths = 360 / AzimuthStep;
+    const int points = azimuths * Elevations;
+
+    // the measurement used for each grid point
+    std::vector<std::string> sources(points);
+    for (int a = 0; a < azimuths; ++a)
+    {
+        for (int e = 0; e < Elevations; ++e)
+        {
+            for (int m = e; m >= 0 && sources[e * azimuths + a].empty(); --m)
+            {
+                const int elevation = FirstElevation + m * ElevationStep;
+                char name[64];
+                snprintf(name, sizeof(name), "_C_R0195_T%03d_P%03d.wav", a * AzimuthStep, (elevation + 360) % 360);
+                const std::string source = directory + "/IRC_" + subject + name;
+                if (FileExists(source))
+                    sources[e * azimuths + a] = source;
+            }
+            if (sources[e * azimuths + a].empty())
+                throw std::runtime_error("no response in " + directory + " for azimuth " + std::to_string(a * AzimuthStep)
+                                         + " at or below elevation " + std::to_string(FirstElevation + e * ElevationStep));
+        }
+    }
+
+    struct Compiled
+    {
+        float sampleRate;
+        int partitions;
+        std::vector<float> delays;
+        std::vector<float> kernels;
+    };
+    std::vector<Compiled> compiled;
+
+    RealFft fft(2 * Block);
+    std::vector<float> padded(2 * Block);
+    for (float sampleRate : sampleRates)
+    {
+        Compiled c;
+        c.sampleRate = sampleRate;
+        const int length = KernelLength(sampleRate);
+        c.partitions = length / Block;
+        c.delays.resize(points * 2);
+        c.kernels.resize(static_cast<size_t>(points) * 2 * c.partitions * 2 * (Block + 1));
+
+        // grid points that share a measurement share its compiled kernels
+        std::map<std::string, int> done;
+        std::vector<float> kernel(length);
+        for (int point = 0; point < points; ++point)
+        {
+            const size_t stride = static_cast<size_t>(c.partitions) * 2 * (Block + 1);
+            auto it = done.find(sources[point]);
+            if (it != done.end())
+            {
+                std::copy(c.delays.begin() + 2 * it->second, c.delays.begin() + 2 * it->second + 2, c.delays.begin() + 2 * point);
+                std::copy(c.kernels.begin() + 2 * it->second * stride, c.kernels.begin() + 2 * (it->second + 1) * stride, c.kernels.begin() + 2 * point * stride);
+                continue;
+            }
+            done[sources[point]] = point;
+
+            std::shared_ptr<AudioBus> bus = MakeBusFromMappedFile(sources[point], sampleRate);
+            if (!bus)
+                bus = MakeBusFromFile(sources[point], false, sampleRate);
+            if (!bus || bus->numberOfChannels() < 2)
+                throw std::runtime_error("couldn't read a stereo response from " + sources[point]);
+
+            for (int ear = 0; ear < 2; ++ear)
+            {
+                const float* h = bus->channel(ear)->data();
+                const int frames = bus->length();
+                const int start = std::max(0, Onset(h, frames) - PreRoll);
+                c.delays[2 * point + ear] = static_cast<float>(start);
+
+                const int count = std::max(0, std::min(length, frames - start));
+                std::fill(kernel.begin(), kernel.end(), 0.f);
+                std::copy(h + start, h + start + count, kernel.begin());
+                for (int i = 0; i < FadeLength; ++i)
+                    kernel[length - FadeLength + i] *= 0.5f + 0.5f * std::cos(3.14159265f * (i + 1) / FadeLength);
+
+                for (int p = 0; p < c.partitions; ++p)
+                {
+                    std::copy(kernel.begin() + p * Block, kernel.begin() + (p + 1) * Block, padded.begin());
+                    std::fill(padded.begin() + Block, padded.end(), 0.f);
+                    float* dst = c.kernels.data() + (static_cast<size_t>(point) * 2 + ear) * stride + static_cast<size_t>(p) * 2 * (Block + 1);
+                    fft.forward(padded.data(), dst, dst + Block + 1);
+                }
+            }
+        }
+        compiled.push_back(std::move(c));
+    }
+
+    // lay the rates out after the header and the rate table
+    uint8_t header[lshr_header_size] = {};
+    memcpy(header, "LSHR", 4);
+    put_u32(header + 4, lshr_version);
+    put_u32(header + 8, Block);
+    put_u32(header + 12, azimuths);
+    put_u32(header + 16, Elevations);
+    const float azimuthStep = static_cast<float>(AzimuthStep);
+    const float firstElevation = static_cast<float>(FirstElevation);
+    const float elevationStep = static_cast<float>(ElevationStep);
+    memcpy(header + 20, &azimuthStep, 4);
+    memcpy(header + 24, &firstElevation, 4);
+    memcpy(header + 28, &elevationStep, 4);
+    put_u32(header + 32, static_cast<uint32_t>(compiled.size()));
+    put_u32(header + 36, RealFft::Version);
+
+    std::vector<uint8_t> table(compiled.size() * lshr_rate_size, 0);
+    std::vector<uint64_t> offsets;
+    size_t offset = Align(lshr_header_size + table.size());
+    for (size_t r = 0; r < compiled.size(); ++r)
+    {
+        const uint64_t delays = offset;
+        offset = Align(offset + compiled[r].delays.size() * sizeof(float));
+        const uint64_t kernels = offset;
+        offset = Align(offset + compiled[r].kernels.size() * sizeof(float));
+
+        uint8_t* entry = table.data() + r * lshr_rate_size;
+        memcpy(entry, &compiled[r].sampleRate, 4);
+        put_u32(entry + 4, static_cast<uint32_t>(compiled[r].partitions));
+        memcpy(entry + 8, &delays, 8);
+        memcpy(entry + 16, &kernels, 8);
+        offsets.push_back(delays);
+        offsets.push_back(kernels);
+    }
+
+    // written to a temporary file of this thread's own, renamed into place, so that a
+    // concurrent open never maps a partial database, and concurrent compiles of the same
+    // path don't write into one file
+    const std::string temp = UniqueTempPath(path);
+    FILE* f = fopen(temp.c_str(), "wb");
+    if (!f)
+        throw std::runtime_error("couldn't create " + path);
+
+    size_t written = 0;
+    auto write = [&](const void* data, size_t bytes) {
+        if (fwrite(data, 1, bytes, f) != bytes)
+            return false;
+        written += bytes;
+        return true;
+    };
+    auto pad = [&](size_t to) {
+        const std::vector<uint8_t> zeros(to - written, 0);
+        return write(zeros.data(), zeros.size());
+    };
+
+    bool ok = write(header, lshr_header_size) && write(table.data(), table.size());
+    for (size_t r = 0; ok && r < compiled.size(); ++r)
+    {
+        ok = pad(offsets[2 * r]) && write(compiled[r].delays.data(), compiled[r].delays.size() * sizeof(float))
+          && pad(offsets[2 * r + 1]) && write(compiled[r].kernels.data(), compiled[r].kernels.size() * sizeof(float));
+    }
+
+    ok = fclose(f) == 0 && ok && ReplaceFile(temp, path);
+    if (!ok)
+    {
+        remove(temp.c_str());
+        throw std::runtime_error("couldn't write " + path);
+    }
+}
+
+std::shared_ptr<const HrtfDatabase> HrtfDatabase::load(const std::string& directory, float sampleRate)
+{
+    std::string base = directory;
+    while (base.size() > 1 && (base.back() == '/' || base.back() == '\\'))
+        base.pop_back();
+
+    std::shared_ptr<const HrtfDatabase> db = open(base + ".lshr");
+    if (db && db->rate(sampleRate))
+        return db;
+
+    // one compiled earlier beside the directory, as the installed assets may hold one
+    const std::string beside = base + "." + std::to_string(static_cast<int>(sampleRate)) + ".lshr";
+    db = open(beside);
+    if (db && db->rate(sampleRate))
+        return db;
+
+    // the assets may be read only, so databases are compiled into the user's cache
+    const std::string cache = UserCacheDirectory();
+    const std::string path = cache.empty() ? beside : cache + "/" + CachedFileName(base, "." + std::to_string(static_cast<int>(sampleRate)) + ".lshr");
+    db = open(path);
+    if (db && db->rate(sampleRate))
+        return db;
+
+    db.reset();
+    compile(base, "Composite", { sampleRate }, path);
+    db = open(path);
+    if (!db || !db->rate(sampleRate))
+        throw std::runtime_error("couldn't open " + path + " after compiling it");
+    return db;
+}
+
+size_t HrtfDatabase::bytes() const
+{
+    return _file ? _file->size() : 0;
+}
+
+const HrtfDatabase::Rate* HrtfDatabase::rate(float sampleRate) const
+{
+    for (const Rate& r : _rates)
+        if (r.sampleRate == sampleRate)
+            return &r;
+    return nullptr;
+}
+
+HrtfDatabase::Neighbours HrtfDatabase::neighbours(float azimuth, float elevation) const
+{
+    float a = std::fmod(azimuth, 360.f) / _azimuth_step;
+    if (a < 0)
+        a += _azimuths;
+    const int a0 = std::min(static_cast<int>(a), _azimuths - 1);
+    const int a1 = (a0 + 1) % _azimuths;
+    const float fa = std::min(1.f, a - a0);
+
+    const float e = std::max(0.f, std::min(static_cast<float>(_elevations - 1), (elevation - _first_elevation) / _elevation_step));
+    const int e0 = std::min(static_cast<int>(e), _elevations - 2);
+    const float fe = e - e0;
+
+    Neighbours n;
+    n.points[0] = point(a0, e0);
+    n.points[1] = point(a1, e0);
+    n.points[2] = point(a0, e0 + 1);
+    n.points[3] = point(a1, e0 + 1);
+    n.weights[0] = (1 - fa) * (1 - fe);
+    n.weights[1] = fa * (1 - fe);
+    n.weights[2] = (1 - fa) * fe;
+    n.weights[3] = fa * fe;
+    return n;
+}
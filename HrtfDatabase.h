@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_HRTFDATABASE_H
+#define LABSOUNDDEMO_HRTFDATABASE_H
+
+#include "LabSound/LabSound.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+// HrtfDatabase is a set of head related impulse responses compiled into a single file by
+// LabSoundHrtfCompiler, ready to convolve. The directory of measured wav files is resampled
+// to each of a few common sample rates, and each response is split into the delay before
+// its onset and a kernel that starts at the onset, which is cut into quantum long
+// partitions and transformed, as ConvolutionImpulse does. Opening a database maps the file;
+// nothing is decoded or transformed, and the kernels are read in place.
+//
+// Responses are stored on a grid of azimuths, evenly spaced from straight ahead, and
+// elevations, evenly spaced from the lowest. Azimuths run counter-clockwise, as in the IRCAM
+// sets, so 90 degrees is to the left. Grid points that weren't measured, such as most of the
+// azimuths near the zenith, use the measurement at the same azimuth and the closest lower
+// elevation.
+//
+// The file holds native 32 bit values.
+//
+//   offset  size
+//   0       4     "LSHR"
+//   4       4     version, 1
+//   8       4     partition length in frames, HrtfDatabase::Block
+//   12      4     azimuth count
+//   16      4     elevation count
+//   20      4     azimuth step in degrees, float
+//   24      4     lowest elevation in degrees, float
+//   28      4     elevation step in degrees, float
+//   32      4     sample rate count
+//   36      4     RealFft::Version
+//   40      24    reserved, zero
+//   64            a 32 byte entry per sample rate:
+//                 0   4  sample rate, float
+//                 4   4  partitions per kernel
+//                 8   8  offset of the delays, a left and right delay in frames per point
+//                 16  8  offset of the kernels, per point, left then right, each partition's
+//                        real parts followed by its imaginary parts, Block + 1 bins each
+//                 24  8  reserved, zero
+//
+// The delays and kernels of each rate are 64 byte aligned.
+class HrtfDatabase
+{
+public:
+    enum : int
+    {
+        Block = lab::AudioNode::ProcessingSizeInFrames,
+    };
+
+    struct Rate
+    {
+        float sampleRate = 0;
+        int partitions = 0;
+        const float* delays = nullptr;
+        const float* kernels = nullptr;
+    };
+
+    // the grid points around a direction, and their weights, which sum to one
+    struct Neighbours
+    {
+        int points[4];
+        float weights[4];
+    };
+
+private:
+    std::shared_ptr<MappedFile> _file;
+    int _azimuths = 0;
+    int _elevations = 0;
+    float _azimuth_step = 0;
+    float _first_elevation = 0;
+    float _elevation_step = 0;
+    std::vector<Rate> _rates;
+
+public:
+    // Maps a compiled database. A database that is already open in this process is shared
+    // rather than mapped again. Returns nullptr if the file is missing, or isn't a database
+    // this build can use.
+    static std::shared_ptr<const HrtfDatabase> open(const std::string& path);
+
+    // Compiles the IRCAM style directory of responses, IRC_<subject>_C_R0195_T<azimuth>_P<elevation>.wav,
+    // into a database at path, with kernels for each of sampleRates. Throws if a response
+    // can't be read, or the database can't be written.
+    static void compile(const std::string& directory, const std::string& subject, const std::vector<float>& sampleRates, const std::string& path);
+
+    // Opens the database compiled from directory for sampleRate: directory.lshr, as
+    // LabSoundHrtfCompiler writes it by default, if it has the rate, or else a database of
+    // that rate alone, directory.<rate>.lshr beside it, or one in UserCacheDirectory(). The
+    // one in the cache is compiled from the directory's Composite responses the first time
+    // it is needed; only without a cache directory is it compiled beside the directory.
+    // Throws if the database has to be compiled and can't be.
+    static std::shared_ptr<const HrtfDatabase> load(const std::string& directory, float sampleRate);
+
+    int azimuths() const { return _azimuths; }
+    int elevations() const { return _elevations; }
+    int points() const { return _azimuths * _elevations; }
+    int point(int azimuth, int elevation) const { return elevation * _azimuths + azimuth; }
+    size_t bytes() const;
+
+    // the kernels for sampleRate, or nullptr if the database wasn't compiled for it
+    const Rate* rate(float sampleRate) const;
+    const std::vector<Rate>& rates() const { return _rates; }
+
+    // the delay in frames before a point's response for an ear, 0 for left and 1 for right,
+    // and partition p of its kernel
+    static float delay(const Rate& rate, int point, int ear) { return rate.delays[2 * point + ear]; }
+    static const float* partition(const Rate& rate, int point, int ear, int p)
+    {
+        return rate.kernels + ((static_cast<size_t>(point) * 2 + ear) * rate.partitions + p) * 2 * (Block + 1);
+    }
+
+    // the four grid points around a direction, in degrees, weighted for bilinear
+    // interpolation. Elevations beyond the grid are clamped to it.
+    Neighbours neighbours(float azimuth, float elevation) const;
+};
+
+#endif
@@ -0,0 +1,364 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "HrtfSpatializerNode.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace lab;
+
+namespace
+{
+    // the time constant of a source's movement
+    const float SmoothingSeconds = 0.02f;
+
+    // a source's kernels are interpolated again once its direction is a degree from theirs
+    const float KernelTolerance = 0.99985f;    // cos(1 degree)
+
+    const float Degrees = 57.29577951f;
+
+    // acc += x * h, over n complex values, each stored as n real parts followed by n
+    // imaginary parts. The arrays never overlap, so that the loop vectorizes.
+    void MultiplyAccumulate(const float* __restrict x, const float* __restrict h, float* __restrict acc, int n)
+    {
+        const float* __restrict xi = x + n;
+        const float* __restrict hi = h + n;
+        float* __restrict ai = acc + n;
+        for (int k = 0; k < n; ++k)
+        {
+            acc[k] += x[k] * h[k] - xi[k] * hi[k];
+            ai[k] += x[k] * hi[k] + xi[k] * h[k];
+        }
+    }
+
+    // out[i] = x[i - delay], interpolated linearly, for a delay that doesn't change
+    void DelayBlock(const float* __restrict x, float delay, float* __restrict out, int n)
+    {
+        const int whole = static_cast<int>(delay);
+        const float fraction = delay - whole;
+        const float* __restrict a = x - whole;
+        for (int i = 0; i < n; ++i)
+            out[i] = a[i] + (a[i - 1] - a[i]) * fraction;
+    }
+
+    // the weighted sum of four kernels, the real parts followed by the imaginary parts
+    void InterpolateKernels(const float* const* h, const float* w, float* __restrict out, int n)
+    {
+        const float* __restrict h0 = h[0];
+        const float* __restrict h1 = h[1];
+        const float* __restrict h2 = h[2];
+        const float* __restrict h3 = h[3];
+        for (int k = 0; k < n; ++k)
+            out[k] = w[0] * h0[k] + w[1] * h1[k] + w[2] * h2[k] + w[3] * h3[k];
+    }
+}
+
+HrtfSpatializerNode::HrtfSpatializerNode(AudioContext& ac, std::shared_ptr<const HrtfDatabase> database, int sources)
+    : AudioNode(ac, *desc())
+    , _database(std::move(database))
+    , _rate(_database ? _database->rate(ac.sampleRate()) : nullptr)
+    , _sources(std::max(1, sources))
+    , _groups((_sources + Lanes - 1) / Lanes)
+    , _fft(2 * Block)
+{
+    if (!_database)
+        throw std::invalid_argument("HrtfSpatializerNode needs a database");
+    if (!_rate)
+        throw std::invalid_argument("the HRTF database has no kernels for " + std::to_string(ac.sampleRate()) + " Hz");
+
+    _partitions = _rate->partitions;
+    _max_delay = 0;
+    for (int i = 0; i < 2 * _database->points(); ++i)
+        _max_delay = std::max(_max_delay, _rate->delays[i]);
+    _quiet_quanta = _partitions + 2 + static_cast<int>(_max_delay) / Block;
+    _history_size = Block + static_cast<int>(_max_delay) + 2;
+    _smoothing = 1.f - std::exp(-Block / (SmoothingSeconds * ac.sampleRate()));
+
+    _positions.reset(new Position[_sources]);
+    _state.resize(_sources);
+    _history.resize(static_cast<size_t>(_sources) * _history_size);
+    _delayed.resize(Block);
+    _interpolated.resize(2 * Bins);
+
+    const size_t spectrum = 2 * Bins * Lanes;
+    _windows.resize(static_cast<size_t>(_groups) * 2 * 2 * Block * Lanes);
+    _spectra.resize(static_cast<size_t>(_groups) * 2 * _partitions * spectrum);
+    _kernels.resize(_spectra.size());
+    _changes.resize(_spectra.size());
+    _changed.resize(_groups);
+    _quiet.resize(_groups);
+    _accumulator.resize(2 * spectrum);
+    _difference.resize(2 * spectrum);
+
+    _sum.resize(2 * Bins);
+    _out.resize(2 * Block);
+    _fade_out.resize(Block);
+    for (int i = 0; i < Block; ++i)
+        _fade_out[i] = 1.f - static_cast<float>(i + 1) / Block;
+
+    for (int i = 0; i < _sources; ++i)
+        addInput(std::unique_ptr<AudioNodeInput>(new AudioNodeInput(this)));
+    addOutput(std::unique_ptr<AudioNodeOutput>(new AudioNodeOutput(this, 2)));
+    initialize();
+}
+
+AudioNodeDescriptor* HrtfSpatializerNode::desc()
+{
+    static AudioNodeDescriptor d {nullptr, nullptr};
+    return &d;
+}
+
+void HrtfSpatializerNode::setPosition(int source, float x, float y, float z)
+{
+    if (source < 0 || source >= _sources)
+        return;
+
+    Position& p = _positions[source];
+    p.x.store(x, std::memory_order_relaxed);
+    p.y.store(y, std::memory_order_relaxed);
+    p.z.store(z, std::memory_order_relaxed);
+}
+
+void HrtfSpatializerNode::updateKernels(int source, bool fade)
+{
+    Source& s = _state[source];
+    const float x = s.position[0], y = s.position[1], z = s.position[2];
+    const float horizontal = std::sqrt(x * x + z * z);
+    const float distance = std::sqrt(horizontal * horizontal + y * y);
+
+    // azimuths run counter-clockwise from straight ahead, -z
+    const HrtfDatabase::Neighbours n = _database->neighbours(std::atan2(-x, -z) * Degrees, std::atan2(y, horizontal) * Degrees);
+
+    if (distance > 0)
+    {
+        s.direction[0] = x / distance;
+        s.direction[1] = y / distance;
+        s.direction[2] = z / distance;
+    }
+
+    const int group = source / Lanes;
+    const int lane = source % Lanes;
+    const size_t spectrum = 2 * Bins * Lanes;
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        float delay = 0;
+        for (int j = 0; j < 4; ++j)
+            delay += n.weights[j] * HrtfDatabase::delay(*_rate, n.points[j], ear);
+        s.delay[ear] = delay;
+
+        for (int p = 0; p < _partitions; ++p)
+        {
+            const float* h[4];
+            for (int j = 0; j < 4; ++j)
+                h[j] = HrtfDatabase::partition(*_rate, n.points[j], ear, p);
+            InterpolateKernels(h, n.weights, _interpolated.data(), 2 * Bins);
+
+            // the real parts, then the imaginary parts, of lane of the group's partition
+            const size_t offset = (groupEar(group, ear) * _partitions + p) * spectrum + lane;
+            float* kernel = _kernels.data() + offset;
+            float* change = _changes.data() + offset;
+            const float* v = _interpolated.data();
+            if (fade)
+            {
+                for (int k = 0; k < 2 * Bins; ++k)
+                    change[k * Lanes] = kernel[k * Lanes] - v[k];
+            }
+            for (int k = 0; k < 2 * Bins; ++k)
+                kernel[k * Lanes] = v[k];
+        }
+    }
+    if (fade)
+        _changed[group] = 1;
+}
+
+void HrtfSpatializerNode::delaySource(int source, const float* startDelay, float startGain)
+{
+    const Source& s = _state[source];
+    const float* x = _history.data() + static_cast<size_t>(source + 1) * _history_size - Block;  // this quantum
+    const float gainStep = (s.gain - startGain) / Block;
+    float* delayed = _delayed.data();
+
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        if (s.delay[ear] == startDelay[ear])
+            DelayBlock(x, s.delay[ear], delayed, Block);
+        else
+        {
+            const float delayStep = (s.delay[ear] - startDelay[ear]) / Block;
+            for (int i = 0; i < Block; ++i)
+            {
+                const float delay = startDelay[ear] + delayStep * (i + 1);
+                const int whole = static_cast<int>(delay);
+                const float fraction = delay - whole;
+                delayed[i] = x[i - whole] + (x[i - whole - 1] - x[i - whole]) * fraction;
+            }
+        }
+
+        // the second half of the window, the lane of this source
+        float* window = _windows.data() + groupEar(source / Lanes, ear) * 2 * Block * Lanes + Block * Lanes + source % Lanes;
+        for (int i = 0; i < Block; ++i)
+            window[i * Lanes] = delayed[i] * (startGain + gainStep * (i + 1));
+    }
+}
+
+void HrtfSpatializerNode::process(ContextRenderLock& r, int bufferSize)
+{
+    AudioBus* outputBus = output(0)->bus(r);
+    if (!outputBus)
+        return;
+
+    if (bufferSize != Block)
+    {
+        outputBus->zero();
+        return;
+    }
+
+    // the changes rendered last quantum are done with
+    const size_t spectrum = 2 * Bins * Lanes;
+    const size_t groupSpectra = 2 * _partitions * spectrum;
+    for (int g = 0; g < _groups; ++g)
+    {
+        if (_changed[g])
+        {
+            std::fill(_changes.begin() + g * groupSpectra, _changes.begin() + (g + 1) * groupSpectra, 0.f);
+            _changed[g] = 0;
+        }
+        ++_quiet[g];
+    }
+
+    // append each input, mixed to mono, to its history
+    for (int source = 0; source < _sources; ++source)
+    {
+        float* history = _history.data() + static_cast<size_t>(source) * _history_size;
+        std::copy(history + Block, history + _history_size, history);
+        history += _history_size - Block;
+        AudioNodeInput* in = input(source).get();
+        AudioBus* inputBus = in->isConnected() ? in->bus(r) : nullptr;
+        if (!inputBus)
+        {
+            std::fill(history, history + Block, 0.f);
+            continue;
+        }
+
+        _quiet[source / Lanes] = 0;
+        const int channels = inputBus->numberOfChannels();
+        if (channels == 1)
+        {
+            const float* src = inputBus->channel(0)->data();
+            std::copy(src, src + Block, history);
+            continue;
+        }
+
+        std::fill(history, history + Block, 0.f);
+        const float scale = 1.f / channels;
+        for (int c = 0; c < channels; ++c)
+        {
+            const float* src = inputBus->channel(c)->data();
+            for (int i = 0; i < Block; ++i)
+                history[i] += src[i] * scale;
+        }
+    }
+
+    // move each source, and delay it into its lane of its group's windows
+    const float smoothing = _started ? _smoothing : 1.f;
+    for (int source = 0; source < _sources; ++source)
+    {
+        Source& s = _state[source];
+        const Position& target = _positions[source];
+        s.position[0] += (target.x.load(std::memory_order_relaxed) - s.position[0]) * smoothing;
+        s.position[1] += (target.y.load(std::memory_order_relaxed) - s.position[1]) * smoothing;
+        s.position[2] += (target.z.load(std::memory_order_relaxed) - s.position[2]) * smoothing;
+
+        const float distance = std::sqrt(s.position[0] * s.position[0] + s.position[1] * s.position[1] + s.position[2] * s.position[2]);
+        const float startGain = s.gain;
+        const float startDelay[2] = { s.delay[0], s.delay[1] };
+        s.gain = 1.f / std::max(1.f, distance);
+
+        const float dot = distance > 0 ? (s.position[0] * s.direction[0] + s.position[1] * s.direction[1] + s.position[2] * s.direction[2]) / distance : 1.f;
+        if (!_started || dot < KernelTolerance)
+            updateKernels(source, _started);
+
+        if (_quiet[source / Lanes] <= _quiet_quanta)
+            delaySource(source, _started ? startDelay : s.delay, _started ? startGain : s.gain);
+    }
+    _started = true;
+
+    // transform each group's windows, and multiply them by its kernels into the accumulators
+    std::fill(_accumulator.begin(), _accumulator.end(), 0.f);
+    bool changed = false;
+    for (int g = 0; g < _groups; ++g)
+    {
+        if (_quiet[g] > _quiet_quanta)
+            continue;
+
+        if (_changed[g] && !changed)
+        {
+            std::fill(_difference.begin(), _difference.end(), 0.f);
+            changed = true;
+        }
+
+        for (int ear = 0; ear < 2; ++ear)
+        {
+            const size_t ge = groupEar(g, ear);
+            float* window = _windows.data() + ge * 2 * Block * Lanes;
+            float* spectra = _spectra.data() + ge * _partitions * spectrum;
+            float* x = spectra + _slot * spectrum;
+            _fft.forwardLanes(window, x, x + Bins * Lanes);
+            std::copy(window + Block * Lanes, window + 2 * Block * Lanes, window);
+
+            for (int p = 0; p < _partitions; ++p)
+            {
+                const float* xp = spectra + ((_slot - p + _partitions) % _partitions) * spectrum;
+                const size_t kernel = (ge * _partitions + p) * spectrum;
+                MultiplyAccumulate(xp, _kernels.data() + kernel, _accumulator.data() + ear * spectrum, Bins * Lanes);
+                if (_changed[g])
+                    MultiplyAccumulate(xp, _changes.data() + kernel, _difference.data() + ear * spectrum, Bins * Lanes);
+            }
+        }
+    }
+
+    // sum the lanes, and transform each ear back once
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        float* dst = outputBus->channel(ear)->mutableData();
+        for (int pass = 0; pass < (changed ? 2 : 1); ++pass)
+        {
+            const float* acc = (pass ? _difference.data() : _accumulator.data()) + ear * spectrum;
+            for (int k = 0; k < 2 * Bins; ++k)
+            {
+                float sum = 0;
+                for (int l = 0; l < Lanes; ++l)
+                    sum += acc[k * Lanes + l];
+                _sum[k] = sum;
+            }
+            _fft.inverse(_sum.data(), _sum.data() + Bins, _out.data());
+
+            // overlap-save keeps the second half
+            const float* y = _out.data() + Block;
+            if (!pass)
+                std::copy(y, y + Block, dst);
+            else
+                for (int i = 0; i < Block; ++i)
+                    dst[i] += y[i] * _fade_out[i];
+        }
+    }
+
+    _slot = (_slot + 1) % _partitions;
+    outputBus->clearSilentFlag();
+}
+
+void HrtfSpatializerNode::reset(ContextRenderLock&)
+{
+    std::fill(_history.begin(), _history.end(), 0.f);
+    std::fill(_windows.begin(), _windows.end(), 0.f);
+    std::fill(_spectra.begin(), _spectra.end(), 0.f);
+    std::fill(_quiet.begin(), _quiet.end(), 0);
+    _started = false;
+}
+
+double HrtfSpatializerNode::tailTime(ContextRenderLock& r) const
+{
+    return (_partitions * Block + _max_delay) / static_cast<double>(r.context()->sampleRate());
+}
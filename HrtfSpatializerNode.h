@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_HRTFSPATIALIZERNODE_H
+#define LABSOUNDDEMO_HRTFSPATIALIZERNODE_H
+
+#include "LabSound/LabSound.h"
+#include "Fft.h"
+#include "HrtfDatabase.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// HrtfSpatializerNode spatializes many mono sources at once with the responses of an
+// HrtfDatabase, for scenes with hundreds of emitters, where a PannerNode per source would
+// convolve, crossfade and transform back each source on its own. The node has an input per
+// source and a single stereo output.
+//
+// Sources are processed in groups of RealFft::Lanes, laid out so that each step of the work
+// is the same operation on adjacent floats of the group, which the compiler vectorizes.
+// Each source is delayed by its interaural time difference and attenuated in the time
+// domain, then each group's block of each ear is transformed with one forwardLanes(), and
+// multiplied by the group's kernels into an accumulator that every group shares. The
+// accumulator's lanes are summed and transformed back once per ear, so a source costs an
+// eighth of a transform per ear, plus its multiplies, and nothing is transformed back per
+// source.
+//
+// Positions are relative to the listener, who faces -z with +y up and +x to the right, as
+// in WebAudio. Each source's position is smoothed over about 20 ms, and its kernels are
+// interpolated again from the four nearest grid points when its direction has moved by more
+// than a degree. A quantum in which any kernel changed also renders the difference the
+// change made to the group, and fades it out over the quantum, so kernel changes don't
+// click. Sources are attenuated by the inverse of their distance beyond 1.
+//
+// A group whose inputs are all disconnected is skipped once its tail has rung out. The node
+// renders quanta of HrtfDatabase::Block frames, and is silent for any other size.
+class HrtfSpatializerNode : public lab::AudioNode
+{
+    enum : int
+    {
+        Block = HrtfDatabase::Block,
+        Lanes = RealFft::Lanes,
+        Bins = Block + 1,
+    };
+
+    struct Position
+    {
+        std::atomic<float> x {0.f};
+        std::atomic<float> y {0.f};
+        std::atomic<float> z {-1.f};
+    };
+
+    // a source's state on the render thread
+    struct Source
+    {
+        float position[3] = { 0, 0, -1 };   // smoothed
+        float direction[3] = { 0, 0, -1 };  // of the current kernels
+        float gain = 1;
+        float delay[2] = { 0, 0 };
+    };
+
+    std::shared_ptr<const HrtfDatabase> _database;
+    const HrtfDatabase::Rate* _rate;
+    int _sources;
+    int _groups;
+    int _partitions;
+    float _max_delay;       // of any point in the database, in frames
+    int _quiet_quanta;      // after which a group without inputs is silent
+    int _history_size;      // frames of input kept per source, ending with this quantum's
+    int _slot = 0;          // the frequency domain delay line slot of this quantum
+    bool _started = false;
+    float _smoothing;
+
+    std::unique_ptr<Position[]> _positions;
+    std::vector<Source> _state;
+    std::vector<float> _history;    // per source
+    std::vector<float> _delayed;
+    std::vector<float> _interpolated;
+
+    // per group and ear, in the lane layout of forwardLanes(): the time domain window of the
+    // last two quanta, the spectra of the last _partitions windows, the kernels, and the
+    // change made to the kernels in this quantum
+    std::vector<float> _windows;
+    std::vector<float> _spectra;
+    std::vector<float> _kernels;
+    std::vector<float> _changes;
+    std::vector<char> _changed;     // per group, whether _changes is non zero
+    std::vector<int> _quiet;        // per group, quanta since any input was connected
+
+    // per ear, summed over every group
+    std::vector<float> _accumulator;
+    std::vector<float> _difference;
+
+    RealFft _fft;
+    std::vector<float> _sum;
+    std::vector<float> _out;
+    std::vector<float> _fade_out;
+
+    virtual bool propagatesSilence(lab::ContextRenderLock&) const override { return false; }
+
+    size_t groupEar(int group, int ear) const { return static_cast<size_t>(group) * 2 + ear; }
+    void updateKernels(int source, bool fade);
+    void delaySource(int source, const float* startDelay, float startGain);
+
+public:
+    // Throws std::invalid_argument if database is nullptr, or wasn't compiled for the
+    // context's sample rate.
+    HrtfSpatializerNode(lab::AudioContext& ac, std::shared_ptr<const HrtfDatabase> database, int sources);
+    virtual ~HrtfSpatializerNode() = default;
+
+    static const char* static_name() { return "HrtfSpatializer"; }
+    virtual const char* name() const override { return static_name(); }
+    static lab::AudioNodeDescriptor* desc();
+
+    int sources() const { return _sources; }
+
+    // Sets the position of the source at input index source, relative to the listener. May
+    // be called from any thread; the render thread reads it at the next quantum.
+    void setPosition(int source, float x, float y, float z);
+
+    virtual void process(lab::ContextRenderLock&, int bufferSize) override;
+    virtual void reset(lab::ContextRenderLock&) override;
+    virtual double tailTime(lab::ContextRenderLock& r) const override;
+    virtual double latencyTime(lab::ContextRenderLock&) const override { return 0; }
+};
+
+#endif
@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#if defined(_MSC_VER)
+    #if !defined(_CRT_SECURE_NO_WARNINGS)
+        #define _CRT_SECURE_NO_WARNINGS
+    #endif
+#endif
+
+#include "ImpulseCache.h"
+#include "MappedAudioFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+using namespace lab;
+
+namespace
+{
+    const size_t lsir_header_size = 64;
+    const size_t lsir_key_size = 44;       // the header up to the channel count
+    const uint32_t lsir_version = 1;
+
+    uint64_t Fnv1a(const uint8_t* p, size_t size, uint64_t hash = 14695981039346656037ull)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    void put_u32(uint8_t* p, uint32_t v) { memcpy(p, &v, 4); }
+    uint32_t get_u32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+    // the part of a header that must match for a cached response to be used
+    void MakeKey(uint8_t* header, uint64_t source, float sampleRate, bool normalize)
+    {
+        memset(header, 0, lsir_header_size);
+        memcpy(header, "LSIR", 4);
+        put_u32(header + 4, lsir_version);
+        memcpy(header + 8, &source, 8);
+        memcpy(header + 16, &sampleRate, 4);
+        put_u32(header + 20, normalize ? 1 : 0);
+        put_u32(header + 24, ConvolutionImpulse::HeadBlock);
+        put_u32(header + 28, ConvolutionImpulse::FirstTailBlock);
+        put_u32(header + 32, ConvolutionImpulse::MaxBlock);
+        put_u32(header + 36, ConvolutionImpulse::Growth);
+        put_u32(header + 40, RealFft::Version);
+    }
+
+    std::shared_ptr<const ConvolutionImpulse> MapImpulse(const std::string& path, const uint8_t* key)
+    {
+        std::shared_ptr<MappedFile> file = MappedFile::open(path);
+        if (!file || file->size() < lsir_header_size || memcmp(file->data(), key, lsir_key_size) != 0)
+            return {};
+
+        const uint8_t* header = file->data();
+        const int channels = static_cast<int>(get_u32(header + 44));
+        const int length = static_cast<int>(get_u32(header + 48));
+        uint64_t stride;
+        memcpy(&stride, header + 56, 8);
+
+        if (channels < 1 || channels == 3 || channels > 4 || length < 0 || stride != ConvolutionImpulse::channelStride(length)
+            || file->size() < lsir_header_size + stride * channels * sizeof(float))
+            return {};
+
+        const float* spectra = reinterpret_cast<const float*>(header + lsir_header_size);
+        return ConvolutionImpulse::adopt(channels, length, spectra, file);
+    }
+
+    // writes to a temporary file renamed into place, so a concurrent load never maps a
+    // partial file
+    bool WriteImpulse(const std::string& path, const uint8_t* key, ConvolutionImpulse const& impulse)
+    {
+        const std::string temp = UniqueTempPath(path);
+        FILE* f = fopen(temp.c_str(), "wb");
+        if (!f)
+            return false;
+
+        uint8_t header[lsir_header_size];
+        memcpy(header, key, lsir_header_size);
+        put_u32(header + 44, static_cast<uint32_t>(impulse.channels()));
+        put_u32(header + 48, static_cast<uint32_t>(impulse.length()));
+        const uint64_t stride = impulse.channelStride();
+        memcpy(header + 56, &stride, 8);
+
+        const size_t count = impulse.channelStride() * impulse.channels();
+        bool ok = fwrite(header, 1, lsir_header_size, f) == lsir_header_size
+               && fwrite(impulse.spectra(), sizeof(float), count, f) == count;
+
+        ok = fclose(f) == 0 && ok && ReplaceFile(temp, path);
+        if (!ok)
+            remove(temp.c_str());
+        return ok;
+    }
+}
+
+ImpulseCache::ImpulseCache(std::string directory)
+    : _directory(directory.empty() ? UserCacheDirectory() : std::move(directory))
+{
+}
+
+std::shared_ptr<const ConvolutionImpulse> ImpulseCache::get(const std::string& path, float sampleRate, bool normalize)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return {};
+
+    const Key key(path, sampleRate, normalize);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _shared.find(key);
+        if (it != _shared.end() && it->second.modified == st.st_mtime && it->second.size == st.st_size)
+        {
+            if (std::shared_ptr<const ConvolutionImpulse> impulse = it->second.impulse.lock())
+                return impulse;
+        }
+    }
+
+    // loaded without the lock, so that loads of different responses don't wait for each
+    // other. Two threads may load the same response at once, in which case the second to
+    // finish uses the first one's impulse.
+    std::shared_ptr<const ConvolutionImpulse> impulse = load(path, sampleRate, normalize);
+    if (!impulse)
+        return {};
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it = _shared.begin(); it != _shared.end();)
+        it = it->second.impulse.expired() ? _shared.erase(it) : std::next(it);
+
+    Shared& shared = _shared[key];
+    if (std::shared_ptr<const ConvolutionImpulse> loaded = shared.impulse.lock())
+    {
+        if (shared.modified == st.st_mtime && shared.size == st.st_size)
+            return loaded;
+    }
+    shared.modified = st.st_mtime;
+    shared.size = st.st_size;
+    shared.impulse = impulse;
+    return impulse;
+}
+
+std::shared_ptr<const ConvolutionImpulse> ImpulseCache::load(const std::string& path, float sampleRate, bool normalize) const
+{
+    uint64_t source;
+    {
+        std::shared_ptr<MappedFile> file = MappedFile::open(path);
+        if (!file)
+            return {};
+        source = Fnv1a(file->data(), file->size());
+    }
+
+    uint8_t key[lsir_header_size];
+    MakeKey(key, source, sampleRate, normalize);
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.lsir", static_cast<unsigned long long>(Fnv1a(key, lsir_key_size)));
+    const std::string cached = _directory.empty() ? path + "." + name : _directory + "/" + name;
+
+    if (std::shared_ptr<const ConvolutionImpulse> impulse = MapImpulse(cached, key))
+        return impulse;
+
+    std::shared_ptr<AudioBus> bus = MakeBusFromMappedFile(path, sampleRate);
+    if (!bus)
+        bus = MakeBusFromFile(path, false, sampleRate);
+    if (!bus)
+        return {};
+
+    std::shared_ptr<const ConvolutionImpulse> impulse = ConvolutionImpulse::prepare(*bus, sampleRate, normalize);
+    if (!WriteImpulse(cached, key, *impulse))
+        std::cerr << "Couldn't write " << cached << ", " << path << " will be prepared again when it is next loaded" << std::endl;
+    return impulse;
+}
+
+ImpulseCache::Future ImpulseCache::getAsync(WorkerPool& pool, const std::string& path, float sampleRate, bool normalize)
+{
+    auto promise = std::make_shared<std::promise<std::shared_ptr<const ConvolutionImpulse>>>();
+    Future impulse = promise->get_future().share();
+    pool.submit([this, promise, path, sampleRate, normalize]() {
+        try
+        {
+            std::shared_ptr<const ConvolutionImpulse> prepared = get(path, sampleRate, normalize);
+            if (!prepared)
+                throw std::runtime_error("couldn't open " + path);
+            promise->set_value(prepared);
+        }
+        catch (...)
+        {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return impulse;
+}
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_IMPULSECACHE_H
+#define LABSOUNDDEMO_IMPULSECACHE_H
+
+#include "PartitionedConvolver.h"
+#include "WorkerPool.h"
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+// ImpulseCache keeps impulse responses on disk already partitioned and transformed, so
+// that loading one for a PartitionedConvolverNode costs a hash of the file and a mapping,
+// rather than a decode and hundreds of milliseconds of transforms.
+//
+// A response is keyed by a hash of the file's contents, the sample rate, whether it is
+// normalized, the partitioning of ConvolutionImpulse, and the version of RealFft. The first
+// load of a key prepares the response and writes it to a .lsir file named by the key, in
+// the cache's directory, by default UserCacheDirectory(), since the assets may be read
+// only. Without a directory, the file is written beside the response. Later loads map the
+// file, and the spectra are used in place, with nothing read until the convolver touches
+// it. A change to any part of the key misses the cache; stale files are not removed.
+//
+// Responses are also shared in memory. While any convolver holds a response the cache
+// returned, getting it again returns the same ConvolutionImpulse, without reading the file
+// unless its modification time or size changed, so a scene of many rooms that use the same
+// response holds one copy of its spectra. Each room's convolver still holds the spectra of
+// its input, see ConvolutionImpulse.
+//
+// .lsir files hold native 32 bit values, so they are only portable between machines of the
+// same byte order.
+//
+//   offset  size
+//   0       4     "LSIR"
+//   4       4     version, 1
+//   8       8     FNV-1a hash of the response file
+//   16      4     sample rate, float
+//   20      4     normalized, 0 or 1
+//   24      4     ConvolutionImpulse::HeadBlock
+//   28      4     ConvolutionImpulse::FirstTailBlock
+//   32      4     ConvolutionImpulse::MaxBlock
+//   36      4     ConvolutionImpulse::Growth
+//   40      4     RealFft::Version
+//   44      4     channel count
+//   48      4     length in frames
+//   52      4     reserved, zero
+//   56      8     channel stride in floats, ConvolutionImpulse::channelStride(length)
+//   64            each channel's spectra
+class ImpulseCache
+{
+public:
+    using Future = std::shared_future<std::shared_ptr<const ConvolutionImpulse>>;
+
+private:
+    // path, sample rate, normalized
+    using Key = std::tuple<std::string, float, bool>;
+
+    struct Shared
+    {
+        int64_t modified = 0;
+        int64_t size = 0;
+        std::weak_ptr<const ConvolutionImpulse> impulse;
+    };
+
+    std::string _directory;
+    std::mutex _mutex;
+    std::map<Key, Shared> _shared;
+
+    std::shared_ptr<const ConvolutionImpulse> load(const std::string& path, float sampleRate, bool normalize) const;
+
+public:
+    // an empty directory uses UserCacheDirectory(), or if there is none, keeps each file
+    // beside its response
+    explicit ImpulseCache(std::string directory = {});
+
+    // Returns the response in path, resampled to sampleRate and prepared, from the cache if
+    // it can. Returns nullptr if the file can't be read or decoded. Failing to write the
+    // cache file is logged, but not an error; the response is prepared again on the next
+    // load.
+    // May be called from any thread.
+    std::shared_ptr<const ConvolutionImpulse> get(const std::string& path, float sampleRate, bool normalize = true);
+
+    // As get, but prepares the response on pool rather than on the calling thread. The
+    // future throws if the file can't be read or decoded. While the future is held, get()
+    // returns the same response without preparing it again. The cache must outlive the
+    // pool's tasks.
+    Future getAsync(WorkerPool& pool, const std::string& path, float sampleRate, bool normalize = true);
+};
+
+#endif
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_KERNELNODE_H
+#define LABSOUNDDEMO_KERNELNODE_H
+
+#include "LabSound/LabSound.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// KernelNode is a scheduled source node that renders with a kernel known at compile time,
+// rather than a FunctionNode's std::function. The kernel is called directly, once per
+// quantum, so the compiler can inline it into the node's process() and vectorize its loops.
+//
+// A kernel is any copyable type with a call operator of the form
+//
+//     void operator()(float* const* channels, int channelCount, int frames, double now, float sampleRate);
+//
+// which writes frames samples to each channel. now is the time at the start of the quantum,
+// in seconds since the node started, as FunctionNode::now() would report. The kernel holds
+// whatever state it needs between quanta, such as filter memory.
+//
+// If Channels is non zero the channel count is fixed at compile time, and is passed to the
+// kernel as a constant, so loops over channels can be unrolled. Otherwise the count is given
+// to the constructor.
+template <typename Kernel, int Channels = 0>
+class KernelNode : public lab::AudioScheduledSourceNode
+{
+    Kernel _kernel;
+    int _channels;
+    double _now = 0;
+    std::vector<float*> _pointers;
+
+public:
+    explicit KernelNode(lab::AudioContext& ac, Kernel kernel = Kernel(), int channels = Channels)
+        : lab::AudioScheduledSourceNode(ac, *desc())
+        , _kernel(std::move(kernel))
+        , _channels(Channels ? Channels : std::max(1, channels))
+        , _pointers(_channels)
+    {
+        addOutput(std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(this, _channels)));
+        initialize();
+    }
+
+    virtual ~KernelNode() = default;
+
+    static const char* static_name() { return "Kernel"; }
+    virtual const char* name() const override { return static_name(); }
+    static lab::AudioNodeDescriptor* desc()
+    {
+        static lab::AudioNodeDescriptor d {nullptr, nullptr};
+        return &d;
+    }
+
+    // the kernel is used by the render thread; only touch it while the node is stopped, or
+    // under a ContextRenderLock
+    Kernel& kernel() { return _kernel; }
+    double now() const { return _now; }
+
+    virtual void process(lab::ContextRenderLock& r, int bufferSize) override
+    {
+        lab::AudioBus* outputBus = output(0)->bus(r);
+        if (!outputBus)
+            return;
+
+        const int offset = _scheduler._renderOffset;
+        const int frames = _scheduler._renderLength;
+        if (!isInitialized() || !frames)
+        {
+            outputBus->zero();
+            return;
+        }
+
+        // the part of the quantum before the start, or after the stop, is silent
+        if (offset > 0 || frames < bufferSize)
+            outputBus->zero();
+
+        const int channelCount = Channels ? Channels : _channels;
+        for (int c = 0; c < channelCount; ++c)
+            _pointers[c] = outputBus->channel(c)->mutableData() + offset;
+
+        const float sampleRate = r.context()->sampleRate();
+        _kernel(_pointers.data(), channelCount, frames, _now, sampleRate);
+
+        _now += static_cast<double>(bufferSize) / sampleRate;
+        outputBus->clearSilentFlag();
+    }
+
+    virtual void reset(lab::ContextRenderLock&) override { _now = 0; }
+    virtual double tailTime(lab::ContextRenderLock&) const override { return 0; }
+    virtual double latencyTime(lab::ContextRenderLock&) const override { return 0; }
+};
+
+#endif
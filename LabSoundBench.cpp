@@ -0,0 +1,772 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#if defined(_MSC_VER)
+    #if !defined(_CRT_SECURE_NO_WARNINGS)
+        #define _CRT_SECURE_NO_WARNINGS
+    #endif
+    #if !defined(NOMINMAX)
+        #define NOMINMAX
+    #endif
+#endif
+
+#include "LabSound/LabSound.h"
+#include "LabSoundDemo.h"
+#include "AssetCache.h"
+#include "DemoExamples.h"
+#include "DemoGraphs.h"
+#include "FastMath.h"
+#include "GoldenOutput.h"
+#include "NodeProfiler.h"
+#include "OfflineRender.h"
+#include "ParallelRenderNode.h"
+#include "ParamQueueNode.h"
+#include "PartitionedConvolver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lab;
+
+// LabSoundBench renders the LabSoundDemo examples and the graphs of DemoGraphs.h offline,
+// as fast as possible, and reports how quickly each renders. No audio device is needed, so
+// it runs on headless machines. The examples, named ex_ and the example's name, are played
+// against the virtual clock, for as long as they play in LabSoundDemo. The graphs are
+// rendered for --seconds. The examples that need a live input, or that render a context
+// of their own, are left out.
+//
+//   LabSoundBench [asset_path] [--seconds N] [--samplerate R] [--graph name]... [--profile] [--threads N] [--pipeline] [--sidecars] [--list]
+//
+// --profile additionally reports the cost of each node. --threads renders with a
+// ParallelRenderNode on N threads; 0 uses one per core. --pipeline splits the examples that
+// support it into pipeline stages, and reports the latency that adds. --sidecars writes the
+// samples the graphs decode to the user's cache directory, so that later runs map them
+// instead of decoding.
+//
+//   LabSoundBench [asset_path] --update-fingerprints file [--graph name]... [--runs N]
+//   LabSoundBench [asset_path] --check-fingerprints file [--graph name]... [--runs N] [--tolerance T]
+//
+// checks what the examples and graphs render against their output fingerprints, see
+// GoldenOutput.h. Each is rendered --runs times, which must produce identical output.
+// --update-fingerprints records the current output. Checking fails if anything has no
+// fingerprint, or if its output has drifted by more than --tolerance, relative to the
+// fingerprint's peak level.
+//
+//   LabSoundBench [asset_path] --update-budgets file [--graph name]... [--runs N] [--time-slack S]
+//   LabSoundBench [asset_path] --check-budgets file [--graph name]... [--runs N]
+//
+// checks how long the examples and graphs take to render against budgets recorded on the
+// same machine. Each is rendered --runs times, without fingerprinting, and the fastest run
+// counts. --update-budgets records a budget of the fastest run plus --time-slack, as a
+// fraction. Checking fails if anything renders more slowly than its budget.
+//
+//   LabSoundBench --check-convolver [--samplerate R]
+//
+// convolves noise with PartitionedConvolver, and fails if the output differs from a direct
+// convolution by more than ConvolverTolerance of its peak.
+//
+//   LabSoundBench --check-param-queue [--samplerate R]
+//
+// steps a gain through changes posted to a ParamQueueNode, stamped mid-quantum, and fails
+// unless each one is heard from the sample it was stamped for.
+
+struct BenchOptions
+{
+    std::string asset_path = asset_base;
+    double seconds = 10.0;
+    float samplerate = LABSOUND_DEFAULT_SAMPLERATE;
+    std::vector<std::string> graphs;
+    bool profile = false;
+    int threads = 1;
+    bool pipeline = false;
+    bool sidecars = false;
+    bool list = false;
+    bool check_convolver = false;
+    bool check_param_queue = false;
+
+    std::string check_fingerprints;
+    std::string update_fingerprints;
+    std::string check_budgets;
+    std::string update_budgets;
+    int runs = 3;
+    double tolerance = 0.01;
+    double time_slack = 0.5;
+};
+
+BenchOptions ParseOptions(int argc, char** argv)
+{
+    BenchOptions opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::invalid_argument(arg + " requires a value");
+            return argv[++i];
+        };
+
+        if (arg == "--seconds") opt.seconds = std::atof(value().c_str());
+        else if (arg == "--samplerate") opt.samplerate = static_cast<float>(std::atof(value().c_str()));
+        else if (arg == "--graph") opt.graphs.push_back(value());
+        else if (arg == "--profile") opt.profile = true;
+        else if (arg == "--threads") opt.threads = std::max(0, std::atoi(value().c_str()));
+        else if (arg == "--pipeline") opt.pipeline = true;
+        else if (arg == "--sidecars") opt.sidecars = true;
+        else if (arg == "--list") opt.list = true;
+        else if (arg == "--check-fingerprints") opt.check_fingerprints = value();
+        else if (arg == "--check-budgets") opt.check_budgets = value();
+        else if (arg == "--check-convolver") opt.check_convolver = true;
+        else if (arg == "--check-param-queue") opt.check_param_queue = true;
+        else if (arg == "--update-fingerprints") opt.update_fingerprints = value();
+        else if (arg == "--update-budgets") opt.update_budgets = value();
+        else if (arg == "--runs") opt.runs = std::max(1, std::atoi(value().c_str()));
+        else if (arg == "--tolerance") opt.tolerance = std::atof(value().c_str());
+        else if (arg == "--time-slack") opt.time_slack = std::atof(value().c_str());
+        else if (arg.size() > 2 && arg[0] == '-' && arg[1] == '-') throw std::invalid_argument("unknown option " + arg);
+        else opt.asset_path = arg + "/";
+    }
+
+    if (opt.seconds <= 0)
+        throw std::invalid_argument("--seconds must be positive");
+
+    // the profiler processes the graph itself, one node at a time
+    if (opt.profile && opt.threads != 1)
+        throw std::invalid_argument("--profile can't be combined with --threads");
+    return opt;
+}
+
+struct BenchResult
+{
+    uint64_t frames = 0;
+    double wall = 0;    // seconds
+    QuantumStats quanta;
+    std::vector<NodeProfile> nodes;
+    double latency = 0; // seconds, added by pipeline stages
+
+    // only when fingerprinting
+    uint64_t hash = 0;
+    int channels = 0;
+    std::vector<float> levels;
+};
+
+// what the bench renders, one of the LabSoundDemo examples or one of the graphs
+struct BenchTarget
+{
+    std::string name;
+    DemoExample const* example = nullptr;
+    DemoGraphBuilder const* graph = nullptr;
+};
+
+std::vector<BenchTarget> BenchTargets()
+{
+    std::vector<BenchTarget> targets;
+    for (auto& e : DemoExamples())
+        if (e.hosted)
+            targets.push_back({ std::string("ex_") + e.name, &e, nullptr });
+    for (auto& g : DemoGraphBuilders())
+        targets.push_back({ g.name, nullptr, &g });
+    return targets;
+}
+
+// throws if there is no example or graph of that name
+BenchTarget FindBenchTarget(const std::string& name)
+{
+    for (auto& t : BenchTargets())
+        if (t.name == name)
+            return t;
+    throw std::invalid_argument("unknown graph " + name + ", use --list to see the available graphs");
+}
+
+// the examples are played against the virtual clock for as long as they play, which is
+// well under this
+const double ExampleReserveSeconds = 120.0;
+
+// the nodes the bench puts between what it renders and the destination,
+//
+//   device <- [profiler | parallel renderer] <- [fingerprint] <- input
+struct BenchChain
+{
+    std::shared_ptr<AudioNode> input;
+    std::shared_ptr<OutputFingerprintNode> fingerprinter;
+    std::shared_ptr<NodeProfilerNode> profiler;
+    std::shared_ptr<ParallelRenderNode> parallel;
+};
+
+BenchChain ConnectBenchChain(lab::AudioContext& ac, BenchOptions const& opt, double seconds, bool fingerprint,
+                             std::shared_ptr<QuantumClockNode> gate = nullptr)
+{
+    BenchChain chain;
+    std::shared_ptr<AudioNode> tail = ac.device();
+
+    if (opt.threads != 1)
+    {
+        chain.parallel = std::make_shared<ParallelRenderNode>(ac, static_cast<unsigned int>(opt.threads));
+        ac.connect(tail, chain.parallel, 0, 0);
+        tail = chain.parallel;
+    }
+
+    if (opt.profile)
+    {
+        chain.profiler = std::make_shared<NodeProfilerNode>(ac);
+        ac.connect(tail, chain.profiler, 0, 0);
+        tail = chain.profiler;
+    }
+
+    if (fingerprint)
+    {
+        const uint64_t frames = static_cast<uint64_t>(seconds * opt.samplerate);
+        chain.fingerprinter = std::make_shared<OutputFingerprintNode>(ac, frames, gate);
+        ac.connect(tail, chain.fingerprinter, 0, 0);
+        tail = chain.fingerprinter;
+    }
+
+    chain.input = tail;
+    return chain;
+}
+
+BenchResult RenderGraph(DemoGraphBuilder const& builder, BenchOptions const& opt, SampleLoader const& loader, bool fingerprint)
+{
+    AudioStreamConfig offlineConfig;
+    offlineConfig.device_index = 0;
+    offlineConfig.desired_samplerate = opt.samplerate;
+    offlineConfig.desired_channels = LABSOUND_DEFAULT_CHANNELS;
+
+    std::unique_ptr<lab::AudioContext> context = lab::MakeOfflineAudioContext(offlineConfig, static_cast<float>(opt.seconds * 1000.0));
+    lab::AudioContext& ac = *context.get();
+
+    auto clock = std::make_shared<QuantumClockNode>(ac);
+    clock->reserve(static_cast<size_t>(opt.seconds * opt.samplerate / AudioNode::ProcessingSizeInFrames) + 16);
+
+    DemoGraphSetup setup { ac, loader, opt.asset_path, opt.seconds };
+    DemoGraph graph = builder.build(setup);
+
+    BenchChain chain = ConnectBenchChain(ac, opt, opt.seconds, fingerprint);
+    context->connect(chain.input, graph.output, 0, 0);
+    context->addAutomaticPullNode(clock);
+
+    // assets are decoded while building the graph, so only rendering is timed
+    auto start = std::chrono::steady_clock::now();
+    auto render = StartOfflineRender(ac, static_cast<float>(opt.seconds * 1000.0));
+    render->wait();
+    auto end = std::chrono::steady_clock::now();
+
+    BenchResult result;
+    result.frames = clock->framesRendered();
+    result.wall = std::chrono::duration<double>(end - start).count();
+    result.quanta = ComputeQuantumStats(clock->quantumDurations());
+    if (chain.profiler)
+        result.nodes = chain.profiler->profiles();
+    if (chain.fingerprinter)
+    {
+        result.hash = chain.fingerprinter->hash();
+        result.channels = chain.fingerprinter->channels();
+        result.levels = chain.fingerprinter->levels();
+    }
+
+    context->removeAutomaticPullNode(clock);
+    return result;
+}
+
+// Plays an example against the virtual clock, through the bench's chain. The example's
+// control code runs between quanta, while the render thread is held, so only the time
+// spent rendering quanta is counted.
+BenchResult RenderExample(DemoExample const& example, BenchOptions const& opt, bool fingerprint)
+{
+    std::vector<std::shared_ptr<QuantumClockNode>> clocks;
+    std::vector<BenchChain> chains;
+
+    ExampleHost host;
+    host.asset_base = opt.asset_path;
+    host.virtual_clock = true;
+    host.samplerate = opt.samplerate;
+    host.pipeline = opt.pipeline;
+    host.output = [&](lab::AudioContext& ac, std::shared_ptr<QuantumClockNode> const& clock) {
+        clock->reserve(static_cast<size_t>(ExampleReserveSeconds * opt.samplerate / AudioNode::ProcessingSizeInFrames));
+        clocks.push_back(clock);
+        chains.push_back(ConnectBenchChain(ac, opt, ExampleReserveSeconds, fingerprint, clock));
+        return chains.back().input;
+    };
+
+    // no asset path on the command line, so the examples use the host's
+    char name[] = "LabSoundBench";
+    char* argv[] = { name, nullptr };
+    ExampleResult played = example.play(host, 1, argv);
+    if (clocks.empty())
+        throw std::runtime_error("the example made no context");
+
+    // an example may make several contexts in turn, such as ex_runtime_graph_update
+    BenchResult result;
+    std::vector<double> durations;
+    for (auto& clock : clocks)
+    {
+        result.frames += clock->framesRendered();
+        durations.insert(durations.end(), clock->quantumDurations().begin(), clock->quantumDurations().end());
+    }
+    for (double d : durations)
+        result.wall += d;
+    result.quanta = ComputeQuantumStats(durations);
+    result.latency = played.latency;
+
+    for (auto& chain : chains)
+    {
+        if (chain.profiler)
+        {
+            auto profiles = chain.profiler->profiles();
+            result.nodes.insert(result.nodes.end(), profiles.begin(), profiles.end());
+        }
+        if (chain.fingerprinter)
+        {
+            // each context's blocks follow the last's
+            result.hash = (result.hash ^ chain.fingerprinter->hash()) * 1099511628211ull;
+            result.channels = chain.fingerprinter->channels();
+            auto& levels = chain.fingerprinter->levels();
+            result.levels.insert(result.levels.end(), levels.begin(), levels.end());
+        }
+    }
+    return result;
+}
+
+BenchResult Render(BenchTarget const& target, BenchOptions const& opt, SampleLoader const& loader, bool fingerprint = false)
+{
+    if (target.example)
+        return RenderExample(*target.example, opt, fingerprint);
+    return RenderGraph(*target.graph, opt, loader, fingerprint);
+}
+
+// renders opt.runs times with a fingerprinter, and returns the fingerprint. Throws if the
+// runs differ.
+OutputFingerprint RenderFingerprint(BenchTarget const& target, BenchOptions const& opt, SampleLoader const& loader)
+{
+    BenchResult first = Render(target, opt, loader, true);
+    for (int i = 1; i < opt.runs; ++i)
+    {
+        BenchResult r = Render(target, opt, loader, true);
+        if (r.hash != first.hash || r.levels != first.levels)
+            throw std::runtime_error("output differs between runs, the graph doesn't render deterministically");
+    }
+
+    OutputFingerprint f;
+    f.name = target.name;
+    f.seconds = target.example ? static_cast<double>(first.frames) / opt.samplerate : opt.seconds;
+    f.samplerate = opt.samplerate;
+    f.hash = first.hash;
+    f.channels = first.channels;
+    f.levels = first.levels;
+    return f;
+}
+
+// renders opt.runs times, without fingerprinting, and returns the fastest run
+BenchResult RenderFastest(BenchTarget const& target, BenchOptions const& opt, SampleLoader const& loader)
+{
+    BenchResult best = Render(target, opt, loader);
+    for (int i = 1; i < opt.runs; ++i)
+    {
+        BenchResult r = Render(target, opt, loader);
+        if (r.wall < best.wall)
+            best = r;
+    }
+    return best;
+}
+
+// the options a fingerprint or budget was recorded with; an example plays for as long as
+// it plays, whatever the seconds
+BenchOptions RecordedOptions(BenchOptions const& opt, double seconds, float samplerate)
+{
+    BenchOptions recorded = opt;
+    recorded.seconds = seconds;
+    recorded.samplerate = samplerate;
+    return recorded;
+}
+
+int UpdateFingerprints(BenchOptions const& opt, std::vector<BenchTarget> const& targets, SampleLoader const& loader)
+{
+    // what isn't rendered keeps its fingerprint
+    std::vector<OutputFingerprint> fingerprints = ReadFingerprints(opt.update_fingerprints);
+
+    int failures = 0;
+    for (auto& t : targets)
+    {
+        try
+        {
+            OutputFingerprint f = RenderFingerprint(t, opt, loader);
+
+            auto it = std::find_if(fingerprints.begin(), fingerprints.end(), [&f](OutputFingerprint const& x) { return x.name == f.name; });
+            if (it != fingerprints.end())
+                *it = f;
+            else
+                fingerprints.push_back(f);
+
+            printf("%-28s %016llx %6.2f s\n", t.name.c_str(), static_cast<unsigned long long>(f.hash), f.seconds);
+        }
+        catch (const std::exception& e)
+        {
+            printf("%-28s failed: %s\n", t.name.c_str(), e.what());
+            ++failures;
+        }
+    }
+
+    WriteFingerprints(opt.update_fingerprints, fingerprints);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int CheckFingerprints(BenchOptions const& opt, std::vector<BenchTarget> const& targets, SampleLoader const& loader)
+{
+    std::vector<OutputFingerprint> fingerprints = ReadFingerprints(opt.check_fingerprints);
+
+    int failures = 0;
+    int checked = 0;
+    for (auto& t : targets)
+    {
+        ++checked;
+        try
+        {
+            auto it = std::find_if(fingerprints.begin(), fingerprints.end(), [&t](OutputFingerprint const& x) { return x.name == t.name; });
+            if (it == fingerprints.end())
+                throw std::runtime_error("no fingerprint in " + opt.check_fingerprints + ", record one with --update-fingerprints");
+
+            // render exactly as the fingerprint was recorded
+            OutputFingerprint f = RenderFingerprint(t, RecordedOptions(opt, it->seconds, it->samplerate), loader);
+
+            std::string why = CompareFingerprints(*it, f, opt.tolerance);
+            if (!why.empty())
+                throw std::runtime_error(why);
+
+            printf("%-28s ok%s\n", t.name.c_str(), f.hash == it->hash ? "" : ", output within tolerance");
+        }
+        catch (const std::exception& e)
+        {
+            printf("%-28s FAILED: %s\n", t.name.c_str(), e.what());
+            ++failures;
+        }
+    }
+
+    // a fingerprint left behind by a renamed or removed example would otherwise go unnoticed
+    if (opt.graphs.empty())
+    {
+        for (auto& f : fingerprints)
+        {
+            if (std::none_of(targets.begin(), targets.end(), [&f](BenchTarget const& t) { return t.name == f.name; }))
+            {
+                printf("%-28s FAILED: fingerprinted, but there is no example or graph of that name\n", f.name.c_str());
+                ++checked;
+                ++failures;
+            }
+        }
+    }
+
+    printf("\n%d of %d failed\n", failures, checked);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int UpdateBudgets(BenchOptions const& opt, std::vector<BenchTarget> const& targets, SampleLoader const& loader)
+{
+    // what isn't rendered keeps its budget
+    std::vector<RenderBudget> budgets = ReadBudgets(opt.update_budgets);
+
+    int failures = 0;
+    for (auto& t : targets)
+    {
+        try
+        {
+            BenchResult r = RenderFastest(t, opt, loader);
+
+            RenderBudget b;
+            b.name = t.name;
+            b.seconds = t.example ? static_cast<double>(r.frames) / opt.samplerate : opt.seconds;
+            b.samplerate = opt.samplerate;
+            b.budget_ms = r.wall * 1e3 * (1.0 + opt.time_slack);
+
+            auto it = std::find_if(budgets.begin(), budgets.end(), [&b](RenderBudget const& x) { return x.name == b.name; });
+            if (it != budgets.end())
+                *it = b;
+            else
+                budgets.push_back(b);
+
+            printf("%-28s %10.2f ms, budget %.2f ms\n", t.name.c_str(), r.wall * 1e3, b.budget_ms);
+        }
+        catch (const std::exception& e)
+        {
+            printf("%-28s failed: %s\n", t.name.c_str(), e.what());
+            ++failures;
+        }
+    }
+
+    WriteBudgets(opt.update_budgets, budgets);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int CheckBudgets(BenchOptions const& opt, SampleLoader const& loader)
+{
+    std::vector<RenderBudget> budgets = ReadBudgets(opt.check_budgets);
+    if (budgets.empty())
+        throw std::runtime_error("no budgets in " + opt.check_budgets + ", record them with --update-budgets");
+
+    int failures = 0;
+    int checked = 0;
+    for (auto& b : budgets)
+    {
+        if (!opt.graphs.empty() && std::find(opt.graphs.begin(), opt.graphs.end(), b.name) == opt.graphs.end())
+            continue;
+
+        ++checked;
+        try
+        {
+            BenchTarget t = FindBenchTarget(b.name);
+            BenchResult r = RenderFastest(t, RecordedOptions(opt, b.seconds, b.samplerate), loader);
+
+            if (r.wall * 1e3 > b.budget_ms)
+            {
+                char buff[128];
+                snprintf(buff, sizeof(buff), "took %.2f ms, over the budget of %.2f ms", r.wall * 1e3, b.budget_ms);
+                throw std::runtime_error(buff);
+            }
+
+            printf("%-28s ok %10.2f ms of %.2f ms\n", b.name.c_str(), r.wall * 1e3, b.budget_ms);
+        }
+        catch (const std::exception& e)
+        {
+            printf("%-28s FAILED: %s\n", b.name.c_str(), e.what());
+            ++failures;
+        }
+    }
+
+    printf("\n%d of %d failed\n", failures, checked);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// the partitioned convolver sums in single precision, so it drifts from a direct
+// convolution by a few parts in a hundred thousand of the output's peak
+const double ConvolverTolerance = 1e-4;
+
+int CheckConvolver(BenchOptions const& opt)
+{
+    // a decaying stereo noise response, long enough for every size of tail stage, and
+    // stereo noise to convolve, with more frames than the response so that the whole tail
+    // is heard
+    const int length = 2 * ConvolutionImpulse::MaxBlock + 7000;
+    const int quantum = ConvolutionImpulse::HeadBlock;
+    const int frames = (length + 2 * ConvolutionImpulse::MaxBlock) / quantum * quantum;
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> noise(-1.f, 1.f);
+
+    AudioBus ir(2, length);
+    for (int c = 0; c < 2; ++c)
+    {
+        float* h = ir.channel(c)->mutableData();
+        for (int i = 0; i < length; ++i)
+            h[i] = noise(random) * std::exp(-3.f * i / length);
+    }
+
+    std::vector<std::vector<float>> input(2, std::vector<float>(frames));
+    for (auto& x : input)
+        for (float& v : x)
+            v = noise(random);
+
+    PartitionedConvolver convolver(ConvolutionImpulse::prepare(ir, opt.samplerate, false));
+    std::vector<std::vector<float>> output(2, std::vector<float>(frames));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f += quantum)
+    {
+        const float* in[2] = { input[0].data() + f, input[1].data() + f };
+        float* out[2] = { output[0].data() + f, output[1].data() + f };
+        convolver.process(in, 2, out, quantum);
+    }
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // a direct convolution of every frame would take minutes, so compare every 61st, which
+    // lands on every offset into the blocks of each stage
+    double peak = 0;
+    double error = 0;
+    for (int c = 0; c < 2; ++c)
+    {
+        const float* h = ir.channel(c)->data();
+        const float* x = input[c].data();
+        for (int n = 0; n < frames; n += 61)
+        {
+            double y = 0;
+            for (int k = 0; k <= std::min(n, length - 1); ++k)
+                y += static_cast<double>(h[k]) * x[n - k];
+
+            peak = std::max(peak, std::abs(y));
+            error = std::max(error, std::abs(y - output[c][n]));
+        }
+    }
+
+    const double relative = peak > 0 ? error / peak : error;
+    printf("partitioned convolver, %d frame response, %d stages: %.2f ms, max error %.2g of peak\n",
+           length, static_cast<int>(convolver.impulse()->stages().size()), wall * 1e3, relative);
+
+    if (!(relative <= ConvolverTolerance))
+    {
+        printf("FAILED: over the tolerance of %.2g\n", ConvolverTolerance);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int CheckParamQueue(BenchOptions const& opt)
+{
+    // frames at which the gain changes, and the gain from then on; the changes fall on the
+    // first and last samples of a quantum, and in between, and two land on the same sample,
+    // where the one posted last wins
+    struct Step { uint64_t frame; float gain; };
+    const Step steps[] = { {0, 0.5f}, {300, 0.25f}, {300, 0.75f}, {511, 2.f}, {512, 0.125f}, {1000, 1.5f}, {1001, 0.f}, {2000, -1.f} };
+    const float initialGain = 1.f;
+    const uint64_t frames = 3000;
+
+    AudioStreamConfig offlineConfig;
+    offlineConfig.device_index = 0;
+    offlineConfig.desired_samplerate = opt.samplerate;
+    offlineConfig.desired_channels = 1;
+
+    const float ms = static_cast<float>(frames * 1000.0 / opt.samplerate);
+    std::unique_ptr<lab::AudioContext> context = lab::MakeOfflineAudioContext(offlineConfig, ms);
+    lab::AudioContext& ac = *context.get();
+
+    // device <- recorder <- param queue <- gain <- ones
+    auto ones = std::make_shared<FunctionNode>(ac, 1);
+    ones->setFunction([](ContextRenderLock&, FunctionNode*, int, float* values, int framesToProcess) {
+        std::fill(values, values + framesToProcess, 1.f);
+    });
+    auto gain = std::make_shared<GainNode>(ac);
+    gain->gain()->setValue(initialGain);
+    auto controls = std::make_shared<ParamQueueNode>(ac, 1);
+    auto recorder = std::make_shared<RecorderNode>(ac, offlineConfig);
+
+    context->connect(gain, ones, 0, 0);
+    context->connect(controls, gain, 0, 0);
+    context->connect(recorder, controls, 0, 0);
+    context->connect(context->device(), recorder, 0, 0);
+
+    const int param = controls->addParam(gain->gain());
+    for (Step const& s : steps)
+        controls->setValueAtTime(param, s.gain, s.frame / static_cast<double>(opt.samplerate));
+
+    ones->start(0);
+    recorder->startRecording();
+    StartOfflineRender(ac, ms)->wait();
+    recorder->stopRecording();
+
+    std::unique_ptr<AudioBus> recording = recorder->createBusFromRecording(false);
+    const float* y = recording->channel(0)->data();
+    const uint64_t recorded = std::min(frames, static_cast<uint64_t>(recording->length()));
+
+    uint64_t wrong = 0;
+    uint64_t first = 0;
+    float gainNow = initialGain;
+    size_t next = 0;
+    for (uint64_t n = 0; n < recorded; ++n)
+    {
+        while (next < sizeof(steps) / sizeof(steps[0]) && steps[next].frame == n)
+            gainNow = steps[next++].gain;
+        if (y[n] != gainNow && wrong++ == 0)
+            first = n;
+    }
+
+    printf("param queue, %d changes over %llu frames: %llu wrong samples\n",
+           static_cast<int>(sizeof(steps) / sizeof(steps[0])), static_cast<unsigned long long>(recorded), static_cast<unsigned long long>(wrong));
+
+    if (recorded < frames || wrong)
+    {
+        if (wrong)
+            printf("FAILED: the first at frame %llu, %g instead of the stamped gain\n", static_cast<unsigned long long>(first), y[first]);
+        else
+            printf("FAILED: only %llu frames were rendered\n", static_cast<unsigned long long>(recorded));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) try
+{
+    BenchOptions opt = ParseOptions(argc, argv);
+
+    if (opt.list)
+    {
+        for (auto& t : BenchTargets())
+            printf("%s\n", t.name.c_str());
+        return EXIT_SUCCESS;
+    }
+
+    if (opt.check_convolver)
+        return CheckConvolver(opt);
+    if (opt.check_param_queue)
+        return CheckParamQueue(opt);
+
+    std::vector<BenchTarget> targets;
+    if (opt.graphs.empty())
+        targets = BenchTargets();
+    else
+    {
+        for (auto& name : opt.graphs)
+            targets.push_back(FindBenchTarget(name));
+    }
+
+    // decoded samples are shared between graphs, so decoding is paid once per run
+    AssetCache assets(opt.asset_path);
+    assets.writeSidecars(opt.sidecars);
+    SampleLoader loader = [&assets](char const* const name, float sampleRate) {
+        return assets.get(name, sampleRate);
+    };
+
+    if (!opt.check_fingerprints.empty())
+        return CheckFingerprints(opt, targets, loader);
+    if (!opt.update_fingerprints.empty())
+        return UpdateFingerprints(opt, targets, loader);
+    if (!opt.check_budgets.empty())
+        return CheckBudgets(opt, loader);
+    if (!opt.update_budgets.empty())
+        return UpdateBudgets(opt, targets, loader);
+
+    const unsigned int threads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+    printf("%d Hz, %.1f seconds per graph, examples as long as they play, %s fast math, %u render thread%s\n\n",
+           static_cast<int>(opt.samplerate), opt.seconds, FastMathIsa(), threads, threads == 1 ? "" : "s");
+    printf("%-28s %8s %10s %12s %10s %10s %10s %10s\n",
+           "graph", "quanta", "wall ms", "quanta/s", "x realtime", "p50 us", "p99 us", "max us");
+
+    int failures = 0;
+    for (auto& t : targets)
+    {
+        try
+        {
+            BenchResult r = Render(t, opt, loader);
+            double quanta = static_cast<double>(r.frames) / AudioNode::ProcessingSizeInFrames;
+            double rendered = static_cast<double>(r.frames) / opt.samplerate;
+            printf("%-28s %8.0f %10.2f %12.0f %10.1f %10.2f %10.2f %10.2f\n",
+                   t.name.c_str(), quanta, r.wall * 1e3,
+                   r.wall > 0 ? quanta / r.wall : 0.0,
+                   r.wall > 0 ? rendered / r.wall : 0.0,
+                   r.quanta.p50 * 1e6, r.quanta.p99 * 1e6, r.quanta.max * 1e6);
+
+            if (r.latency > 0)
+                printf("    pipelined, %.2f ms added latency\n", r.latency * 1e3);
+
+            // most expensive first
+            for (auto& n : r.nodes)
+                printf("    %-18s %8llu calls %10.2f mean us %10.2f p99 us %10.2f max us\n",
+                       n.name, static_cast<unsigned long long>(n.calls), n.mean * 1e6, n.p99 * 1e6, n.max * 1e6);
+        }
+        catch (const std::exception& e)
+        {
+            printf("%-28s failed: %s\n", t.name.c_str(), e.what());
+            ++failures;
+        }
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+catch (const std::exception& e)
+{
+    std::cerr << "unhandled fatal exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#if defined(_MSC_VER)
+    #if !defined(_CRT_SECURE_NO_WARNINGS)
+        #define _CRT_SECURE_NO_WARNINGS
+    #endif
+    #if !defined(NOMINMAX)
+        #define NOMINMAX
+    #endif
+#endif
+
+#include "LabSound/LabSound.h"
+#include "LabSoundDemo.h"
+#include "HrtfDatabase.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace lab;
+
+// LabSoundHrtfCompiler compiles a directory of HRTF wav files into a single HrtfDatabase,
+// resampled and transformed for each of the given sample rates, so that spatializers map
+// it rather than decoding the directory.
+//
+//   LabSoundHrtfCompiler [hrtf_directory] [--output path] [--rate R]... [--subject name]
+//
+// The directory defaults to the installed hrtf assets, and the output to the directory's
+// name with the extension .lshr. Without --rate, kernels are compiled for 44.1, 48, 88.2
+// and 96 kHz. The subject names the responses, IRC_<subject>_C_R0195_T<azimuth>_P<elevation>.wav,
+// and defaults to Composite.
+
+int main(int argc, char* argv[]) try
+{
+    std::string directory = std::string(asset_base) + "hrtf";
+    std::string output;
+    std::string subject = "Composite";
+    std::vector<float> rates;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::invalid_argument(arg + " requires a value");
+            return argv[++i];
+        };
+
+        if (arg == "--output") output = value();
+        else if (arg == "--rate") rates.push_back(static_cast<float>(std::atof(value().c_str())));
+        else if (arg == "--subject") subject = value();
+        else if (arg.size() > 2 && arg[0] == '-' && arg[1] == '-') throw std::invalid_argument("unknown option " + arg);
+        else directory = arg;
+    }
+
+    while (directory.size() > 1 && (directory.back() == '/' || directory.back() == '\\'))
+        directory.pop_back();
+    if (output.empty())
+        output = directory + ".lshr";
+    if (rates.empty())
+        rates = { 44100.f, 48000.f, 88200.f, 96000.f };
+    for (float rate : rates)
+        if (rate <= 0)
+            throw std::invalid_argument("--rate must be positive");
+
+    auto start = std::chrono::steady_clock::now();
+    HrtfDatabase::compile(directory, subject, rates, output);
+    const double compileTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    std::shared_ptr<const HrtfDatabase> db = HrtfDatabase::open(output);
+    const double openTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!db)
+        throw std::runtime_error("couldn't open " + output + " after writing it");
+
+    printf("%s: %d azimuths x %d elevations, %.1f MB, compiled in %.2f s, opened in %.1f us\n",
+           output.c_str(), db->azimuths(), db->elevations(), db->bytes() / (1024.0 * 1024.0), compileTime, openTime * 1e6);
+    for (const HrtfDatabase::Rate& rate : db->rates())
+        printf("  %6.0f Hz  %d frame kernels\n", rate.sampleRate, rate.partitions * HrtfDatabase::Block);
+    return EXIT_SUCCESS;
+}
+catch (const std::exception& e)
+{
+    std::cerr << "unhandled fatal exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -8,6 +8,19 @@
 #include "LabSound/extended/Util.h"
 #include "LabSoundDemo.h"
 #include "ImGuiGridSlider.h"
+#include "AssetCache.h"
+#include "DemoKernels.h"
+#include "ExpressionNode.h"
+#include "FastMath.h"
+#include "GraphTransaction.h"
+#include "HrtfSpatializerNode.h"
+#include "ImpulseCache.h"
+#include "KernelNode.h"
+#include "NodeProfiler.h"
+#include "ParamQueueNode.h"
+#include "PartitionedConvolverNode.h"
+#include "WorkerPool.h"
+#include "OfflineRender.h"
 
 #include <algorithm>
 #include <array>
@@ -38,14 +51,18 @@ struct NodeLocation
 {
     float x = 0;
     std::string name;
+    AudioNode const* node = nullptr;    // key for the profiler, not dereferenced
 };
 
 
 struct Demo
 {
     std::unique_ptr<lab::AudioContext> context;
-    std::map<std::string, std::shared_ptr<AudioBus>> sample_cache;
+    AssetCache assets { asset_base, 256 * 1024 * 1024 };
+    ImpulseCache impulses;              // in the user's cache directory
+    WorkerPool asset_loaders { 2 };     // declared after the caches, so it is stopped first
     std::shared_ptr<RecorderNode> recorder;
+    std::shared_ptr<NodeProfilerNode> profiler;
     bool use_live = false;
 
     void shutdown()
@@ -55,20 +72,52 @@ struct Demo
 
     std::shared_ptr<AudioBus> MakeBusFromSampleFile(char const* const name, float sampleRate)
     {
-        auto it = sample_cache.find(name);
-        if (it != sample_cache.end())
-            return it->second;
+        return assets.get(name, sampleRate);
+    }
 
-        std::string path_prefix = asset_base;
+    // a prepared impulse response, mapped from the cache after the first time it's used.
+    // Once LoadImpulseAsync's future is ready, and while it is held, this doesn't prepare
+    // the response again.
+    std::shared_ptr<const ConvolutionImpulse> MakeImpulseFromSampleFile(char const* const name, float sampleRate)
+    {
+        return impulses.get(std::string(asset_base) + name, sampleRate);
+    }
 
-        const std::string path = path_prefix + name;
-        std::shared_ptr<AudioBus> bus = MakeBusFromFile(path, false, sampleRate);
-        if (!bus)
-            throw std::runtime_error("couldn't open " + path);
+    // starts decoding a sample on the asset loaders
+    AssetCache::Future LoadSampleAsync(char const* const name, float sampleRate)
+    {
+        return assets.getAsync(asset_loaders, name, sampleRate);
+    }
+
+    // starts preparing an impulse response on the asset loaders
+    ImpulseCache::Future LoadImpulseAsync(char const* const name, float sampleRate)
+    {
+        return impulses.getAsync(asset_loaders, std::string(asset_base) + name, sampleRate);
+    }
 
-        sample_cache[name] = bus;
+    // the compiled hrtf database, compiled into the user's cache the first time it's used
+    // at this rate. While a database is open, loading it again shares it.
+    std::shared_ptr<const HrtfDatabase> MakeHrtfDatabase(float sampleRate)
+    {
+        return HrtfDatabase::load(std::string(asset_base) + "hrtf", sampleRate);
+    }
 
-        return bus;
+    // starts opening, or compiling, the hrtf database on the asset loaders
+    std::shared_future<std::shared_ptr<const HrtfDatabase>> LoadHrtfAsync(float sampleRate)
+    {
+        auto promise = std::make_shared<std::promise<std::shared_ptr<const HrtfDatabase>>>();
+        auto database = promise->get_future().share();
+        asset_loaders.submit([this, promise, sampleRate]() {
+            try
+            {
+                promise->set_value(MakeHrtfDatabase(sampleRate));
+            }
+            catch (...)
+            {
+                promise->set_exception(std::current_exception());
+            }
+        });
+        return database;
     }
 
 };
@@ -83,19 +132,25 @@ struct Demo
 std::vector<NodeLocation> displayNodes;
 std::set<uintptr_t> nodes;
 
-void traverse(ContextRenderLock* r, AudioNode* root, char const* const prefix, int tab)
+void traverse(ContextRenderLock* r, AudioNode* root, char const* const prefix, int tab, NodeProfilerNode const* profiler)
 {
     nodes.insert(reinterpret_cast<uintptr_t>(root));
     for (int i = 0; i < tab; ++i)
         printf(" ");
 
-    displayNodes.push_back({ static_cast<float>(tab), std::string(root->name()) });
+    displayNodes.push_back({ static_cast<float>(tab), std::string(root->name()), root });
 
     bool inputs_silent = root->numberOfInputs() > 0 && root->inputsAreSilent(*r);
 
     const char* state_name = root->isScheduledNode() ? schedulingStateName(root->_scheduler._playbackState) : "active";
     const char* input_status = root->numberOfInputs() > 0 ? (root->inputsAreSilent(*r) ? "inputs silent" : "inputs active") : "no inputs";
-    printf("%s%s (%s) (%s)\n", prefix, root->name(), state_name, input_status);
+    printf("%s%s (%s) (%s)", prefix, root->name(), state_name, input_status);
+
+    NodeProfile profile;
+    if (profiler && profiler->profile(root, profile))
+        printf(" (%llu calls, us last %.1f mean %.1f p99 %.1f max %.1f)", static_cast<unsigned long long>(profile.calls),
+               profile.last * 1e6, profile.mean * 1e6, profile.p99 * 1e6, profile.max * 1e6);
+    printf("\n");
 
     auto params = root->params();
     for (auto& p : params)
@@ -122,7 +177,7 @@ void traverse(ContextRenderLock* r, AudioNode* root, char const* const prefix, i
                         char buff[64];
                         strncpy(buff, p->name().c_str(), 64);
                         buff[63] = '\0';
-                        traverse(r, n, buff, tab + 3);
+                        traverse(r, n, buff, tab + 3, profiler);
                     }
                     else
                     {
@@ -150,7 +205,7 @@ void traverse(ContextRenderLock* r, AudioNode* root, char const* const prefix, i
                 if (n)
                 {
                     if (nodes.find(reinterpret_cast<uintptr_t>(n)) == nodes.end())
-                        traverse(r, n, "", tab + 3);
+                        traverse(r, n, "", tab + 3, profiler);
                     else
                     {
                         for (int i = 0; i < tab; ++i)
@@ -163,14 +218,14 @@ void traverse(ContextRenderLock* r, AudioNode* root, char const* const prefix, i
     }
 }
 
-void traverse_ui(lab::AudioContext& context)
+void traverse_ui(lab::AudioContext& context, NodeProfilerNode const* profiler = nullptr)
 {
     displayNodes.clear();
     nodes.clear();
     printf("\n");
     context.synchronizeConnections();
     ContextRenderLock r(&context, "traverse");
-    traverse(&r, context.device().get(), "", 0);
+    traverse(&r, context.device().get(), "", 0, profiler);
 }
 
 
@@ -186,32 +241,41 @@ struct labsound_example
     Demo* _demo;
     std::shared_ptr<lab::AudioNode> _root_node;
 
-    void connect()
+    // queue the example's connection to the output, or its removal, on a transaction, so
+    // that switching examples takes one round trip to the render thread
+    void connect(GraphTransaction& t)
     {
         if (!_root_node)
             return;
 
         auto& ac = *_demo->context.get();
         if (!ac.isConnected(_demo->recorder, _root_node))
-        {
-            // connect synchronously
-            ac.connect(_demo->recorder, _root_node, 0, 0);
-            ac.synchronizeConnections();
-            _root_node->_scheduler.start(0);
-        }
+            t.connect(_demo->recorder, _root_node, 0, 0).start(_root_node, 0);
     }
 
-    void disconnect()
+    void disconnect(GraphTransaction& t)
     {
         if (!_root_node)
             return;
 
         auto& ac = *_demo->context.get();
-        if (!ac.isConnected(_demo->recorder, _root_node))
-        {
-            ac.disconnect(_demo->recorder, _root_node);
-            ac.synchronizeConnections();
-        }
+        if (ac.isConnected(_demo->recorder, _root_node))
+            t.disconnect(_demo->recorder, _root_node);
+    }
+
+    void connect()
+    {
+        // connect synchronously
+        GraphTransaction t(*_demo->context.get());
+        connect(t);
+        t.commit();
+    }
+
+    void disconnect()
+    {
+        GraphTransaction t(*_demo->context.get());
+        disconnect(t);
+        t.commit();
     }
 
     virtual void play() = 0;
@@ -524,6 +588,11 @@ struct ex_offline_rendering : public labsound_example
     std::shared_ptr<AudioBus> musicClip;
     std::string path;
 
+    // the render in flight; the context and recorder must outlive it
+    std::unique_ptr<lab::AudioContext> context;
+    std::shared_ptr<RecorderNode> recorder;
+    std::shared_ptr<OfflineRenderHandle> render;
+
     virtual char const* const name() const override { return "Offline"; }
 
     explicit ex_offline_rendering(Demo& demo) : labsound_example(demo) 
@@ -535,6 +604,10 @@ struct ex_offline_rendering : public labsound_example
 
     virtual void play() override
     {
+        // a previous render must finish before its context is replaced
+        if (render && !render->done())
+            return;
+
         auto& ac = *_demo->context.get();
         std::shared_ptr<SampledAudioNode> musicClipNode;
         std::shared_ptr<OscillatorNode> oscillator;
@@ -547,9 +620,10 @@ struct ex_offline_rendering : public labsound_example
 
         const float recording_time_ms = 1000.f;
 
-        std::unique_ptr<lab::AudioContext> context = lab::MakeOfflineAudioContext(offlineConfig, recording_time_ms);
+        render.reset();
+        context = lab::MakeOfflineAudioContext(offlineConfig, recording_time_ms);
 
-        auto recorder = std::make_shared<RecorderNode>(*context.get(), offlineConfig);
+        recorder = std::make_shared<RecorderNode>(*context.get(), offlineConfig);
         context->addAutomaticPullNode(recorder);
 
         {
@@ -572,10 +646,9 @@ struct ex_offline_rendering : public labsound_example
             musicClipNode->schedule(0.0);
         }
 
-        // make the recorder ready, and set up a completion callback to write the result
+        // make the recorder ready, and set up a completion function to write the result
         recorder->startRecording();
-        bool complete = false;
-        context->offlineRenderCompleteCallback = [this, &context, &recorder, &complete]() 
+        auto on_complete = [this]()
         {
             recorder->stopRecording();
 
@@ -583,13 +656,24 @@ struct ex_offline_rendering : public labsound_example
 
             context->removeAutomaticPullNode(recorder);
             recorder->writeRecordingToWav(path.c_str(), false);
-            complete = true;
         };
 
-        // Offline rendering happens in a separate thread and blocks until complete.
+        // Offline rendering happens in a separate thread, the ui polls the handle for progress.
         // It needs to acquire the graph + render locks, so it must
         // be outside the scope of where we make changes to the graph.
-        context->startOfflineRendering();
+        render = StartOfflineRender(*context.get(), recording_time_ms, on_complete);
+    }
+
+    virtual void ui() override final
+    {
+        ImGui::BeginChild("###OFFLINE", ImVec2{ 0, 100 }, true);
+        if (!render)
+            ImGui::TextUnformatted("Not rendered yet");
+        else if (render->done())
+            ImGui::Text("Wrote %s", path.c_str());
+        else
+            ImGui::ProgressBar(render->progress());
+        ImGui::EndChild();
     }
 };
 
@@ -924,9 +1008,8 @@ struct ex_microphone_loopback : public labsound_example
 // DANGER! This sample creates an open feedback loop. It is best used when the output audio device is a pair of headphones. 
 struct ex_microphone_reverb : public labsound_example
 {
-    std::shared_ptr<AudioBus> impulseResponseClip;
     std::shared_ptr<AudioHardwareInputNode> input;
-    std::shared_ptr<ConvolverNode> convolve;
+    std::shared_ptr<PartitionedConvolverNode> convolve;
     std::shared_ptr<GainNode> wetGain;
 
     virtual char const* const name() const override { return "Mic Reverb"; }
@@ -934,15 +1017,17 @@ struct ex_microphone_reverb : public labsound_example
     explicit ex_microphone_reverb(Demo& demo) : labsound_example(demo)
     {
         auto& ac = *_demo->context.get();
-        std::shared_ptr<AudioBus> impulseResponseClip = _demo->MakeBusFromSampleFile("impulse/cardiod-rear-levelled.wav", ac.sampleRate());
+        std::shared_ptr<const ConvolutionImpulse> impulseResponse = _demo->MakeImpulseFromSampleFile("impulse/cardiod-rear-levelled.wav", ac.sampleRate());
+
+        // the tail of the response is convolved on background threads, so the live input
+        // is reverberated without added latency
+        convolve = std::make_shared<PartitionedConvolverNode>(ac);
+        convolve->setImpulse(impulseResponse);
 
         ContextRenderLock r(&ac, "ex_microphone_reverb");
 
         input = lab::MakeAudioHardwareInputNode(r);
 
-        convolve = std::make_shared<ConvolverNode>(ac);
-        convolve->setImpulse(impulseResponseClip);
-
         wetGain = std::make_shared<GainNode>(ac);
         wetGain->gain()->setValue(0.6f);
 
@@ -1053,6 +1138,8 @@ struct ex_stereo_panning : public labsound_example
 {
     std::shared_ptr<SampledAudioNode> audioClipNode;
     std::shared_ptr<StereoPannerNode> stereoPanner;
+    std::shared_ptr<ParamQueueNode> controls;
+    int panParam;
     std::chrono::steady_clock::time_point prev;
     bool autopan;
     float pos;
@@ -1065,7 +1152,11 @@ struct ex_stereo_panning : public labsound_example
         std::shared_ptr<AudioBus> audioClip = _demo->MakeBusFromSampleFile("samples/trainrolling.wav", ac.sampleRate());
         audioClipNode = std::make_shared<SampledAudioNode>(ac);
         stereoPanner = std::make_shared<StereoPannerNode>(ac);
-        _root_node = stereoPanner;
+
+        // pan changes from the ui thread are applied by the render thread
+        controls = std::make_shared<ParamQueueNode>(ac);
+        panParam = controls->addParam(stereoPanner->pan());
+        _root_node = controls;
         autopan = true;
         pos = 0.f;
 
@@ -1074,6 +1165,7 @@ struct ex_stereo_panning : public labsound_example
 
             audioClipNode->setBus(r, audioClip);
             ac.connect(stereoPanner, audioClipNode, 0, 0);
+            ac.connect(controls, stereoPanner, 0, 0);
         }
     }
 
@@ -1103,9 +1195,7 @@ struct ex_stereo_panning : public labsound_example
         float halfTime = seconds * 0.5f;
         pos = (t - halfTime) / halfTime;
 
-        // Put position a +up && +front, because if it goes right through the
-        // listener at (0, 0, 0) it abruptly switches from left to right.
-        stereoPanner->pan()->setValue(pos);
+        controls->setValue(panParam, pos);
     }
 
     virtual void ui() override final
@@ -1117,7 +1207,7 @@ struct ex_stereo_panning : public labsound_example
         if (ImGui::SliderFloat("Pan", &pos, -1.f, 1.f, "%0.3f"))
         {
             autopan = false;
-            stereoPanner->pan()->setValue(pos);
+            controls->setValue(panParam, pos);
         }
         ImGui::EndChild();
     }
@@ -1129,12 +1219,12 @@ struct ex_stereo_panning : public labsound_example
 //    ex_hrtf_spatialization    //
 //////////////////////////////////
 
-// This illustrates 3d sound spatialization and doppler shift. Headphones are recommended for this sample.
+// This illustrates 3d sound spatialization. Headphones are recommended for this sample.
 struct ex_hrtf_spatialization : public labsound_example
 {
     std::shared_ptr<AudioBus> audioClip;
     std::shared_ptr<SampledAudioNode> audioClipNode;
-    std::shared_ptr<PannerNode> panner;
+    std::shared_ptr<HrtfSpatializerNode> spatializer;
     std::chrono::steady_clock::time_point prev;
     ImVec4 pos;
     ImVec4 minPos;
@@ -1155,27 +1245,28 @@ struct ex_hrtf_spatialization : public labsound_example
         audioClip = _demo->MakeBusFromSampleFile("samples/trainrolling.wav", ac.sampleRate());
         audioClipNode = std::make_shared<SampledAudioNode>(ac);
 
-        std::string hrtf_path = asset_base;
-        hrtf_path += "/hrtf";
-
-        panner = std::make_shared<PannerNode>(ac, hrtf_path.c_str());  // note hrtf search path
-        _root_node = panner;
+        // the database was opened on the asset loaders, so this shares it
+        spatializer = std::make_shared<HrtfSpatializerNode>(ac, _demo->MakeHrtfDatabase(ac.sampleRate()), 1);
+        _root_node = spatializer;
+        setPosition();
 
         ContextRenderLock r(&ac, "ex_hrtf_spatialization");
 
-        panner->setPanningModel(PanningMode::HRTF);
-
         audioClipNode->setBus(r, audioClip);
-        ac.connect(panner, audioClipNode, 0, 0);
+        ac.connect(spatializer, audioClipNode, 0, 0);
+    }
+
+    // positions are relative to the listener; the render thread reads them at the next
+    // quantum, and the spatializer smooths them
+    void setPosition()
+    {
+        spatializer->setPosition(0, pos.x, pos.y, pos.z);
     }
 
     virtual void play() override final
     {
         connect();
 
-        auto& ac = *_demo->context.get();
-        ac.listener()->setPosition({ 0, 0, 0 });
-        panner->setVelocity(4, 0, 0);
         prev = std::chrono::steady_clock::now();
         audioClipNode->schedule(0.0, -1); // -1 to loop forever
     }
@@ -1195,7 +1286,7 @@ struct ex_hrtf_spatialization : public labsound_example
         float halfTime = seconds * 0.5f;
         pos.x = (t - halfTime) / halfTime;
 
-        panner->setPosition({ pos.x, pos.y, pos.z });
+        setPosition();
     }
     
     virtual void ui() override final
@@ -1207,7 +1298,7 @@ struct ex_hrtf_spatialization : public labsound_example
         if (InputVec3("Pos", &pos, minPos, maxPos, 1.f))
         {
             autopan = false;
-            panner->setPosition({ pos.x, pos.y, pos.z });
+            setPosition();
         }
         if (ImGui::Button("Stop"))
             disconnect();
@@ -1225,7 +1316,7 @@ struct ex_hrtf_spatialization : public labsound_example
 // This shows the use of the `ConvolverNode` to produce reverb from an arbitrary impulse response.
 struct ex_convolution_reverb : public labsound_example
 {
-    std::shared_ptr<ConvolverNode> convolve;
+    std::shared_ptr<PartitionedConvolverNode> convolve;
     std::shared_ptr<GainNode> wetGain;
     std::shared_ptr<GainNode> dryGain;
     std::shared_ptr<SampledAudioNode> voiceNode;
@@ -1236,22 +1327,22 @@ struct ex_convolution_reverb : public labsound_example
     explicit ex_convolution_reverb(Demo& demo) : labsound_example(demo)
     {
         auto& ac = *_demo->context.get();
-        std::shared_ptr<AudioBus> impulseResponseClip = _demo->MakeBusFromSampleFile("impulse/cardiod-rear-levelled.wav", ac.sampleRate());
+        std::shared_ptr<const ConvolutionImpulse> impulseResponse = _demo->MakeImpulseFromSampleFile("impulse/cardiod-rear-levelled.wav", ac.sampleRate());
         std::shared_ptr<AudioBus> voiceClip = _demo->MakeBusFromSampleFile("samples/voice.ogg", ac.sampleRate());
 
-        if (!impulseResponseClip || !voiceClip)
+        if (!impulseResponse || !voiceClip)
         {
             std::cerr << "Could not open sample data\n";
             return;
         }
 
+        convolve = std::make_shared<PartitionedConvolverNode>(ac);
+        convolve->setImpulse(impulseResponse);
+
         ContextRenderLock r(&ac, "ex_convolution_reverb");
         masterGain = std::make_shared<GainNode>(ac);
         masterGain->gain()->setValue(0.5f);
 
-        convolve = std::make_shared<ConvolverNode>(ac);
-        convolve->setImpulse(impulseResponseClip);
-
         wetGain = std::make_shared<GainNode>(ac);
         wetGain->gain()->setValue(0.5f);
         dryGain = std::make_shared<GainNode>(ac);
@@ -1505,12 +1596,12 @@ struct ex_dalek_filter : public labsound_example
 /////////////////////////////////
 
 // This is another example of a non-trival graph constructed with the LabSound API. Furthermore, it incorporates
-// the use of several `FunctionNodes` that are base types used for implementing complex DSP without modifying
+// the use of several `KernelNodes`, which implement complex DSP as inlined kernels without modifying
 // LabSound internals directly.
 struct ex_redalert_synthesis : public labsound_example
 {
-    std::shared_ptr<FunctionNode> sweep;
-    std::shared_ptr<FunctionNode> outputGainFunction;
+    std::shared_ptr<KernelNode<RedAlertSweep, 1>> sweep;
+    std::shared_ptr<KernelNode<RedAlertGate, 1>> outputGainFunction;
 
     std::shared_ptr<OscillatorNode> osc;
     std::shared_ptr<GainNode> oscGain;
@@ -1532,49 +1623,9 @@ struct ex_redalert_synthesis : public labsound_example
         auto& ac = *_demo->context.get();
         ContextRenderLock r(&ac, "ex_redalert_synthesis");
 
-        sweep = std::make_shared<FunctionNode>(ac, 1);
-        sweep->setFunction([](ContextRenderLock& r, FunctionNode* me, int channel, float* values, size_t framesToProcess) 
-        {
-            double dt = 1.0 / r.context()->sampleRate();
-            double now = fmod(me->now(), 1.2f);
-
-            for (size_t i = 0; i < framesToProcess; ++i)
-            {
-                //0 to 1 in 900 ms with a 1200ms gap in between
-                if (now > 0.9)
-                {
-                    values[i] = 487.f + 360.f;
-                }
-                else
-                {
-                    values[i] = std::sqrt((float)now * 1.f / 0.9f) * 487.f + 360.f;
-                }
+        sweep = std::make_shared<KernelNode<RedAlertSweep, 1>>(ac);
 
-                now += dt;
-            }
-        });
-
-        outputGainFunction = std::make_shared<FunctionNode>(ac, 1);
-        outputGainFunction->setFunction([](ContextRenderLock& r, FunctionNode* me, int channel, float* values, size_t framesToProcess) 
-        {
-            double dt = 1.0 / r.context()->sampleRate();
-            double now = fmod(me->now(), 1.2f);
-
-            for (size_t i = 0; i < framesToProcess; ++i)
-            {
-                //0 to 1 in 900 ms with a 1200ms gap in between
-                if (now > 0.9)
-                {
-                    values[i] = 0;
-                }
-                else
-                {
-                    values[i] = 0.333f;
-                }
-
-                now += dt;
-            }
-        });
+        outputGainFunction = std::make_shared<KernelNode<RedAlertGate, 1>>(ac);
 
         osc = std::make_shared<OscillatorNode>(ac);
         osc->setType(OscillatorType::SAWTOOTH);
@@ -1679,220 +1730,91 @@ struct ex_redalert_synthesis : public labsound_example
 
 // "Unexpected Token" from Wavepot. Original by Stagas: http://wavepot.com/stagas/unexpected-token (MIT License)
 // Wavepot is effectively ShaderToy but for the WebAudio API. 
-// This sample shows the utility of LabSound as an experimental playground for DSP (synthesis + processing) using the `FunctionNode`. 
+// This sample shows the utility of LabSound as an experimental playground for DSP (synthesis + processing), with the groove box rendered by a `KernelNode`.
 struct ex_wavepot_dsp : public labsound_example
 {
-    float note(int n, int octave = 0)
-    {
-        return std::pow(2.0f, (n - 33.f + (12.f * octave)) / 12.0f) * 440.f;
-    }
-
-    std::vector<std::vector<int>> bassline = {
-        {7, 7, 7, 12, 10, 10, 10, 15},
-        {7, 7, 7, 15, 15, 17, 10, 29},
-        {7, 7, 7, 24, 10, 10, 10, 19},
-        {7, 7, 7, 15, 29, 24, 15, 10} };
-
-    std::vector<int> melody = {
-        7, 15, 7, 15,
-        7, 15, 10, 15,
-        10, 12, 24, 19,
-        7, 12, 10, 19 };
-
-    std::vector<std::vector<int>> chords = { {7, 12, 17, 10}, {10, 15, 19, 24} };
-
-    float quickSin(float x, float t)
-    {
-        return std::sin(2.0f * float(static_cast<float>(LAB_PI)) * t * x);
-    }
-
-    float quickSaw(float x, float t)
-    {
-        return 1.0f - 2.0f * fmod(t, (1.f / x)) * x;
-    }
-
-    float quickSqr(float x, float t)
-    {
-        return quickSin(x, t) > 0 ? 1.f : -1.f;
-    }
-
-    // perc family of functions implement a simple attack/decay, creating a short & percussive envelope for the signal
-    float perc(float wave, float decay, float o, float t)
-    {
-        float env = std::max(0.f, 0.889f - (o * decay) / ((o * decay) + 1.f));
-        auto ret = wave * env;
-        return ret;
-    }
-
-    float perc_b(float wave, float decay, float o, float t)
-    {
-        float env = std::min(0.f, 0.950f - (o * decay) / ((o * decay) + 1.f));
-        auto ret = wave * env;
-        return ret;
-    }
-
-    float hardClip(float n, float x)
-    {
-        return x > n ? n : x < -n ? -n : x;
-    }
-
-    struct FastLowpass
-    {
-        float v = 0;
-        float operator()(float n, float input)
-        {
-            return v += (input - v) / n;
-        }
-    };
-
-    struct FastHighpass
-    {
-        float v = 0;
-        float operator()(float n, float input)
-        {
-            return v += input - v * n;
-        }
-    };
-
-    // http://www.musicdsp.org/showone.php?id=24
-    // A Moog-style 24db resonant lowpass
-    struct MoogFilter
-    {
-        float y1 = 0;
-        float y2 = 0;
-        float y3 = 0;
-        float y4 = 0;
-
-        float oldx = 0;
-        float oldy1 = 0;
-        float oldy2 = 0;
-        float oldy3 = 0;
-
-        float p, k, t1, t2, r, x;
-
-        float process(float cutoff_, float resonance_, float sample_, float sampleRate)
-        {
-            float cutoff = 2.0f * cutoff_ / sampleRate;
-            float resonance = static_cast<float>(resonance_);
-            float sample = static_cast<float>(sample_);
-
-            p = cutoff * (1.8f - 0.8f * cutoff);
-            k = 2.f * std::sin(cutoff * static_cast<float>(M_PI) * 0.5f) - 1.0f;
-            t1 = (1.0f - p) * 1.386249f;
-            t2 = 12.0f + t1 * t1;
-            r = resonance * (t2 + 6.0f * t1) / (t2 - 6.0f * t1);
-
-            x = sample - r * y4;
-
-            // Four cascaded one-pole filters (bilinear transform)
-            y1 = x * p + oldx * p - k * y1;
-            y2 = y1 * p + oldy1 * p - k * y2;
-            y3 = y2 * p + oldy2 * p - k * y3;
-            y4 = y3 * p + oldy3 * p - k * y4;
-
-            // Clipping band-limited sigmoid
-            y4 -= (y4 * y4 * y4) / 6.f;
-
-            oldx = x;
-            oldy1 = y1;
-            oldy2 = y2;
-            oldy3 = y3;
-
-            return y4;
-        }
-    };
-
-    MoogFilter lp_a[2];
-    MoogFilter lp_b[2];
-    MoogFilter lp_c[2];
-
-    FastLowpass fastlp_a[2];
-    FastHighpass fasthp_c[2];
-
-    std::shared_ptr<FunctionNode> grooveBox;
+    std::shared_ptr<KernelNode<WavepotGrooveBox, 2>> grooveBox;
     std::shared_ptr<ADSRNode> envelope;
 
-    double elapsedTime;
     float songLenSeconds;
 
     virtual char const* const name() const override { return "Wavepot DSP"; }
 
     explicit ex_wavepot_dsp(Demo& demo) : labsound_example(demo)
     {
-        elapsedTime = 0.;
         songLenSeconds = 12.0f;
 
         auto& ac = *_demo->context.get();
         envelope = std::make_shared<ADSRNode>(ac);
         envelope->set(6.0f, 0.75f, 0.125, 14.0f, 0.0f, songLenSeconds);
         envelope->gate()->setValue(1.f);
-        grooveBox = std::make_shared<FunctionNode>(ac, 2);
-
-        grooveBox->setFunction([this](ContextRenderLock& r, FunctionNode* self, int channel, float* samples, size_t framesToProcess)
-        {
-            float lfo_a, lfo_b, lfo_c;
-            float bassWaveform, percussiveWaveform, bassSample;
-            float padWaveform, padSample;
-            float kickWaveform, kickSample;
-            float synthWaveform, synthPercussive, synthDegradedWaveform, synthSample;
-                
-            float dt = 1.f / r.context()->sampleRate();  // time duration of one sample
-            float now = static_cast<float>(self->now());
+        grooveBox = std::make_shared<KernelNode<WavepotGrooveBox, 2>>(ac);
 
-            int nextMeasure = int((now / 2)) % bassline.size();
-            auto bm = bassline[nextMeasure];
-
-            int nextNote = int((now * 4.f)) % bm.size();
-            float bn = note(bm[nextNote], 0);
-
-            auto p = chords[int(now / 4) % chords.size()];
+        ac.connect(envelope, grooveBox, 0, 0);
+        _root_node = envelope;
+    }
 
-            auto mn = note(melody[int(now * 3.f) % melody.size()], int(2 - (now * 3)) % 4);
+    virtual void play() override final
+    {
+        // the example may already be connected by the selection's transaction
+        if (!grooveBox->isPlayingOrScheduled())
+            grooveBox->start(0);
+        connect();
+    }
 
-            for (size_t i = 0; i < framesToProcess; ++i)
-            {
-                lfo_a = quickSin(2.0f, now);
-                lfo_b = quickSin(1.0f / 32.0f, now);
-                lfo_c = quickSin(1.0f / 128.0f, now);
+    virtual void ui() override final
+    {
+        if (!_root_node || !_root_node->output(0)->isConnected())
+            return;
 
-                // Bass
-                bassWaveform = quickSaw(bn, now) * 1.9f + quickSqr(bn / 2.f, now) * 1.0f + quickSin(bn / 2.f, now) * 2.2f + quickSqr(bn * 3.f, now) * 3.f;
-                percussiveWaveform = perc(bassWaveform / 3.f, 48.0f, fmod(now, 0.125f), now) * 1.0f;
-                bassSample = lp_a[channel].process(1000.f + (lfo_b * 140.f), quickSin(0.5f, now + 0.75f) * 0.2f, percussiveWaveform, r.context()->sampleRate());
+        ImGui::BeginChild("###WAVEPOT", ImVec2{ 0, 100 }, true);
+        ImGui::TextUnformatted("Wavepot DSP");
+        if (ImGui::Button("Stop"))
+        {
+            disconnect();
+        }
+        ImGui::EndChild();
+    }
+};
 
-                // Pad
-                padWaveform = 5.1f * quickSaw(note(p[0], 1), now) + 3.9f * quickSaw(note(p[1], 2), now) + 4.0f * quickSaw(note(p[2], 1), now) + 3.0f * quickSqr(note(p[3], 0), now);
-                padSample = 1.0f - ((quickSin(2.0f, now) * 0.28f) + 0.5f) * fasthp_c[channel](0.5f, lp_c[channel].process(1100.f + (lfo_a * 150.f), 0.05f, padWaveform * 0.03f, r.context()->sampleRate()));
+///////////////////////////////
+//    ex_expression_dsp      //
+///////////////////////////////
 
-                // Kick
-                kickWaveform = hardClip(0.37f, quickSin(note(7, -1), now)) * 2.0f + hardClip(0.07f, quickSaw(note(7, -1), now * 0.2f)) * 4.00f;
-                kickSample = quickSaw(2.f, now) * 0.054f + fastlp_a[channel](240.0f, perc(hardClip(0.6f, kickWaveform), 54.f, fmod(now, 0.5f), now)) * 2.f;
+// ex_expression_dsp plays a program in ExpressionNode's language, which can be edited and
+// recompiled while it plays, or loaded from a file that is reloaded whenever it is saved.
+struct ex_expression_dsp : public labsound_example
+{
+    std::shared_ptr<ExpressionNode> expression;
+    std::shared_ptr<GainNode> gain;
 
-                // Synth
-                synthWaveform = quickSaw(mn, now + 1.0f) + quickSqr(mn * 2.02f, now) * 0.4f + quickSqr(mn * 3.f, now + 2.f);
-                synthPercussive = lp_b[channel].process(3200.0f + (lfo_a * 400.f), 0.1f, perc(synthWaveform, 1.6f, fmod(now, 4.f), now) * 1.7f, r.context()->sampleRate()) * 1.8f;
-                synthDegradedWaveform = synthPercussive * quickSin(note(5, 2), now);
-                synthSample = 0.4f * synthPercussive + 0.05f * synthDegradedWaveform;
+    std::array<char, 4096> source;
+    std::array<char, 512> path {};
+    bool watching = false;
+    std::string error;
 
-                // Mixer
-                samples[i] = (0.66f * hardClip(0.65f, bassSample)) + (0.50f * padSample) + (0.66f * synthSample) + (2.75f * kickSample);
+    virtual char const* const name() const override { return "Expression DSP"; }
 
-                now += dt;
-            }
+    explicit ex_expression_dsp(Demo& demo) : labsound_example(demo)
+    {
+        // the same groove LabSoundBench renders as expression_dsp
+        snprintf(source.data(), source.size(), "%s", ExpressionNode::exampleProgram());
 
-            elapsedTime += now;
-        });
+        auto& ac = *_demo->context.get();
+        expression = std::make_shared<ExpressionNode>(ac, 2);
+        expression->compile(source.data(), error);
 
-        ac.connect(envelope, grooveBox, 0, 0);
-        _root_node = envelope;
+        gain = std::make_shared<GainNode>(ac);
+        gain->gain()->setValue(0.5f);
+        ac.connect(gain, expression, 0, 0);
+        _root_node = gain;
     }
 
     virtual void play() override final
     {
-        if (_root_node && _root_node->output(0)->isConnected())
-            return;
-
-        grooveBox->start(0);
+        // the example may already be connected by the selection's transaction
+        if (!expression->isPlayingOrScheduled())
+            expression->start(0);
         connect();
     }
 
@@ -1901,12 +1823,35 @@ struct ex_wavepot_dsp : public labsound_example
         if (!_root_node || !_root_node->output(0)->isConnected())
             return;
 
-        ImGui::BeginChild("###WAVEPOT", ImVec2{ 0, 100 }, true);
-        ImGui::TextUnformatted("Wavepot DSP");
+        ImGui::BeginChild("###EXPRESSION", ImVec2{ 0, 300 }, true);
+        ImGui::TextUnformatted("Expression DSP");
+        ImGui::InputTextMultiline("###SOURCE", source.data(), source.size(), ImVec2{ -1, 200 });
+        if (ImGui::Button("Compile"))
+        {
+            // the node keeps playing the previous program if this one has an error
+            expression->compile(source.data(), error);
+            watching = false;
+        }
+        ImGui::SameLine();
+        ImGui::InputText("###PATH", path.data(), path.size());
+        ImGui::SameLine();
+        if (ImGui::Button("Load file"))
+        {
+            expression->compileFile(path.data(), error);
+            watching = true;
+        }
+
+        // edits saved from another editor play as soon as they compile
+        std::string reload_error;
+        if (watching && expression->reloadIfChanged(reload_error))
+            error = reload_error;
+        ImGui::SameLine();
         if (ImGui::Button("Stop"))
         {
             disconnect();
         }
+        if (!error.empty())
+            ImGui::TextUnformatted(error.c_str());
         ImGui::EndChild();
     }
 };
@@ -2047,6 +1992,7 @@ std::shared_ptr<ex_misc> misc;
 std::shared_ptr<ex_dalek_filter> dalek_filter;
 std::shared_ptr<ex_redalert_synthesis> redalert_synthesis;
 std::shared_ptr<ex_wavepot_dsp> wavepot_dsp;
+std::shared_ptr<ex_expression_dsp> expression_dsp;
 std::shared_ptr<ex_granulation_node> granulation;
 std::shared_ptr<ex_poly_blep> poly_blep;
 
@@ -2054,56 +2000,140 @@ std::vector<std::shared_ptr<labsound_example>> examples;
 
 std::shared_ptr<labsound_example> example_ui;
 
+// Examples are instantiated once the samples they use have been decoded, and their impulse
+// responses prepared. Both are loaded on the demo's asset loaders, so the ui is usable
+// straight away, and each example becomes playable as its assets arrive.
+struct ExampleSlot
+{
+    char const* name;                                   // shown while loading
+    std::vector<char const*> samples;
+    std::vector<char const*> impulses;
+    std::function<std::shared_ptr<labsound_example>(Demo&)> instantiate;
+
+    bool hrtf = false;                                  // uses the hrtf database
+
+    std::vector<AssetCache::Future> loads;
+    std::vector<ImpulseCache::Future> impulse_loads;    // held, so the responses stay prepared
+    std::shared_future<std::shared_ptr<const HrtfDatabase>> hrtf_load;  // held, so the database stays open
+    std::shared_ptr<labsound_example> example;
+    std::string error;
+};
+
+std::vector<ExampleSlot> example_slots;
 
+template <typename T>
+ExampleSlot make_slot(char const* name, std::shared_ptr<T>& example, std::vector<char const*> samples, std::vector<char const*> impulses = {})
+{
+    ExampleSlot slot;
+    slot.name = name;
+    slot.samples = std::move(samples);
+    slot.impulses = std::move(impulses);
+    slot.instantiate = [&example](Demo& demo) -> std::shared_ptr<labsound_example> {
+        example = std::make_shared<T>(demo);
+        return example;
+    };
+    return slot;
+}
+
+template <typename F>
+bool is_ready(F const& f)
+{
+    return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+bool is_loaded(ExampleSlot const& slot)
+{
+    return std::all_of(slot.loads.begin(), slot.loads.end(), is_ready<AssetCache::Future>)
+        && std::all_of(slot.impulse_loads.begin(), slot.impulse_loads.end(), is_ready<ImpulseCache::Future>)
+        && (!slot.hrtf_load.valid() || is_ready(slot.hrtf_load));
+}
+
+ExampleSlot with_hrtf(ExampleSlot slot)
+{
+    slot.hrtf = true;
+    return slot;
+}
 
 void instantiate_demos(Demo& demo)
 {
-    simple = std::make_shared<ex_simple>(demo);
-    sfxr = std::make_shared<ex_sfxr>(demo);
-    osc_pop = std::make_shared<ex_osc_pop>(demo);
-    playback_events = std::make_shared<ex_playback_events>(demo);
-    offline_rendering = std::make_shared<ex_offline_rendering>(demo);
-    tremolo = std::make_shared<ex_tremolo>(demo);
-    frequency_mod = std::make_shared<ex_frequency_modulation>(demo);
-    runtime_graph_update = std::make_shared<ex_runtime_graph_update>(demo);
-    microphone_loopback = std::make_shared<ex_microphone_loopback>(demo);
-    microphone_reverb = std::make_shared<ex_microphone_reverb>(demo);
-    peak_compressor = std::make_shared<ex_peak_compressor>(demo);
-    stereo_panning = std::make_shared<ex_stereo_panning>(demo);
-    hrtf_spatialization = std::make_shared<ex_hrtf_spatialization>(demo);
-    convolution_reverb = std::make_shared<ex_convolution_reverb>(demo);
-    misc = std::make_shared<ex_misc>(demo);
-    dalek_filter = std::make_shared<ex_dalek_filter>(demo);
-    redalert_synthesis = std::make_shared<ex_redalert_synthesis>(demo);
-    wavepot_dsp = std::make_shared<ex_wavepot_dsp>(demo);
-    granulation = std::make_shared<ex_granulation_node>(demo);
-    poly_blep = std::make_shared<ex_poly_blep>(demo);
-
-    examples.push_back(simple);
-    examples.push_back(sfxr);
-    examples.push_back(osc_pop);
-    examples.push_back(playback_events);
-    examples.push_back(offline_rendering);
-    examples.push_back(tremolo);
-    examples.push_back(frequency_mod);
-    examples.push_back(runtime_graph_update);
-    examples.push_back(microphone_loopback);
-    examples.push_back(microphone_reverb);
-    examples.push_back(peak_compressor);
-    examples.push_back(stereo_panning);
-    examples.push_back(hrtf_spatialization);
-    examples.push_back(convolution_reverb);
-    examples.push_back(misc);
-    examples.push_back(dalek_filter);
-    examples.push_back(redalert_synthesis);
-    examples.push_back(wavepot_dsp);
-    examples.push_back(granulation);
-    examples.push_back(poly_blep);
+    example_slots = {
+        make_slot("Simple", simple, { "samples/stereo-music-clip.wav" }),
+        make_slot("Sfxr", sfxr, {}),
+        make_slot("Oscillator", osc_pop, {}),
+        make_slot("Events", playback_events, { "samples/mono-music-clip.wav" }),
+        make_slot("Offline", offline_rendering, { "samples/stereo-music-clip.wav" }),
+        make_slot("Tremolo", tremolo, {}),
+        make_slot("Frequence Modulation", frequency_mod, {}),
+        make_slot("Graph Update", runtime_graph_update, {}),
+        make_slot("Mic Loopback", microphone_loopback, {}),
+        make_slot("Mic Reverb", microphone_reverb, {}, { "impulse/cardiod-rear-levelled.wav" }),
+        make_slot("Peak Compressor", peak_compressor, { "samples/kick.wav", "samples/hihat.wav", "samples/snare.wav" }),
+        make_slot("Stereo Panning", stereo_panning, { "samples/trainrolling.wav" }),
+        with_hrtf(make_slot("HRTF Spatialization", hrtf_spatialization, { "samples/trainrolling.wav" })),
+        make_slot("Convolution Reverb", convolution_reverb, { "samples/voice.ogg" }, { "impulse/cardiod-rear-levelled.wav" }),
+        make_slot("PingPong Delay", misc, { "samples/cello_pluck/cello_pluck_As0.wav" }),
+        make_slot("Mic Dalek", dalek_filter, { "samples/voice.ogg" }),
+        make_slot("Red Alert", redalert_synthesis, {}),
+        make_slot("Wavepot DSP", wavepot_dsp, {}),
+        make_slot("Expression DSP", expression_dsp, {}),
+        make_slot("Granulation", granulation, { "samples/cello_pluck/cello_pluck_As0.wav" }),
+        make_slot("Poly BLEP", poly_blep, {}),
+    };
+
+    const float sampleRate = demo.context->sampleRate();
+    for (auto& slot : example_slots)
+    {
+        for (auto sample : slot.samples)
+            slot.loads.push_back(demo.LoadSampleAsync(sample, sampleRate));
+        for (auto impulse : slot.impulses)
+            slot.impulse_loads.push_back(demo.LoadImpulseAsync(impulse, sampleRate));
+        if (slot.hrtf)
+            slot.hrtf_load = demo.LoadHrtfAsync(sampleRate);
+    }
+}
+
+// instantiates the examples whose assets have arrived, in the ui thread
+void update_demo_loading(Demo& demo)
+{
+    bool changed = false;
+    for (auto& slot : example_slots)
+    {
+        if (slot.example || !slot.error.empty())
+            continue;
+        if (!is_loaded(slot))
+            continue;
+
+        try
+        {
+            // surface load failures, then build the example from the now cached assets
+            for (auto& f : slot.loads)
+                f.get();
+            for (auto& f : slot.impulse_loads)
+                f.get();
+            if (slot.hrtf_load.valid())
+                slot.hrtf_load.get();
+            slot.example = slot.instantiate(demo);
+            changed = true;
+        }
+        catch (const std::exception& e)
+        {
+            slot.error = e.what();
+        }
+    }
+
+    if (!changed)
+        return;
+
+    examples.clear();
+    for (auto& slot : example_slots)
+        if (slot.example)
+            examples.push_back(slot.example);
 }
 
 void run_demo_ui(Demo& demo)
 {
     auto c = demo.context.get();
+    update_demo_loading(demo);
     for (auto& i : examples)
     {
         i->update();
@@ -2111,16 +2141,51 @@ void run_demo_ui(Demo& demo)
 
     ImGui::Columns(2);
 
-    for (auto& i : examples)
+    size_t loads = 0;
+    size_t loaded = 0;
+    for (auto& slot : example_slots)
     {
-        if (ImGui::Button(i->name()))
+        loads += slot.loads.size() + slot.impulse_loads.size() + (slot.hrtf_load.valid() ? 1 : 0);
+        loaded += std::count_if(slot.loads.begin(), slot.loads.end(), is_ready<AssetCache::Future>);
+        loaded += std::count_if(slot.impulse_loads.begin(), slot.impulse_loads.end(), is_ready<ImpulseCache::Future>);
+        loaded += slot.hrtf_load.valid() && is_ready(slot.hrtf_load) ? 1 : 0;
+    }
+    if (loaded < loads)
+    {
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "loading assets %zu/%zu", loaded, loads);
+        ImGui::ProgressBar(static_cast<float>(loaded) / loads, ImVec2(-FLT_MIN, 0), overlay);
+    }
+
+    for (auto& slot : example_slots)
+    {
+        auto& i = slot.example;
+        if (!i)
         {
-            if (example_ui)
-                example_ui->disconnect();
+            if (slot.error.empty())
+                ImGui::TextDisabled("%s (loading)", slot.name);
+            else
+                ImGui::TextDisabled("%s (%s)", slot.name, slot.error.c_str());
+            continue;
+        }
 
-            example_ui = i;
+        if (ImGui::Button(i->name()))
+        {
+            // swap the examples in one transaction; reselecting the active example leaves
+            // it connected
+            if (example_ui != i)
+            {
+                GraphTransaction t(*c);
+                if (example_ui)
+                    example_ui->disconnect(t);
+                i->connect(t);
+                t.commit();
+
+                example_ui = i;
+                demo.profiler->clear();
+            }
             i->play();
-            traverse_ui(*c);
+            traverse_ui(*c, demo.profiler.get());
         }
     }
 
@@ -2139,15 +2204,29 @@ void run_demo_ui(Demo& demo)
     if (example_ui && ImGui::Button("Disconnect demo"))
     {
         example_ui.reset();
+        GraphTransaction t(*c);
         for (auto& i : examples)
         {
-            i->disconnect();
+            i->disconnect(t);
         }
 
-        c->synchronizeConnections();
-        traverse_ui(*c);
+        t.commit();
+        traverse_ui(*c, demo.profiler.get());
     }
 
+    AssetCache::Stats assets = demo.assets.stats();
+    ImGui::Text("samples: %zu cached, %.1f of %.0f MB, %llu hits, %llu misses, %llu evicted",
+        assets.entries, assets.bytes / (1024.0 * 1024.0), assets.budget / (1024.0 * 1024.0),
+        static_cast<unsigned long long>(assets.hits), static_cast<unsigned long long>(assets.misses),
+        static_cast<unsigned long long>(assets.evictions));
+
+    if (ImGui::Button("Reset profile"))
+        demo.profiler->clear();
+    ImGui::SameLine();
+    if (ImGui::Button("Print graph"))
+        traverse_ui(*c, demo.profiler.get());
+
+    // per node process() time, in microseconds, updated live
     ImVec2 pos = ImGui::GetCursorPos();
     float y = 0;
     for (auto& i : displayNodes)
@@ -2158,6 +2237,14 @@ void run_demo_ui(Demo& demo)
         y += 15;
         ImGui::SetCursorPos(p);
         ImGui::Button(i.name.c_str());
+
+        NodeProfile profile;
+        if (demo.profiler->profile(i.node, profile))
+        {
+            ImGui::SameLine();
+            ImGui::Text("last %6.1f  mean %6.1f  p99 %6.1f  max %6.1f us", 
+                profile.last * 1e6, profile.mean * 1e6, profile.p99 * 1e6, profile.max * 1e6);
+        }
     }
 }
 
@@ -2261,7 +2348,11 @@ void run_context_ui(Demo& demo)
             demo.context = lab::MakeRealtimeAudioContext(outputConfig, inputConfig);
             auto& ac = *demo.context.get();
             demo.recorder = std::make_shared<RecorderNode>(ac, outputConfig);
-            demo.context->connect(ac.device(), demo.recorder);
+
+            // device <- profiler <- recorder <- examples
+            demo.profiler = std::make_shared<NodeProfilerNode>(ac, outputConfig.desired_channels);
+            demo.context->connect(ac.device(), demo.profiler);
+            demo.context->connect(demo.profiler, demo.recorder);
             demo.context->synchronizeConnections();
             instantiate_demos(demo);
         }
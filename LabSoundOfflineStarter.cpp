@@ -12,8 +12,19 @@
 
 #include "LabSound/LabSound.h"
 #include "LabSoundDemo.h"
+#include "AssetCache.h"
+#include "DemoGraphs.h"
+#include "OfflineRender.h"
+#include "StreamingRecorder.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
@@ -32,15 +43,178 @@ std::shared_ptr<AudioBus> MakeBusFromSampleFile(char const* const name, int argc
     return bus;
 }
 
-template <typename Duration>
-void Wait(Duration duration)
+// Batch mode renders a manifest of jobs on a fixed pool of threads, each job in its own
+// offline context. Decoded samples are shared between the jobs through an AssetCache,
+// so a batch pays startup and decoding costs once rather than once per render.
+//
+//   LabSoundOfflineStarter --manifest jobs.txt [--jobs N] [--sidecars] [asset_path]
+//
+// Each line of the manifest describes one job,
+//
+//   graph seconds output.wav [name=value]...
+//
+// where graph is one of the graphs of DemoGraphs.h, as listed by LabSoundBench --list, and
+// the name=value pairs override the graph's parameters. The ex_ examples it also lists are
+// not graphs, and play only in LabSoundDemo and the bench. Blank lines and lines starting
+// with # are ignored.
+//
+// --sidecars writes decoded samples to the user's cache directory, so later batches map
+// them in place.
+
+struct RenderJob
+{
+    std::string graph;
+    double seconds = 0;
+    std::string output;
+    std::map<std::string, float> params;
+};
+
+std::vector<RenderJob> ReadManifest(const std::string& path)
 {
-    std::this_thread::sleep_for(duration);
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("couldn't open " + path);
+
+    std::vector<RenderJob> jobs;
+    std::string line;
+    for (int line_number = 1; std::getline(file, line); ++line_number)
+    {
+        std::istringstream fields(line);
+        RenderJob job;
+        if (!(fields >> job.graph) || job.graph[0] == '#')
+            continue;
+
+        auto error = [&](const std::string& what) {
+            return std::runtime_error(path + ":" + std::to_string(line_number) + ": " + what);
+        };
+
+        if (!(fields >> job.seconds >> job.output) || job.seconds <= 0)
+            throw error("expected graph, seconds, and output path");
+        if (!FindDemoGraph(job.graph))
+            throw error("unknown graph " + job.graph);
+
+        std::string param;
+        while (fields >> param)
+        {
+            size_t eq = param.find('=');
+            if (eq == std::string::npos || eq == 0)
+                throw error("expected name=value, got " + param);
+            job.params[param.substr(0, eq)] = static_cast<float>(std::atof(param.c_str() + eq + 1));
+        }
+
+        jobs.push_back(job);
+    }
+    return jobs;
 }
 
+void RenderJobOffline(RenderJob const& job, AssetCache& assets, const std::string& asset_path)
+{
+    AudioStreamConfig offlineConfig;
+    offlineConfig.device_index = 0;
+    offlineConfig.desired_samplerate = LABSOUND_DEFAULT_SAMPLERATE;
+    offlineConfig.desired_channels = LABSOUND_DEFAULT_CHANNELS;
+
+    const float recording_time_ms = static_cast<float>(job.seconds * 1000.0);
+
+    std::unique_ptr<lab::AudioContext> context = lab::MakeOfflineAudioContext(offlineConfig, recording_time_ms);
+    lab::AudioContext& ac = *context.get();
+
+    SampleLoader loader = [&assets](char const* const name, float sampleRate) {
+        return assets.get(name, sampleRate);
+    };
+
+    DemoGraphSetup setup { ac, loader, asset_path, job.seconds };
+    setup.params = job.params;
+    DemoGraph graph = FindDemoGraph(job.graph)->build(setup);
+
+    auto recorder = std::make_shared<StreamingRecorderNode>(ac, offlineConfig.desired_channels);
+    recorder->setBlocking(true);
+    context->addAutomaticPullNode(recorder);
+    context->connect(recorder, graph.output, 0, 0);
+    if (!recorder->startRecording(job.output))
+        throw std::runtime_error("couldn't create " + job.output);
+
+    auto on_complete = [&context, &recorder]() {
+        context->removeAutomaticPullNode(recorder);
+        recorder->stopRecording();
+    };
+
+    auto render = StartOfflineRender(ac, recording_time_ms, on_complete);
+    render->wait();
+
+    // a blocking recorder only drops if it was stopped mid quantum, but a truncated file
+    // must never be reported as rendered
+    if (recorder->framesDropped())
+        throw std::runtime_error(std::to_string(recorder->framesDropped()) + " frames dropped writing " + job.output);
+}
+
+int RenderBatch(int argc, char** argv)
+{
+    std::string manifest;
+    std::string asset_path = asset_base;
+    unsigned int thread_count = std::max(1u, std::thread::hardware_concurrency());
+    bool sidecars = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if ((arg == "--manifest" || arg == "--jobs") && i + 1 >= argc)
+            throw std::invalid_argument(arg + " requires a value");
+
+        if (arg == "--manifest") manifest = argv[++i];
+        else if (arg == "--jobs") thread_count = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--sidecars") sidecars = true;
+        else asset_path = arg + "/";
+    }
+
+    const std::vector<RenderJob> jobs = ReadManifest(manifest);
+    AssetCache assets(asset_path);
+    assets.writeSidecars(sidecars);
+
+    // workers take the next job in the manifest until there are none left
+    std::atomic<size_t> next_job{0};
+    std::atomic<int> failures{0};
+    std::mutex print_mutex;
+    auto worker = [&]() {
+        for (size_t i = next_job++; i < jobs.size(); i = next_job++)
+        {
+            RenderJob const& job = jobs[i];
+            auto start = std::chrono::steady_clock::now();
+            try
+            {
+                RenderJobOffline(job, assets, asset_path);
+                auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                std::lock_guard<std::mutex> lock(print_mutex);
+                printf("%s: %s, %.1f s rendered in %.2f s\n", job.output.c_str(), job.graph.c_str(), job.seconds, elapsed);
+            }
+            catch (const std::exception& e)
+            {
+                ++failures;
+                std::lock_guard<std::mutex> lock(print_mutex);
+                printf("%s: failed: %s\n", job.output.c_str(), e.what());
+            }
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < std::min<size_t>(thread_count, jobs.size()); ++i)
+        threads.emplace_back(worker);
+    for (auto& t : threads)
+        t.join();
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%zu jobs on %zu threads in %.2f s, %d failed\n", jobs.size(), threads.size(), elapsed, failures.load());
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
 
 int main(int argc, char *argv[]) try
 {   
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--manifest")
+            return RenderBatch(argc, argv);
+    }
+
     AudioStreamConfig offlineConfig;
     offlineConfig.device_index = 0;
     offlineConfig.desired_samplerate = LABSOUND_DEFAULT_SAMPLERATE;
@@ -56,11 +230,12 @@ int main(int argc, char *argv[]) try
     std::shared_ptr<SampledAudioNode> musicClipNode;
     std::shared_ptr<GainNode> gain;
 
-    auto recorder = std::make_shared<RecorderNode>(ac, offlineConfig);
+    auto recorder = std::make_shared<StreamingRecorderNode>(ac, offlineConfig.desired_channels);
+    recorder->setBlocking(true);
 
     context->addAutomaticPullNode(recorder);
 
-    recorder->startRecording();
+    recorder->startRecording("ex_offline_rendering.wav");
 
     {
         ContextRenderLock r(context.get(), "ex_offline_rendering");
@@ -82,26 +257,24 @@ int main(int argc, char *argv[]) try
         musicClipNode->schedule(0.0);
     }
 
-    // the completion callback will be called when the 1000ms sample buffer has been filled.
-    bool complete = false;
-    context->offlineRenderCompleteCallback = [&context, &recorder, &complete]() {
+    // the completion function will be called when the 1000ms sample buffer has been filled.
+    auto on_complete = [&context, &recorder]() {
+        context->removeAutomaticPullNode(recorder);
         recorder->stopRecording();
 
         printf("Recorded %f seconds of audio\n", recorder->recordedLengthInSeconds());
-
-        context->removeAutomaticPullNode(recorder);
-        recorder->writeRecordingToWav("ex_offline_rendering.wav", false);
-        complete = true;
     };
 
     // Offline rendering happens in a separate thread and blocks until complete.
     // It needs to acquire the graph + render locks, so it must
     // be outside the scope of where we make changes to the graph.
-    context->startOfflineRendering();
+    auto render = StartOfflineRender(ac, recording_time_ms, on_complete);
+    render->wait();
 
-    while (!complete)
+    if (recorder->framesDropped())
     {
-        Wait(std::chrono::milliseconds(100));
+        std::cerr << recorder->framesDropped() << " frames dropped writing ex_offline_rendering.wav" << std::endl;
+        return EXIT_FAILURE;
     }
 }
 catch (const std::exception & e) 
@@ -0,0 +1,433 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#if defined(_MSC_VER)
+    #if !defined(_CRT_SECURE_NO_WARNINGS)
+        #define _CRT_SECURE_NO_WARNINGS
+    #endif
+    #if !defined(NOMINMAX)
+        #define NOMINMAX
+    #endif
+#endif
+
+#include "MappedAudioFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+    #include <direct.h>
+    #include <process.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+using namespace lab;
+
+/////////////////////
+//    MappedFile   //
+/////////////////////
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path)
+{
+    std::shared_ptr<MappedFile> f(new MappedFile());
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return {};
+    f->_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        return {};
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (!mapping)
+        return {};
+    f->_mapping = mapping;
+
+    f->_data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (!f->_data)
+        return {};
+    f->_size = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return {};
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return {};
+    }
+
+    // private and writable, so that a bus made from the mapping may be written to
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return {};
+
+    f->_data = data;
+    f->_size = static_cast<size_t>(st.st_size);
+#endif
+
+    return f;
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(_WIN32)
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_mapping)
+        CloseHandle(_mapping);
+    if (_file)
+        CloseHandle(_file);
+#else
+    if (_data)
+        munmap(_data, _size);
+#endif
+}
+
+//////////////////////////
+//    MappedAudioFile   //
+//////////////////////////
+
+namespace
+{
+    // all of the formats are little endian, as is every platform LabSound supports
+    uint16_t get_u16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+    uint32_t get_u32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+    uint64_t get_u64(const uint8_t* p) { return get_u32(p) | (static_cast<uint64_t>(get_u32(p + 4)) << 32); }
+
+    const uint16_t wav_format_pcm = 1;
+    const uint16_t wav_format_ieee_float = 3;
+    const uint16_t wav_format_extensible = 0xfffe;
+
+    const size_t planar_header_size = 64;
+    const uint32_t planar_version = 1;
+    const uint64_t planar_alignment = 16;   // frames
+}
+
+std::shared_ptr<MappedAudioFile> MappedAudioFile::open(const std::string& path)
+{
+    std::shared_ptr<MappedFile> file = MappedFile::open(path);
+    if (!file)
+        return {};
+
+    auto audio = std::make_shared<MappedAudioFile>();
+    audio->_file = file;
+    if (audio->parsePlanar() || audio->parseWav())
+        return audio;
+    return {};
+}
+
+bool MappedAudioFile::parseWav()
+{
+    const uint8_t* p = _file->data();
+    const size_t size = _file->size();
+    if (size < 12 || memcmp(p, "RIFF", 4) != 0 || memcmp(p + 8, "WAVE", 4) != 0)
+        return false;
+
+    uint16_t format = 0;
+    uint16_t bits = 0;
+    uint16_t block_align = 0;
+    bool have_fmt = false;
+
+    for (size_t offset = 12; offset + 8 <= size;)
+    {
+        const uint8_t* chunk = p + offset;
+        const uint64_t chunk_size = get_u32(chunk + 4);
+        const size_t body = offset + 8;
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16 && body + 16 <= size)
+        {
+            format = get_u16(p + body);
+            _channels = get_u16(p + body + 2);
+            _sample_rate = static_cast<float>(get_u32(p + body + 4));
+            block_align = get_u16(p + body + 12);
+            bits = get_u16(p + body + 14);
+
+            // the sub format of an extensible header starts with the actual format tag
+            if (format == wav_format_extensible && chunk_size >= 40 && body + 26 <= size)
+                format = get_u16(p + body + 24);
+            have_fmt = true;
+        }
+        else if (memcmp(chunk, "data", 4) == 0 && have_fmt)
+        {
+            if (format == wav_format_pcm && bits == 16) _encoding = Encoding::Int16;
+            else if (format == wav_format_pcm && bits == 24) _encoding = Encoding::Int24;
+            else if (format == wav_format_pcm && bits == 32) _encoding = Encoding::Int32;
+            else if (format == wav_format_ieee_float && bits == 32) _encoding = Encoding::Float32;
+            else return false;
+
+            if (_channels <= 0 || block_align != _channels * (bits / 8))
+                return false;
+
+            // a truncated file plays as far as it goes
+            const uint64_t available = std::min<uint64_t>(chunk_size, size - body);
+            _frames = available / block_align;
+            _samples = p + body;
+            _planar = false;
+            return true;
+        }
+
+        // chunks are padded to an even size
+        offset = body + static_cast<size_t>(chunk_size + (chunk_size & 1));
+    }
+    return false;
+}
+
+bool MappedAudioFile::parsePlanar()
+{
+    const uint8_t* p = _file->data();
+    const size_t size = _file->size();
+    if (size < planar_header_size || memcmp(p, "LSPF", 4) != 0 || get_u32(p + 4) != planar_version)
+        return false;
+
+    _channels = static_cast<int>(get_u32(p + 8));
+    memcpy(&_sample_rate, p + 12, sizeof(float));
+    _frames = get_u64(p + 16);
+    _stride = get_u64(p + 24);
+    if (_channels <= 0 || _stride < _frames || planar_header_size + _stride * _channels * sizeof(float) > size)
+        return false;
+
+    _encoding = Encoding::Float32;
+    _samples = p + planar_header_size;
+    _planar = true;
+    return true;
+}
+
+void MappedAudioFile::read(int channel, uint64_t frame, size_t count, float* dst) const
+{
+    const size_t available = frame < _frames ? static_cast<size_t>(std::min<uint64_t>(count, _frames - frame)) : 0;
+    std::fill(dst + available, dst + count, 0.f);
+
+    if (_planar)
+    {
+        memcpy(dst, planarChannel(channel) + frame, available * sizeof(float));
+        return;
+    }
+
+    switch (_encoding)
+    {
+    case Encoding::Int16:
+    {
+        const uint8_t* src = _samples + (frame * _channels + channel) * 2;
+        for (size_t i = 0; i < available; ++i, src += _channels * 2)
+            dst[i] = static_cast<int16_t>(get_u16(src)) * (1.f / 32768.f);
+        break;
+    }
+    case Encoding::Int24:
+    {
+        const uint8_t* src = _samples + (frame * _channels + channel) * 3;
+        for (size_t i = 0; i < available; ++i, src += _channels * 3)
+        {
+            // shift into the top of an int32 to sign extend
+            const int32_t v = static_cast<int32_t>((src[0] << 8) | (src[1] << 16) | (static_cast<uint32_t>(src[2]) << 24));
+            dst[i] = (v >> 8) * (1.f / 8388608.f);
+        }
+        break;
+    }
+    case Encoding::Int32:
+    {
+        const uint8_t* src = _samples + (frame * _channels + channel) * 4;
+        for (size_t i = 0; i < available; ++i, src += _channels * 4)
+            dst[i] = static_cast<float>(static_cast<int32_t>(get_u32(src)) * (1.0 / 2147483648.0));
+        break;
+    }
+    case Encoding::Float32:
+    {
+        const uint8_t* src = _samples + (frame * _channels + channel) * 4;
+        for (size_t i = 0; i < available; ++i, src += _channels * 4)
+            memcpy(dst + i, src, sizeof(float));
+        break;
+    }
+    }
+}
+
+const float* MappedAudioFile::planarChannel(int channel) const
+{
+    if (!_planar || channel < 0 || channel >= _channels)
+        return nullptr;
+    return reinterpret_cast<const float*>(_samples) + _stride * channel;
+}
+
+std::shared_ptr<AudioBus> MappedAudioFile::makeBus() const
+{
+    const int length = static_cast<int>(_frames);
+
+    if (_planar)
+    {
+        // the bus refers to the mapped pages, and owns a reference to the mapping. The
+        // mapping is copy on write, so the bus may be written to without touching the file.
+        std::shared_ptr<MappedFile> file = _file;
+        std::shared_ptr<AudioBus> bus(new AudioBus(_channels, length, false), [file](AudioBus* b) { delete b; });
+        for (int c = 0; c < _channels; ++c)
+            bus->setChannelMemory(c, const_cast<float*>(planarChannel(c)), length);
+        bus->setSampleRate(_sample_rate);
+        return bus;
+    }
+
+    auto bus = std::make_shared<AudioBus>(_channels, length);
+    for (int c = 0; c < _channels; ++c)
+        read(c, 0, static_cast<size_t>(length), bus->channel(c)->mutableData());
+    bus->setSampleRate(_sample_rate);
+    return bus;
+}
+
+bool IsFileUpToDate(const std::string& path, const std::string& source)
+{
+    struct stat sp, ss;
+    if (stat(path.c_str(), &sp) != 0)
+        return false;
+    return stat(source.c_str(), &ss) != 0 || sp.st_mtime >= ss.st_mtime;
+}
+
+namespace
+{
+    bool MakeDirectory(const std::string& path)
+    {
+#if defined(_WIN32)
+        const int result = _mkdir(path.c_str());
+#else
+        const int result = mkdir(path.c_str(), 0755);
+#endif
+        struct stat st;
+        return result == 0 || (stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFDIR));
+    }
+}
+
+std::string UserCacheDirectory()
+{
+    std::string base;
+#if defined(_WIN32)
+    if (const char* local = getenv("LOCALAPPDATA"))
+        base = local;
+#else
+    if (const char* xdg = getenv("XDG_CACHE_HOME"))
+        base = xdg;
+    if (base.empty())
+    {
+        const char* home = getenv("HOME");
+        if (!home || !*home)
+            return {};
+        base = std::string(home) + "/.cache";
+        if (!MakeDirectory(base))
+            return {};
+    }
+#endif
+    if (base.empty())
+        return {};
+
+    const std::string directory = base + "/LabSoundDemo";
+    return MakeDirectory(directory) ? directory : std::string();
+}
+
+std::string UniqueTempPath(const std::string& path)
+{
+#if defined(_WIN32)
+    const unsigned long pid = static_cast<unsigned long>(_getpid());
+#else
+    const unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+    const size_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".%lu.%zx.tmp", pid, thread);
+    return path + suffix;
+}
+
+bool ReplaceFile(const std::string& temp, const std::string& path)
+{
+#if defined(_WIN32)
+    // rename doesn't replace an existing file on Windows
+    return MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(temp.c_str(), path.c_str()) == 0;
+#endif
+}
+
+std::string CachedFileName(const std::string& source, const std::string& suffix)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : source)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+
+    const size_t slash = source.find_last_of("/\\");
+    const std::string name = slash == std::string::npos ? source : source.substr(slash + 1);
+
+    char digest[24];
+    snprintf(digest, sizeof(digest), ".%016llx", static_cast<unsigned long long>(hash));
+    return name + digest + suffix;
+}
+
+std::string SidecarPath(const std::string& path, float sampleRate)
+{
+    const std::string suffix = "." + std::to_string(static_cast<int>(sampleRate)) + ".lspf";
+    const std::string cache = UserCacheDirectory();
+    return cache.empty() ? path + suffix : cache + "/" + CachedFileName(path, suffix);
+}
+
+bool WritePlanarFloatFile(const std::string& path, AudioBus const& bus, float sampleRate)
+{
+    const std::string temp = UniqueTempPath(path);
+    FILE* f = fopen(temp.c_str(), "wb");
+    if (!f)
+        return false;
+
+    const uint32_t channels = static_cast<uint32_t>(bus.numberOfChannels());
+    const uint64_t frames = static_cast<uint64_t>(bus.length());
+    const uint64_t stride = (frames + planar_alignment - 1) / planar_alignment * planar_alignment;
+
+    uint8_t header[planar_header_size] = {};
+    memcpy(header, "LSPF", 4);
+    memcpy(header + 4, &planar_version, 4);
+    memcpy(header + 8, &channels, 4);
+    memcpy(header + 12, &sampleRate, 4);
+    memcpy(header + 16, &frames, 8);
+    memcpy(header + 24, &stride, 8);
+
+    bool ok = fwrite(header, 1, planar_header_size, f) == planar_header_size;
+    const std::vector<float> padding(static_cast<size_t>(stride - frames), 0.f);
+    for (uint32_t c = 0; ok && c < channels; ++c)
+    {
+        ok = fwrite(bus.channel(c)->data(), sizeof(float), frames, f) == frames
+          && fwrite(padding.data(), sizeof(float), padding.size(), f) == padding.size();
+    }
+
+    ok = fclose(f) == 0 && ok && ReplaceFile(temp, path);
+    if (!ok)
+        remove(temp.c_str());
+    return ok;
+}
+
+std::shared_ptr<AudioBus> MakeBusFromMappedFile(const std::string& path, float sampleRate)
+{
+    std::shared_ptr<MappedAudioFile> file = MappedAudioFile::open(path);
+    if (!file)
+        return {};
+
+    std::shared_ptr<AudioBus> bus = file->makeBus();
+    if (sampleRate > 0 && file->sampleRate() != sampleRate)
+    {
+        std::unique_ptr<AudioBus> converted = AudioBus::createBySampleRateConverting(bus.get(), false, sampleRate);
+        return std::shared_ptr<AudioBus>(converted.release());
+    }
+    return bus;
+}
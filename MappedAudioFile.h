@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_MAPPEDAUDIOFILE_H
+#define LABSOUNDDEMO_MAPPEDAUDIOFILE_H
+
+#include "LabSound/LabSound.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// MappedFile maps a whole file into memory, copy on write, so pages are read from disk
+// only when they are touched, and are shared with the page cache until they are written.
+class MappedFile
+{
+    void* _data = nullptr;
+    size_t _size = 0;
+#if defined(_WIN32)
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#endif
+
+    MappedFile() = default;
+
+public:
+    ~MappedFile();
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    // returns nullptr if the file can't be mapped
+    static std::shared_ptr<MappedFile> open(const std::string& path);
+
+    uint8_t* data() const { return static_cast<uint8_t*>(_data); }
+    size_t size() const { return _size; }
+};
+
+// MappedAudioFile reads uncompressed audio directly from a mapped file, without going
+// through the decoder. Two formats are understood:
+//
+// - wav files holding 16, 24 or 32 bit integer, or 32 bit float, samples. These are
+//   interleaved, so samples are converted to float as they are read. read() converts only
+//   the frames asked for, which is how StreamingFileNode plays them, but makeBus() has to
+//   convert the whole file, since a bus holds floats.
+// - planar float files, with the extension .lspf, a 64 byte header followed by each
+//   channel's samples as native 32 bit float. These are used in place: an AudioBus made
+//   from one points into the mapped pages, with nothing copied or converted.
+//
+//   offset  size
+//   0       4     "LSPF"
+//   4       4     version, 1
+//   8       4     channel count
+//   12      4     sample rate, float
+//   16      8     frames per channel
+//   24      8     channel stride in frames, a multiple of 16 so channels are 64 byte aligned
+//   32      32    reserved, zero
+class MappedAudioFile
+{
+public:
+    enum class Encoding { Int16, Int24, Int32, Float32 };
+
+private:
+    std::shared_ptr<MappedFile> _file;
+    Encoding _encoding = Encoding::Float32;
+    int _channels = 0;
+    float _sample_rate = 0;
+    uint64_t _frames = 0;
+    bool _planar = false;
+    uint64_t _stride = 0;           // planar: floats between channels
+    const uint8_t* _samples = nullptr;
+
+    bool parseWav();
+    bool parsePlanar();
+
+public:
+    // returns nullptr if the file doesn't exist, or isn't in a format that can be mapped
+    static std::shared_ptr<MappedAudioFile> open(const std::string& path);
+
+    int channels() const { return _channels; }
+    float sampleRate() const { return _sample_rate; }
+    uint64_t frames() const { return _frames; }
+    bool planar() const { return _planar; }
+
+    // converts count frames of one channel, starting at frame, to float. Frames past the
+    // end of the file read as silence.
+    void read(int channel, uint64_t frame, size_t count, float* dst) const;
+
+    // the samples of a channel of a planar float file, or nullptr for a wav file
+    const float* planarChannel(int channel) const;
+
+    // An AudioBus holding the whole file. For a planar float file the bus refers to the
+    // mapped pages, and keeps the mapping alive for as long as the bus exists. For a wav
+    // file every sample is converted into a bus of its own, up front.
+    std::shared_ptr<lab::AudioBus> makeBus() const;
+};
+
+// true if path exists, and was modified no earlier than source, or source doesn't exist
+bool IsFileUpToDate(const std::string& path, const std::string& source);
+
+// A directory for files derived from the assets, which are read only once installed:
+// $XDG_CACHE_HOME/LabSoundDemo, or ~/.cache/LabSoundDemo, or %LOCALAPPDATA%\LabSoundDemo on
+// Windows, created if need be. Returns an empty string if there is none.
+std::string UserCacheDirectory();
+
+// A temporary file beside path, named for this process and thread, so that writers of the
+// same file in other threads or processes don't write into each other's temporary file.
+std::string UniqueTempPath(const std::string& path);
+
+// Renames temp over path, replacing it. Returns false on failure, leaving temp in place.
+bool ReplaceFile(const std::string& temp, const std::string& path);
+
+// The name, in the user's cache directory, of a file derived from source: source's file
+// name, a hash of its whole path, which tells apart sources of the same name in different
+// directories, and suffix.
+std::string CachedFileName(const std::string& source, const std::string& suffix);
+
+// Where the planar float sidecar of path decoded at sampleRate is kept, in the user's cache
+// directory, or beside path as path.<rate>.lspf if there is none.
+std::string SidecarPath(const std::string& path, float sampleRate);
+
+// Writes bus as a planar float file, through a temporary file that replaces path once it
+// is complete, so readers never see a partial file. Returns false on failure.
+bool WritePlanarFloatFile(const std::string& path, lab::AudioBus const& bus, float sampleRate);
+
+// Loads a bus from a wav or planar float file through a mapping, converting the sample rate
+// if need be. A wav file is converted to float in full, as makeBus() does. Returns nullptr if the file can't be mapped, in which case it should be loaded
+// with MakeBusFromFile instead.
+std::shared_ptr<lab::AudioBus> MakeBusFromMappedFile(const std::string& path, float sampleRate);
+
+#endif
@@ -0,0 +1,291 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "NodeProfiler.h"
+
+#include <algorithm>
+#include <deque>
+#include <unordered_set>
+
+using namespace lab;
+
+namespace
+{
+    bool contains(std::vector<AudioNode*> const& nodes, AudioNode* node)
+    {
+        return std::find(nodes.begin(), nodes.end(), node) != nodes.end();
+    }
+
+    using NodeSet = std::unordered_set<AudioNode*>;
+
+    bool IsRenderBoundary(AudioNode* node)
+    {
+        return dynamic_cast<RenderBoundary*>(node) != nullptr;
+    }
+
+    // the sources a render order records for a node that isn't its root
+    void collectRecordedSources(ContextRenderLock& r, AudioNode* node, std::vector<AudioNode*>& sources)
+    {
+        if (!IsRenderBoundary(node))
+            CollectSourceNodes(r, node, sources);
+    }
+
+    void collect(ContextRenderLock& r, AudioNode* root, std::vector<AudioNode*>& order, NodeSet& seen, size_t depth);
+
+    void visit(ContextRenderLock& r, AudioNode* node, std::vector<AudioNode*>& order, NodeSet& seen, size_t depth)
+    {
+        // seen holds the nodes being visited as well as those in order, so that a feedback
+        // loop ends the walk
+        if (!node || !seen.insert(node).second)
+            return;
+
+        if (!IsRenderBoundary(node))
+            collect(r, node, order, seen, depth);
+        order.push_back(node);
+    }
+
+    void collect(ContextRenderLock& r, AudioNode* root, std::vector<AudioNode*>& order, NodeSet& seen, size_t depth)
+    {
+        // each level of the walk has its own list, as visit() recurses. A deque, so that
+        // growing it leaves the lists of the levels above in place.
+        static thread_local std::deque<std::vector<AudioNode*>> sources;
+        while (sources.size() <= depth)
+            sources.emplace_back();
+
+        std::vector<AudioNode*>& direct = sources[depth];
+        direct.clear();
+        CollectSourceNodes(r, root, direct);
+        for (AudioNode* node : direct)
+            visit(r, node, order, seen, depth + 1);
+    }
+}
+
+void CollectSourceNodes(ContextRenderLock& r, AudioNode* root, std::vector<AudioNode*>& sources)
+{
+    auto add = [&sources](AudioNode* node) {
+        if (node && !contains(sources, node))
+            sources.push_back(node);
+    };
+
+    for (auto& p : root->params())
+    {
+        if (!p->isConnected())
+            continue;
+
+        int c = p->numberOfRenderingConnections(r);
+        for (int j = 0; j < c; ++j)
+            add(p->renderingOutput(r, j)->sourceNode());
+    }
+
+    for (int i = 0; i < root->numberOfInputs(); ++i)
+    {
+        auto input = root->input(i);
+        if (!input)
+            continue;
+
+        int c = input->numberOfRenderingConnections(r);
+        for (int j = 0; j < c; ++j)
+            add(input->renderingOutput(r, j)->sourceNode());
+    }
+}
+
+void CollectRenderOrder(ContextRenderLock& r, AudioNode* root, std::vector<AudioNode*>& order)
+{
+    static thread_local NodeSet seen;
+    seen.clear();
+    seen.insert(order.begin(), order.end());
+    seen.insert(root);
+    collect(r, root, order, seen, 0);
+}
+
+RenderOrder::RenderOrder()
+{
+    _order.reserve(256);
+    _sources.reserve(512);
+    _first.reserve(258);
+    _scratch.reserve(64);
+}
+
+bool RenderOrder::unchanged(ContextRenderLock& r, AudioNode* root)
+{
+    if (root != _root || _first.empty())
+        return false;
+
+    for (size_t i = 0; i + 1 < _first.size(); ++i)
+    {
+        _scratch.clear();
+        if (i)
+            collectRecordedSources(r, _order[i - 1], _scratch);
+        else
+            CollectSourceNodes(r, root, _scratch);
+
+        auto recorded = _sources.begin() + _first[i];
+        if (_scratch.size() != _first[i + 1] - _first[i] || !std::equal(_scratch.begin(), _scratch.end(), recorded))
+            return false;
+    }
+    return true;
+}
+
+bool RenderOrder::update(ContextRenderLock& r, AudioNode* root)
+{
+    if (unchanged(r, root))
+        return false;
+
+    _root = root;
+    _order.clear();
+    CollectRenderOrder(r, root, _order);
+
+    _sources.clear();
+    _first.clear();
+    for (size_t i = 0; i <= _order.size(); ++i)
+    {
+        _first.push_back(_sources.size());
+        _scratch.clear();
+        if (i)
+            collectRecordedSources(r, _order[i - 1], _scratch);
+        else
+            CollectSourceNodes(r, root, _scratch);
+        _sources.insert(_sources.end(), _scratch.begin(), _scratch.end());
+    }
+    _first.push_back(_sources.size());
+    return true;
+}
+
+NodeProfilerNode::NodeProfilerNode(AudioContext& ac, int channelCount)
+    : PassThroughInspectorNode(ac, *desc(), channelCount)
+{
+    _durations.reserve(256);
+    initialize();
+}
+
+AudioNodeDescriptor* NodeProfilerNode::desc()
+{
+    static AudioNodeDescriptor d {nullptr, nullptr};
+    return &d;
+}
+
+void NodeProfilerNode::pullInputs(ContextRenderLock& r, int bufferSize)
+{
+    if (_order.update(r, this))
+        _relayout = true;
+
+    // a node's inputs are already processed when it is reached, so its own pull is free
+    std::vector<AudioNode*> const& order = _order.nodes();
+    _durations.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        auto start = clock::now();
+        order[i]->processIfNecessary(r, bufferSize);
+        _durations[i] = std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+    PassThroughInspectorNode::pullInputs(r, bufferSize);
+
+    // if the ui is reading the profiles, this quantum goes unrecorded rather than wait
+    std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+
+    if (_relayout)
+    {
+        layoutRecords();
+        _relayout = false;
+    }
+
+    for (size_t i = 0; i < _records.size(); ++i)
+    {
+        Record& rec = _records[i];
+        const double d = _durations[i];
+        rec.calls++;
+        rec.last = d;
+        rec.total += d;
+        rec.max = std::max(rec.max, d);
+        rec.window[rec.next] = static_cast<float>(d);
+        rec.next = (rec.next + 1) % Window;
+    }
+}
+
+void NodeProfilerNode::layoutRecords()
+{
+    // only when the graph has changed. Nodes that are still rendered keep their records,
+    // in their new slots, and the records of nodes that are gone are dropped.
+    std::vector<AudioNode*> const& order = _order.nodes();
+    std::vector<Record> records(order.size());
+    std::unordered_map<AudioNode const*, size_t> slots;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        auto it = _slots.find(order[i]);
+        if (it != _slots.end())
+            records[i] = _records[it->second];
+        records[i].name = order[i]->name();
+        slots[order[i]] = i;
+    }
+
+    _records.swap(records);
+    _slots.swap(slots);
+}
+
+namespace
+{
+    // takes a copy, as finding the p99 reorders the window
+    template <typename Record>
+    void summarize(Record rec, NodeProfile& result)
+    {
+        result.name = rec.name;
+        result.calls = rec.calls;
+        result.last = rec.last;
+        result.mean = rec.total / rec.calls;
+        result.max = rec.max;
+
+        const size_t count = static_cast<size_t>(std::min<uint64_t>(rec.calls, rec.window.size()));
+        auto p99 = rec.window.begin() + static_cast<size_t>(0.99 * (count - 1));
+        std::nth_element(rec.window.begin(), p99, rec.window.begin() + count);
+        result.p99 = *p99;
+    }
+}
+
+bool NodeProfilerNode::profile(AudioNode const* node, NodeProfile& result) const
+{
+    Record rec;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _slots.find(node);
+        if (it == _slots.end() || !_records[it->second].calls)
+            return false;
+        rec = _records[it->second];
+    }
+
+    summarize(rec, result);
+    return true;
+}
+
+std::vector<NodeProfile> NodeProfilerNode::profiles() const
+{
+    std::vector<Record> records;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        records = _records;
+    }
+
+    std::vector<NodeProfile> result;
+    for (auto& rec : records)
+    {
+        if (!rec.calls)
+            continue;
+        NodeProfile p;
+        summarize(rec, p);
+        result.push_back(p);
+    }
+
+    std::sort(result.begin(), result.end(), [](NodeProfile const& a, NodeProfile const& b) { return a.mean > b.mean; });
+    return result;
+}
+
+void NodeProfilerNode::clear()
+{
+    // the render thread lays the records out again at its next quantum
+    std::lock_guard<std::mutex> lock(_mutex);
+    _records.clear();
+    _slots.clear();
+    _relayout = true;
+}
@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_NODEPROFILER_H
+#define LABSOUNDDEMO_NODEPROFILER_H
+
+#include "LabSound/LabSound.h"
+#include "PassThroughInspectorNode.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// A node that renders the graph upstream of it on a thread of its own, such as
+// PipelineStageNode, also derives from RenderBoundary. A render order stops at such a node:
+// it is collected, but the nodes it pulls are not, since they belong to its thread.
+class RenderBoundary
+{
+public:
+    virtual ~RenderBoundary() = default;
+};
+
+// Appends the nodes upstream of root, through inputs and through connected params, to
+// order such that every node comes after the nodes it pulls. root itself is not included,
+// and nodes already in order are skipped. The walk doesn't continue past a RenderBoundary,
+// other than root. Must be called on the render thread.
+void CollectRenderOrder(lab::ContextRenderLock& r, lab::AudioNode* root, std::vector<lab::AudioNode*>& order);
+
+// Appends the nodes root pulls directly, through its inputs and connected params, to
+// sources. A node connected more than once appears once. Must be called on the render thread.
+void CollectSourceNodes(lab::ContextRenderLock& r, lab::AudioNode* root, std::vector<lab::AudioNode*>& sources);
+
+// RenderOrder keeps the render order of the nodes upstream of a root from quantum to
+// quantum, along with the direct sources of each node. update() collects each node's
+// sources again and compares them with the recorded ones, and only collects the order
+// again if a connection has changed. An unchanged graph costs one pass over its
+// connections, and allocates nothing. Must be updated on the render thread.
+class RenderOrder
+{
+    std::vector<lab::AudioNode*> _order;
+    std::vector<lab::AudioNode*> _sources;  // of root, then of each node in _order
+    std::vector<size_t> _first;             // per node, into _sources, and one past the last
+    std::vector<lab::AudioNode*> _scratch;
+    lab::AudioNode* _root = nullptr;
+
+    bool unchanged(lab::ContextRenderLock& r, lab::AudioNode* root);
+
+public:
+    RenderOrder();
+
+    // returns true if the order was collected again, because the graph changed
+    bool update(lab::ContextRenderLock& r, lab::AudioNode* root);
+
+    // the nodes upstream of root, each after the nodes it pulls. root is not included.
+    std::vector<lab::AudioNode*> const& nodes() const { return _order; }
+
+    // the direct sources of nodes()[i], none for a RenderBoundary
+    size_t sourceCount(size_t i) const { return _first[i + 2] - _first[i + 1]; }
+    lab::AudioNode* source(size_t i, size_t k) const { return _sources[_first[i + 1] + k]; }
+};
+
+struct NodeProfile
+{
+    char const* name = "";
+    uint64_t calls = 0;
+    double last = 0;    // seconds, for the most recent quantum
+    double mean = 0;
+    double max = 0;
+    double p99 = 0;     // over the most recent window of quanta
+};
+
+// NodeProfilerNode measures how long each node upstream of it spends in process().
+//
+// Each quantum, before its inputs are pulled, it processes the upstream nodes itself in
+// dependency order, timing each one. Because a node's inputs have always been processed
+// by the time it is timed, the measurement is the node's own cost, not including the cost
+// of the nodes it pulls.
+//
+// Records are kept per slot of the render order, and are laid out again, dropping the
+// records of nodes that are gone, only when the graph changes.
+class NodeProfilerNode : public PassThroughInspectorNode
+{
+public:
+    enum : size_t { Window = 512 };
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Record
+    {
+        char const* name = "";
+        uint64_t calls = 0;
+        double last = 0;
+        double total = 0;
+        double max = 0;
+        std::array<float, Window> window {};
+        size_t next = 0;
+    };
+
+    // render thread state
+    RenderOrder _order;
+    std::vector<double> _durations;
+    std::atomic<bool> _relayout {true};     // the records don't follow the order yet
+
+    // per slot of the render order, and the slot of each node
+    mutable std::mutex _mutex;
+    std::vector<Record> _records;
+    std::unordered_map<lab::AudioNode const*, size_t> _slots;
+
+    void layoutRecords();
+
+public:
+    explicit NodeProfilerNode(lab::AudioContext& ac, int channelCount = 2);
+    virtual ~NodeProfilerNode() = default;
+
+    static const char* static_name() { return "NodeProfiler"; }
+    virtual const char* name() const override { return static_name(); }
+    static lab::AudioNodeDescriptor* desc();
+
+    virtual void pullInputs(lab::ContextRenderLock&, int bufferSize) override;
+
+    // returns false if node hasn't been rendered since the last clear, or is no longer
+    // upstream of the profiler. node is only used as a key, so it may be a node that no
+    // longer exists.
+    bool profile(lab::AudioNode const* node, NodeProfile& result) const;
+
+    // profiles of every node rendered since the last clear, most expensive mean first
+    std::vector<NodeProfile> profiles() const;
+
+    void clear();
+};
+
+#endif
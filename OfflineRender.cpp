@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "OfflineRender.h"
+
+#include <algorithm>
+
+using namespace lab;
+
+QuantumClockNode::QuantumClockNode(AudioContext& ac, int channelCount)
+    : PassThroughInspectorNode(ac, *desc(), channelCount)
+{
+    initialize();
+}
+
+AudioNodeDescriptor* QuantumClockNode::desc()
+{
+    static AudioNodeDescriptor d {nullptr, nullptr};
+    return &d;
+}
+
+void QuantumClockNode::process(ContextRenderLock& r, int bufferSize)
+{
+    if (_gated && _released)
+    {
+        passThrough(r);
+        return;
+    }
+
+    auto now = clock::now();
+    if (_have_last && _durations.size() < _durations.capacity())
+        _durations.push_back(std::chrono::duration<double>(now - _last).count());
+
+    _frames += bufferSize;
+
+    if (_gated)
+    {
+        // hold here until the control thread asks for more frames
+        std::unique_lock<std::mutex> lock(_gate_mutex);
+        _held = true;
+        _gate_cv.notify_all();
+        for (;;)
+        {
+            _gate_cv.wait(lock, [this]() { return _released || _frames < _target || _task; });
+            if (!_task)
+                break;
+
+            // the control thread is blocked in runHeld until the task has run
+            (*_task)(r);
+            _task = nullptr;
+            _gate_cv.notify_all();
+        }
+        _held = false;
+
+        // time spent held at the gate is not render time
+        now = clock::now();
+    }
+
+    _last = now;
+    _have_last = true;
+
+    // pass through, so the clock can also sit inline in a graph
+    passThrough(r);
+}
+
+bool QuantumClockNode::advanceTo(uint64_t frame)
+{
+    std::unique_lock<std::mutex> lock(_gate_mutex);
+    if (frame > _target)
+        _target = frame;
+
+    _gate_cv.notify_all();
+    _gate_cv.wait(lock, [this]() { return _released || _frames >= _target; });
+    return _frames >= _target;
+}
+
+void QuantumClockNode::release()
+{
+    std::lock_guard<std::mutex> lock(_gate_mutex);
+    _released = true;
+    _gate_cv.notify_all();
+}
+
+bool QuantumClockNode::runHeld(std::function<void(ContextRenderLock&)> const& fn)
+{
+    std::unique_lock<std::mutex> lock(_gate_mutex);
+    _gate_cv.wait(lock, [this]() { return _released || _held; });
+    if (_released)
+        return false;
+
+    _task = &fn;
+    _gate_cv.notify_all();
+    _gate_cv.wait(lock, [this]() { return _released || !_task; });
+
+    // if the render was released with the task pending, the task didn't run
+    const bool ran = !_task;
+    _task = nullptr;
+    return ran;
+}
+
+void QuantumClockNode::reset(ContextRenderLock&)
+{
+    _frames = 0;
+    _have_last = false;
+    _durations.clear();
+}
+
+bool OfflineRenderHandle::done() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _done;
+}
+
+bool OfflineRenderHandle::cancelled() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _cancelled;
+}
+
+void OfflineRenderHandle::finish(bool cancelled)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_done)
+        return;
+
+    _done = true;
+    _cancelled = cancelled;
+    _cv.notify_all();
+}
+
+void OfflineRenderHandle::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait(lock, [this]() { return _done; });
+}
+
+void OfflineRenderHandle::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_done || _completing)
+            return;
+        _cancelled = true;
+    }
+
+    // suspending the context stops the null device that drives the offline render
+    _ac->suspend();
+    finish(true);
+}
+
+float OfflineRenderHandle::progress() const
+{
+    if (done())
+        return 1.f;
+    if (!_total_frames)
+        return 0.f;
+    return std::min(1.f, static_cast<float>(static_cast<double>(framesRendered()) / _total_frames));
+}
+
+std::shared_ptr<OfflineRenderHandle> StartOfflineRender(AudioContext& ac, float render_time_ms, std::function<void()> on_complete)
+{
+    auto handle = std::make_shared<OfflineRenderHandle>();
+    handle->_ac = &ac;
+    handle->_total_frames = static_cast<uint64_t>(render_time_ms * 0.001 * ac.sampleRate());
+
+    // the clock counts rendered frames for progress reporting
+    handle->_clock = std::make_shared<QuantumClockNode>(ac);
+    ac.addAutomaticPullNode(handle->_clock);
+
+    // the callback keeps the handle alive, however long the caller holds on to it
+    ac.offlineRenderCompleteCallback = [handle, on_complete]() {
+        // decided under the lock, so that a cancel() racing the end of the render either
+        // wins outright or is ignored
+        {
+            std::lock_guard<std::mutex> lock(handle->_mutex);
+            if (handle->_cancelled)
+                return;
+            handle->_completing = true;
+        }
+
+        handle->_ac->removeAutomaticPullNode(handle->_clock);
+        if (on_complete)
+            on_complete();
+        handle->finish(false);
+    };
+
+    ac.startOfflineRendering();
+    return handle;
+}
+
+QuantumStats ComputeQuantumStats(std::vector<double> durations)
+{
+    QuantumStats stats;
+    stats.quanta = durations.size();
+    if (durations.empty())
+        return stats;
+
+    std::sort(durations.begin(), durations.end());
+    double sum = 0;
+    for (double d : durations)
+        sum += d;
+
+    auto percentile = [&durations](double p) {
+        size_t i = static_cast<size_t>(p * (durations.size() - 1) + 0.5);
+        return durations[std::min(i, durations.size() - 1)];
+    };
+
+    stats.mean = sum / durations.size();
+    stats.p50 = percentile(0.50);
+    stats.p99 = percentile(0.99);
+    stats.max = durations.back();
+    return stats;
+}
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_OFFLINERENDER_H
+#define LABSOUNDDEMO_OFFLINERENDER_H
+
+#include "LabSound/LabSound.h"
+#include "PassThroughInspectorNode.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// QuantumClockNode is a PassThroughInspectorNode that is pulled exactly once per render
+// quantum. Added as an automatic pull node to an offline context it observes the render
+// loop from inside the graph, which is the only vantage point the public API offers.
+// It records the wall time of every quantum so that offline renders can be profiled.
+//
+// A gated clock additionally holds the render thread at a target frame, so that a control
+// thread can step an offline context through rendered time with advanceTo(). While the
+// render is held it owns the render lock, so the control thread must not take a
+// ContextRenderLock between steps, and must release() the clock before the context is
+// destroyed. Work that needs the render lock can be handed to the held render thread with
+// runHeld() instead. A released gated clock stops counting, since the render thread runs on
+// until the context is destroyed, so its frames and durations cover only the rendered time
+// that was asked for.
+class QuantumClockNode : public PassThroughInspectorNode
+{
+    using clock = std::chrono::steady_clock;
+
+    std::atomic<uint64_t> _frames{0};
+    bool _gated = false;
+    std::atomic<bool> _released{false};
+    bool _held = false;     // the render thread is waiting at the gate
+    uint64_t _target = 0;
+    const std::function<void(lab::ContextRenderLock&)>* _task = nullptr;
+    std::mutex _gate_mutex;
+    std::condition_variable _gate_cv;
+
+    bool _have_last = false;
+    clock::time_point _last;
+    std::vector<double> _durations;   // seconds per quantum
+
+public:
+    explicit QuantumClockNode(lab::AudioContext& ac, int channelCount = 2);
+    virtual ~QuantumClockNode() = default;
+
+    static const char* static_name() { return "QuantumClock"; }
+    virtual const char* name() const override { return static_name(); }
+    static lab::AudioNodeDescriptor* desc();
+
+    virtual void process(lab::ContextRenderLock&, int bufferSize) override;
+    virtual void reset(lab::ContextRenderLock&) override;
+
+    // reserve room for the expected number of quanta so the render thread never allocates
+    void reserve(size_t quanta) { _durations.reserve(quanta); }
+
+    // must be set before rendering starts
+    void setGated(bool gated) { _gated = gated; }
+
+    // let the render run to the target frame, and block until it gets there. Returns
+    // false if the clock was released or the render finished before reaching the target.
+    bool advanceTo(uint64_t frame);
+
+    // stop holding the render thread; call when the render completes, or before the
+    // context is destroyed
+    void release();
+
+    // Runs fn on the render thread while it is held at the gate, under the render lock it
+    // holds there, and returns once fn has run. Blocks until the render thread reaches the
+    // gate, so rendering must have started. Returns false without running fn if the clock
+    // was released first.
+    bool runHeld(std::function<void(lab::ContextRenderLock&)> const& fn);
+
+    bool released() const { return _released; }
+
+    uint64_t framesRendered() const { return _frames; }
+
+    // only valid once rendering has finished
+    std::vector<double> const& quantumDurations() const { return _durations; }
+};
+
+// OfflineRenderHandle is an offline render in flight, returned by StartOfflineRender.
+// Waiters are woken as soon as the render completes, instead of polling a flag.
+class OfflineRenderHandle
+{
+    friend std::shared_ptr<OfflineRenderHandle> StartOfflineRender(lab::AudioContext&, float, std::function<void()>);
+
+    lab::AudioContext* _ac = nullptr;
+    std::shared_ptr<QuantumClockNode> _clock;
+    uint64_t _total_frames = 0;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _done = false;
+    bool _cancelled = false;
+    bool _completing = false;   // the completion function has been committed to
+
+    void finish(bool cancelled);
+
+public:
+    // true once the render has completed, or was cancelled
+    bool done() const;
+    bool cancelled() const;
+
+    // block until the render completes, and its completion function has returned
+    void wait();
+
+    // returns false if the render is still running after the timeout
+    template <typename Rep, typename Period>
+    bool wait_for(std::chrono::duration<Rep, Period> const& timeout)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _cv.wait_for(lock, timeout, [this]() { return _done; });
+    }
+
+    // stop rendering, unless the render has already completed or its completion function
+    // has started, in which case the render finishes normally. Either the completion
+    // function runs or the render is cancelled, never both.
+    void cancel();
+
+    uint64_t framesRendered() const { return _clock->framesRendered(); }
+    uint64_t framesTotal() const { return _total_frames; }
+
+    // 0 to 1
+    float progress() const;
+};
+
+// Start rendering an offline context made with MakeOfflineAudioContext for render_time_ms.
+// The context's offlineRenderCompleteCallback is taken over by the handle; on_complete is
+// called on the render thread instead, before any waiters are woken. The context must
+// outlive the render.
+std::shared_ptr<OfflineRenderHandle> StartOfflineRender(lab::AudioContext& ac, float render_time_ms,
+                                                        std::function<void()> on_complete = {});
+
+struct QuantumStats
+{
+    size_t quanta = 0;
+    double mean = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+// summarize per quantum durations, in seconds
+QuantumStats ComputeQuantumStats(std::vector<double> durations);
+
+#endif
@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "ParallelRenderNode.h"
+#include "FastMath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+using namespace lab;
+
+namespace
+{
+    // how long a worker keeps polling for the next quantum before it sleeps. Longer than a
+    // quantum, so that workers stay awake while a context is rendering.
+    const std::chrono::milliseconds SpinTime(5);
+
+    struct SpinLock
+    {
+        std::atomic_flag& flag;
+        explicit SpinLock(std::atomic_flag& f) : flag(f)
+        {
+            while (flag.test_and_set(std::memory_order_acquire)) {}
+        }
+        ~SpinLock() { flag.clear(std::memory_order_release); }
+    };
+}
+
+ParallelRenderNode::ParallelRenderNode(AudioContext& ac, unsigned int threads, int channelCount)
+    : PassThroughInspectorNode(ac, *desc(), channelCount)
+{
+    if (!threads)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    _edges.reserve(512);
+    _queues.reset(new WorkQueue[threads]);
+
+    for (unsigned int i = 1; i < threads; ++i)
+        _workers.emplace_back(&ParallelRenderNode::workerLoop, this, static_cast<size_t>(i));
+
+    initialize();
+}
+
+ParallelRenderNode::~ParallelRenderNode()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto& t : _workers)
+        t.join();
+}
+
+AudioNodeDescriptor* ParallelRenderNode::desc()
+{
+    static AudioNodeDescriptor d {nullptr, nullptr};
+    return &d;
+}
+
+void ParallelRenderNode::buildTasks()
+{
+    std::vector<AudioNode*> const& order = _order.nodes();
+    const size_t n = order.size();
+    if (n > _task_capacity)
+    {
+        // the graph has grown; leave room for it to grow further
+        _task_capacity = std::max<size_t>(n * 2, 64);
+        _tasks.reset(new Task[_task_capacity]);
+        for (size_t q = 0; q < threads(); ++q)
+            _queues[q].items.resize(_task_capacity);
+    }
+    _task_count = n;
+
+    // _order lists every node after the nodes it pulls, so a source later in the order, or
+    // the node itself, closes a feedback loop. LabSound renders a loop by pulling around it
+    // until it reaches a node already being processed, so which nodes hear the loop's output
+    // from the last quantum depends on where the pull entered it, and the loop's other
+    // sources must be processed before that. Rather than work that out, a graph with a loop
+    // is processed serially, in order, which pulls the loop as LabSound would.
+    std::unordered_map<AudioNode*, uint32_t> index;
+    for (size_t i = 0; i < n; ++i)
+        index[order[i]] = static_cast<uint32_t>(i);
+
+    _edges.clear();
+    _serial = false;
+    for (size_t i = 0; i < n; ++i)
+    {
+        int dependencies = 0;
+        for (size_t k = 0; k < _order.sourceCount(i); ++k)
+        {
+            AudioNode* source = _order.source(i, k);
+            auto j = index.find(source);
+            if (j == index.end())
+            {
+                _serial = _serial || source == this;
+                continue;
+            }
+
+            if (j->second >= i)
+                _serial = true;
+            else
+            {
+                _edges.emplace_back(j->second, static_cast<uint32_t>(i));
+                ++dependencies;
+            }
+        }
+
+        Task& task = _tasks[i];
+        task.node = order[i];
+        task.dependencies = dependencies;
+        task.dependent_count = 0;
+    }
+
+    // lay out each task's dependents contiguously
+    for (auto& e : _edges)
+        _tasks[e.first].dependent_count++;
+
+    uint32_t offset = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        _tasks[i].first_dependent = offset;
+        offset += _tasks[i].dependent_count;
+        _tasks[i].dependent_count = 0;
+    }
+
+    _dependents.resize(_edges.size());
+    for (auto& e : _edges)
+    {
+        Task& task = _tasks[e.first];
+        _dependents[task.first_dependent + task.dependent_count++] = e.second;
+    }
+}
+
+void ParallelRenderNode::pullInputs(ContextRenderLock& r, int bufferSize)
+{
+    // an unchanged graph keeps its tasks, so nothing is allocated or searched
+    if (_order.update(r, this))
+        buildTasks();
+
+    if (_workers.empty() || _task_count < MinimumParallelNodes || _serial)
+    {
+        for (size_t i = 0; i < _task_count; ++i)
+            _tasks[i].node->processIfNecessary(r, bufferSize);
+    }
+    else
+        renderParallel(r, bufferSize);
+
+    // everything upstream has been processed, so this only gathers the results
+    PassThroughInspectorNode::pullInputs(r, bufferSize);
+}
+
+void ParallelRenderNode::renderParallel(ContextRenderLock& r, int bufferSize)
+{
+    const size_t queues = threads();
+    for (size_t q = 0; q < queues; ++q)
+        _queues[q].head = _queues[q].tail = 0;
+
+    // deal the nodes that depend on nothing, the sources, out to every thread
+    size_t next = 0;
+    for (size_t i = 0; i < _task_count; ++i)
+    {
+        _tasks[i].remaining.store(_tasks[i].dependencies, std::memory_order_relaxed);
+        if (!_tasks[i].dependencies)
+        {
+            push(next, static_cast<uint32_t>(i));
+            next = (next + 1) % queues;
+        }
+    }
+
+    _lock = &r;
+    _buffer_size = bufferSize;
+    _completed.store(0);
+    _open.store(true);
+    {
+        // taken so that a worker can't miss the wake up as it goes to sleep
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_epoch;
+    }
+    _wake.notify_all();
+
+    work(0);
+
+    // no worker may still be looking at the tasks when they are rebuilt
+    _open.store(false);
+    while (_busy.load())
+        std::this_thread::yield();
+}
+
+void ParallelRenderNode::work(size_t self)
+{
+    while (_completed.load(std::memory_order_acquire) < _task_count)
+    {
+        // nothing is ready until another thread finishes a node. Yield, in case that
+        // thread is waiting for this core.
+        uint32_t t;
+        if (!pop(self, t) && !steal(self, t))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        Task& task = _tasks[t];
+        task.node->processIfNecessary(*_lock, _buffer_size);
+
+        // the thread that completes a node's last dependency runs it next, while its
+        // inputs are still in cache
+        for (uint32_t i = 0; i < task.dependent_count; ++i)
+        {
+            const uint32_t d = _dependents[task.first_dependent + i];
+            if (_tasks[d].remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                push(self, d);
+        }
+
+        _completed.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void ParallelRenderNode::workerLoop(size_t self)
+{
+    DisableDenormals();
+
+    uint64_t seen = _epoch.load();
+    auto last_work = std::chrono::steady_clock::now();
+
+    while (!_stop)
+    {
+        const uint64_t epoch = _epoch.load();
+        if (epoch == seen)
+        {
+            if (std::chrono::steady_clock::now() - last_work < SpinTime)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&]() { return _stop || _epoch.load() != seen; });
+            continue;
+        }
+
+        seen = epoch;
+        ++_busy;
+        if (_open.load())
+            work(self);
+        --_busy;
+        last_work = std::chrono::steady_clock::now();
+    }
+}
+
+void ParallelRenderNode::push(size_t queue, uint32_t task)
+{
+    WorkQueue& q = _queues[queue];
+    SpinLock lock(q.lock);
+    q.items[q.tail++] = task;
+}
+
+bool ParallelRenderNode::pop(size_t queue, uint32_t& task)
+{
+    WorkQueue& q = _queues[queue];
+    SpinLock lock(q.lock);
+    if (q.tail == q.head)
+        return false;
+    task = q.items[--q.tail];
+    return true;
+}
+
+bool ParallelRenderNode::steal(size_t queue, uint32_t& task)
+{
+    const size_t queues = threads();
+    for (size_t i = 1; i < queues; ++i)
+    {
+        WorkQueue& q = _queues[(queue + i) % queues];
+        SpinLock lock(q.lock);
+        if (q.tail != q.head)
+        {
+            task = q.items[q.head++];
+            return true;
+        }
+    }
+    return false;
+}
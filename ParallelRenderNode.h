@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_PARALLELRENDERNODE_H
+#define LABSOUNDDEMO_PARALLELRENDERNODE_H
+
+#include "LabSound/LabSound.h"
+#include "PassThroughInspectorNode.h"
+#include "NodeProfiler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ParallelRenderNode renders the graph upstream of it on several threads.
+//
+// LabSound pulls a graph depth first on the render thread, so a graph with several
+// independent branches, such as parallel delay lines or filter banks, only ever uses one
+// core. Each quantum, before its inputs are pulled, this node checks the upstream nodes and
+// the connections between them, which it lays out as tasks again only when they have
+// changed, and processes the nodes itself on a pool of worker threads
+// and the render thread: a node is processed as soon as every node it pulls has been, by
+// whichever thread finished its last dependency, and idle threads steal ready nodes from
+// busy ones. By the time the node's own inputs are pulled, the graph has been rendered,
+// and the pull just collects the results.
+//
+// Like NodeProfilerNode, this relies on processIfNecessary() of a node whose sources have
+// already been processed doing no further pulling, and additionally on nodes being safe
+// to process on another thread while unrelated nodes are processed. The nodes in LabSound
+// only share the context, which they read; nodes that share other state with each other
+// should not be rendered in parallel.
+//
+// Worker threads spin briefly between quanta, then sleep until the next one. They flush
+// denormals to zero, as the render thread does. Graphs with fewer nodes than
+// MinimumParallelNodes, and graphs with a feedback loop, are processed on the render
+// thread as usual.
+class ParallelRenderNode : public PassThroughInspectorNode
+{
+public:
+    enum : size_t { MinimumParallelNodes = 4 };
+
+private:
+    // the work of each quantum. Rebuilt by the render thread while the workers are idle,
+    // when the graph changes.
+    struct Task
+    {
+        lab::AudioNode* node = nullptr;
+        uint32_t first_dependent = 0;       // into _dependents
+        uint32_t dependent_count = 0;
+        int dependencies = 0;
+        std::atomic<int> remaining {0};
+    };
+
+    // ready tasks. The owner pushes and pops at the back, thieves take from the front.
+    struct WorkQueue
+    {
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        std::vector<uint32_t> items;
+        size_t head = 0;
+        size_t tail = 0;
+    };
+
+    RenderOrder _order;
+    std::vector<std::pair<uint32_t, uint32_t>> _edges;     // source, dependent
+    std::unique_ptr<Task[]> _tasks;
+    size_t _task_capacity = 0;
+    size_t _task_count = 0;
+    std::vector<uint32_t> _dependents;
+    bool _serial = false;                   // the graph has a feedback loop
+    std::unique_ptr<WorkQueue[]> _queues;   // one per thread, the render thread's first
+
+    // the quantum being rendered
+    lab::ContextRenderLock* _lock = nullptr;
+    int _buffer_size = 0;
+    std::atomic<size_t> _completed {0};
+    std::atomic<bool> _open {false};        // the tasks may be worked on
+
+    // worker handshake
+    std::vector<std::thread> _workers;
+    std::atomic<uint64_t> _epoch {0};
+    std::atomic<int> _busy {0};
+    std::atomic<bool> _stop {false};
+    std::mutex _mutex;
+    std::condition_variable _wake;
+
+    void buildTasks();
+    void renderParallel(lab::ContextRenderLock& r, int bufferSize);
+    void work(size_t self);
+    void workerLoop(size_t self);
+
+    void push(size_t queue, uint32_t task);
+    bool pop(size_t queue, uint32_t& task);
+    bool steal(size_t queue, uint32_t& task);
+
+public:
+    // threads is the total number of threads rendering, including the render thread. 0
+    // uses one per core.
+    explicit ParallelRenderNode(lab::AudioContext& ac, unsigned int threads = 0, int channelCount = 2);
+    virtual ~ParallelRenderNode();
+
+    static const char* static_name() { return "ParallelRender"; }
+    virtual const char* name() const override { return static_name(); }
+    static lab::AudioNodeDescriptor* desc();
+
+    virtual void pullInputs(lab::ContextRenderLock&, int bufferSize) override;
+
+    unsigned int threads() const { return static_cast<unsigned int>(_workers.size() + 1); }
+};
+
+#endif
@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "ParamQueueNode.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace lab;
+
+// Driver plays a registered param's signal, as an offset from the param's own value, so
+// that the param sums the two into the queued value. Its signal is written by the
+// ParamQueueNode before the param's node pulls it, in the same quantum.
+class ParamQueueNode::Driver : public AudioNode
+{
+    virtual bool propagatesSilence(ContextRenderLock&) const override { return false; }
+
+public:
+    const float base;       // the param's own value
+    float value = 0;        // the offset from base, from the last change applied
+    float signal[AudioNode::ProcessingSizeInFrames];
+    int filled = 0;         // frames of signal written this quantum, before value took over
+
+    Driver(AudioContext& ac, float base)
+        : AudioNode(ac, *desc())
+        , base(base)
+    {
+        addOutput(std::unique_ptr<AudioNodeOutput>(new AudioNodeOutput(this, 1)));
+        initialize();
+    }
+
+    static AudioNodeDescriptor* desc()
+    {
+        static AudioNodeDescriptor d {nullptr, nullptr};
+        return &d;
+    }
+
+    virtual const char* name() const override { return "ParamQueueDriver"; }
+
+    // writes value into the signal from where it was last filled up to offset
+    void fill(int offset)
+    {
+        if (offset > filled)
+        {
+            std::fill(signal + filled, signal + offset, value);
+            filled = offset;
+        }
+    }
+
+    virtual void process(ContextRenderLock& r, int bufferSize) override
+    {
+        AudioBus* outputBus = output(0)->bus(r);
+        if (!outputBus)
+            return;
+
+        float* out = outputBus->channel(0)->mutableData();
+        std::copy(signal, signal + filled, out);
+        std::fill(out + filled, out + bufferSize, value);
+        outputBus->clearSilentFlag();
+    }
+
+    virtual void reset(ContextRenderLock&) override { filled = 0; }
+    virtual double tailTime(ContextRenderLock&) const override { return 0; }
+    virtual double latencyTime(ContextRenderLock&) const override { return 0; }
+};
+
+ParamQueueNode::ParamQueueNode(AudioContext& ac, int channelCount, size_t capacity, double lead)
+    : PassThroughInspectorNode(ac, *desc(), channelCount)
+    , _ac(ac)
+    , _queue(capacity)
+    , _lead(lead)
+{
+    _params.reserve(MaxParams);
+    _drivers.reserve(MaxParams);
+
+    // a change waits in _pending once it has been taken from the queue, so between them
+    // they hold as many changes as the queue does, and as many can be due at once
+    _pending.reserve(_queue.capacity());
+    _due.reserve(_queue.capacity());
+
+    initialize();
+}
+
+AudioNodeDescriptor* ParamQueueNode::desc()
+{
+    static AudioNodeDescriptor d {nullptr, nullptr};
+    return &d;
+}
+
+int ParamQueueNode::addParam(std::shared_ptr<AudioParam> param)
+{
+    if (!param)
+        return -1;
+
+    std::lock_guard<std::mutex> lock(_params_mutex);
+    const int index = _param_count.load(std::memory_order_relaxed);
+    if (index >= MaxParams)
+        return -1;
+
+    // the storage was reserved, so the render thread's view of the earlier params is stable
+    auto driver = std::make_shared<Driver>(_ac, param->value());
+    _ac.connectParam(param, driver, 0);
+    _params.push_back(std::move(param));
+    _drivers.push_back(std::move(driver));
+    _param_count.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+bool ParamQueueNode::setValueAtTime(int param, float value, double when)
+{
+    if (param < 0 || param >= _param_count.load(std::memory_order_acquire))
+        return false;
+
+    Change c;
+    c.param = param;
+    c.value = value;
+    c.when = when;
+    if (_queue.tryPush(c))
+        return true;
+
+    ++_dropped;
+    return false;
+}
+
+void ParamQueueNode::pullInputs(ContextRenderLock& r, int bufferSize)
+{
+    const double sampleRate = r.context()->sampleRate();
+    const uint64_t quantumFrame = r.context()->currentSampleFrame();
+    const double endFrame = static_cast<double>(quantumFrame + bufferSize);
+    const int count = _param_count.load(std::memory_order_acquire);
+
+    for (int i = 0; i < count; ++i)
+        _drivers[i]->filled = 0;
+
+    // take what has been posted, leaving it queued if _pending is full
+    Change c;
+    while (_pending.size() < _pending.capacity() && _queue.tryPop(c))
+        _pending.push_back(c);
+
+    // take the changes due this quantum, placed on the sample nearest their time, or on the
+    // first sample if their time has passed
+    _due.clear();
+    size_t kept = 0;
+    for (size_t i = 0; i < _pending.size(); ++i)
+    {
+        const Change& p = _pending[i];
+        const double frame = std::floor(p.when * sampleRate + 0.5);
+        if (frame >= endFrame)
+        {
+            _pending[kept++] = p;
+            continue;
+        }
+
+        Due d;
+        d.param = p.param;
+        d.offset = static_cast<int32_t>(std::max(0.0, frame - static_cast<double>(quantumFrame)));
+        d.order = static_cast<uint32_t>(i);
+        d.value = p.value;
+        _due.push_back(d);
+    }
+    _pending.resize(kept);
+
+    // Step each param's signal through its changes in time, and in the order they were
+    // posted for the same sample, so that the last of them wins. The signal is written
+    // before the param's node is processed, so it is heard this quantum.
+    std::sort(_due.begin(), _due.end(), [](Due const& a, Due const& b) {
+        return a.offset != b.offset ? a.offset < b.offset : a.order < b.order;
+    });
+    for (Due const& d : _due)
+    {
+        Driver& driver = *_drivers[d.param];
+        driver.fill(d.offset);
+        driver.value = d.value - driver.base;
+    }
+
+    // the start of the next quantum, the earliest a change posted now can take effect
+    _rendered.store(endFrame / sampleRate, std::memory_order_release);
+
+    PassThroughInspectorNode::pullInputs(r, bufferSize);
+}
+
+void ParamQueueNode::reset(ContextRenderLock&)
+{
+    _pending.clear();
+}
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_PARAMQUEUENODE_H
+#define LABSOUNDDEMO_PARAMQUEUENODE_H
+
+#include "LabSound/LabSound.h"
+#include "PassThroughInspectorNode.h"
+#include "RingBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ParamQueueNode carries parameter changes from control threads to the render thread, for
+// the graph upstream of it.
+//
+// Setting an AudioParam from a control thread takes effect whenever the render thread next
+// reads it, so a change lands in whichever quantum happens to be rendered next, and
+// automating it contends with the render thread for the param's timeline. Here a change is
+// a small record, the param's index, the value, and the context time it takes effect at,
+// posted to a lock-free queue. Each quantum, before anything upstream is processed, the
+// node drains the queue and writes the changes that fall within the quantum into an audio
+// rate signal per param, stepping to each value on the sample it was stamped for. The
+// params' timelines aren't touched, so the render thread neither locks nor allocates, and
+// nothing is left behind to prune. Later changes wait in the node.
+//
+// addParam() connects the param to a small node that plays its signal, the change from the
+// value the param had when it was registered. The param's own value is left alone, so it
+// keeps sounding until the connection is made, and the param then sounds the queued value.
+// Setting the param directly afterwards offsets the queued values. Nodes that read a param
+// at audio rate, as GainNode and StereoPannerNode do, hear each change on its sample; nodes
+// that read it once per quantum, as PannerNode does its position, hear it from the quantum
+// it falls in.
+//
+// setValue() stamps a change with the context time now(), which is the time rendered so
+// far, plus a lead. The stamps depend only on rendered time, so a control thread that
+// steps an offline context through time, as LabSoundDemo --virtual does, gets the same
+// result every run. Changes sent at a steady rate are applied at the same rate, as long as
+// the lead covers the time between the render thread's callbacks, usually the device's
+// buffer.
+class ParamQueueNode : public PassThroughInspectorNode
+{
+public:
+    enum : int { MaxParams = 256 };
+
+private:
+    class Driver;
+
+    struct Change
+    {
+        int32_t param = 0;
+        float value = 0;
+        double when = 0;
+    };
+
+    // a change due this quantum, at its frame offset into the quantum
+    struct Due
+    {
+        int32_t param;
+        int32_t offset;
+        uint32_t order;
+        float value;
+    };
+
+    lab::AudioContext& _ac;
+
+    // registered params and the nodes driving them, only appended to; the render thread
+    // reads the first _param_count
+    std::vector<std::shared_ptr<lab::AudioParam>> _params;
+    std::vector<std::shared_ptr<Driver>> _drivers;
+    std::atomic<int> _param_count {0};
+    std::mutex _params_mutex;
+
+    MpscQueue<Change> _queue;
+    std::vector<Change> _pending;       // changes waiting for their time, render thread only
+    std::vector<Due> _due;              // render thread only
+    std::atomic<uint64_t> _dropped {0};
+
+    // the context time at the end of the last quantum rendered
+    std::atomic<double> _rendered {0};
+
+    double _lead;
+
+public:
+    // capacity is the number of changes that may be waiting, either to be picked up or for
+    // their time to come. lead is in seconds.
+    explicit ParamQueueNode(lab::AudioContext& ac, int channelCount = 2, size_t capacity = 1024, double lead = 0.01);
+    virtual ~ParamQueueNode() = default;
+
+    static const char* static_name() { return "ParamQueue"; }
+    virtual const char* name() const override { return static_name(); }
+    static lab::AudioNodeDescriptor* desc();
+
+    // Returns the param's index, or -1 if MaxParams are already registered. The param must
+    // belong to a node pulled through this one. Not from the render thread.
+    int addParam(std::shared_ptr<lab::AudioParam> param);
+
+    // Lock free, from any thread. The change takes effect on the sample at when, or on the
+    // first sample of the next quantum if that has passed. Returns false if the queue is
+    // full, or the param doesn't exist.
+    bool setValueAtTime(int param, float value, double when);
+    bool setValue(int param, float value) { return setValueAtTime(param, value, now() + _lead); }
+
+    // the context time rendered so far, from any thread
+    double now() const { return _rendered.load(std::memory_order_acquire); }
+
+    uint64_t droppedChanges() const { return _dropped; }
+
+    virtual void pullInputs(lab::ContextRenderLock&, int bufferSize) override;
+    virtual void reset(lab::ContextRenderLock&) override;
+};
+
+#endif
@@ -0,0 +1,565 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "PartitionedConvolver.h"
+#include "FastMath.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace lab;
+
+namespace
+{
+    // Posting a block doesn't take the pool's mutex, so a wake up can slip in just before
+    // a thread sleeps and be missed. Sleeping threads look for work this often regardless.
+    const std::chrono::milliseconds WakeInterval(1);
+
+    // acc += x * h, over bins complex values, each stored as bins real parts followed by
+    // bins imaginary parts
+    void MultiplyAccumulate(const float* x, const float* h, float* acc, int bins)
+    {
+        const float* xi = x + bins;
+        const float* hi = h + bins;
+        float* ai = acc + bins;
+        for (int k = 0; k < bins; ++k)
+        {
+            acc[k] += x[k] * h[k] - xi[k] * hi[k];
+            ai[k] += x[k] * hi[k] + xi[k] * h[k];
+        }
+    }
+
+    size_t RingSize(size_t atLeast)
+    {
+        size_t size = 1;
+        while (size < atLeast)
+            size <<= 1;
+        return size;
+    }
+}
+
+/////////////////////////////
+//    ConvolutionImpulse   //
+/////////////////////////////
+
+std::vector<ConvolutionImpulse::Stage> ConvolutionImpulse::layout(int length, size_t& channelStride)
+{
+    // the head, then stages of Growth times the block size, each starting at twice its block
+    std::vector<Stage> stages;
+    Stage head;
+    head.block = HeadBlock;
+    head.partitions = std::max(1, (std::min(length, 2 * FirstTailBlock) + HeadBlock - 1) / HeadBlock);
+    stages.push_back(head);
+
+    int block = FirstTailBlock;
+    int offset = 2 * FirstTailBlock;
+    while (offset < length)
+    {
+        const int next = std::min(block * Growth, static_cast<int>(MaxBlock));
+        const int end = next > block ? std::min(length, 2 * next) : length;
+
+        Stage stage;
+        stage.block = block;
+        stage.offset = offset;
+        stage.partitions = (end - offset + block - 1) / block;
+        stages.push_back(stage);
+
+        offset = end;
+        block = next;
+    }
+
+    channelStride = 0;
+    for (Stage& s : stages)
+    {
+        s.spectra = channelStride;
+        channelStride += static_cast<size_t>(s.partitions) * 2 * (s.block + 1);
+    }
+    return stages;
+}
+
+size_t ConvolutionImpulse::channelStride(int length)
+{
+    size_t stride = 0;
+    layout(length, stride);
+    return stride;
+}
+
+std::shared_ptr<const ConvolutionImpulse> ConvolutionImpulse::adopt(int channels, int length, const float* spectra, std::shared_ptr<const void> owner)
+{
+    auto impulse = std::make_shared<ConvolutionImpulse>();
+    impulse->_channels = channels;
+    impulse->_length = length;
+    impulse->_stages = layout(length, impulse->_channel_stride);
+    impulse->_data = spectra;
+    impulse->_owner = std::move(owner);
+    return impulse;
+}
+
+std::shared_ptr<const ConvolutionImpulse> ConvolutionImpulse::prepare(const AudioBus& ir, float sampleRate, bool normalize)
+{
+    auto impulse = std::make_shared<ConvolutionImpulse>();
+    impulse->_channels = ir.numberOfChannels() == 4 ? 4 : std::max(1, std::min(2, ir.numberOfChannels()));
+    impulse->_length = ir.length();
+    const int length = impulse->_length;
+
+    float scale = 1.f;
+    if (normalize && length)
+    {
+        // as WebKit's Reverb::calculateNormalizationScale
+        const float GainCalibration = -58.f;
+        const float GainCalibrationSampleRate = 44100.f;
+        const float MinPower = 0.000125f;
+
+        double power = 0;
+        for (int c = 0; c < ir.numberOfChannels(); ++c)
+        {
+            const float* src = ir.channel(c)->data();
+            for (int i = 0; i < length; ++i)
+                power += static_cast<double>(src[i]) * src[i];
+        }
+        float rms = static_cast<float>(std::sqrt(power / (static_cast<double>(ir.numberOfChannels()) * length)));
+        if (!std::isfinite(rms) || rms < MinPower)
+            rms = MinPower;
+
+        scale = 1.f / rms;
+        scale *= std::pow(10.f, GainCalibration * 0.05f);
+        if (sampleRate > 0)
+            scale *= GainCalibrationSampleRate / sampleRate;
+        if (ir.numberOfChannels() == 4)
+            scale *= 0.5f;
+    }
+
+    size_t stride = 0;
+    impulse->_stages = layout(length, stride);
+    impulse->_channel_stride = stride;
+    impulse->_spectra.resize(stride * impulse->_channels);
+    impulse->_data = impulse->_spectra.data();
+
+    std::vector<float> padded;
+    for (int s = 0; s < static_cast<int>(impulse->_stages.size()); ++s)
+    {
+        const Stage& stage = impulse->_stages[s];
+        RealFft fft(2 * stage.block);
+        padded.assign(2 * stage.block, 0.f);
+
+        for (int c = 0; c < impulse->_channels; ++c)
+        {
+            const float* src = ir.channel(c)->data();
+            for (int p = 0; p < stage.partitions; ++p)
+            {
+                const int begin = stage.offset + p * stage.block;
+                const int count = std::max(0, std::min(stage.block, length - begin));
+                for (int i = 0; i < count; ++i)
+                    padded[i] = src[begin + i] * scale;
+                std::fill(padded.begin() + count, padded.begin() + stage.block, 0.f);
+
+                float* dst = impulse->_spectra.data() + c * stride + stage.spectra + static_cast<size_t>(p) * 2 * (stage.block + 1);
+                fft.forward(padded.data(), dst, dst + stage.block + 1);
+            }
+        }
+    }
+
+    return impulse;
+}
+
+///////////////////////////////
+//    PartitionedConvolver   //
+///////////////////////////////
+
+// a stage of the tail, convolved by the pool, a block at a time
+class PartitionedConvolver::TailStage
+{
+public:
+    enum : int { Idle, Posted, Running, Done };
+
+    const ConvolutionImpulse& impulse;
+    Pool& pool;
+    const int index;
+    const int block;
+    const int offset;
+    const int partitions;
+    const int channels;
+    const int outputs;
+
+    // the job, written by the convolver while the stage is idle
+    std::vector<std::vector<float>> window;     // per input, the last 2 * block frames
+    int inputs = 1;
+    uint64_t end_frame = 0;                     // of the job's input
+
+    // whoever moves the state from Posted to Running owns the rest until it stores Done
+    std::atomic<int> state {Idle};
+    RealFft fft;
+    std::vector<std::vector<float>> spectra;    // per input, a ring of transformed blocks
+    int cursor = 0;
+    std::vector<float> accumulator;
+    std::vector<float> time;
+    std::vector<std::vector<float>> result;     // per output, the block's output
+
+    TailStage(const ConvolutionImpulse& impulse, Pool& pool, int index);
+    ~TailStage();
+
+    bool busy() const { return state.load(std::memory_order_relaxed) != Idle; }
+
+    void post();
+
+    // the block's result is ready once this returns
+    void wait()
+    {
+        // convolve the block here if no thread has taken it
+        int expected = Posted;
+        if (state.compare_exchange_strong(expected, Running, std::memory_order_acquire))
+        {
+            convolve();
+            state.store(Done, std::memory_order_release);
+        }
+
+        while (state.load(std::memory_order_acquire) != Done)
+            std::this_thread::yield();
+        state.store(Idle, std::memory_order_relaxed);
+    }
+
+    void convolve()
+    {
+        const int bins = block + 1;
+        for (int i = 0; i < inputs; ++i)
+        {
+            float* x = spectra[i].data() + static_cast<size_t>(cursor) * 2 * bins;
+            fft.forward(window[i].data(), x, x + bins);
+        }
+
+        for (int o = 0; o < outputs; ++o)
+        {
+            std::fill(accumulator.begin(), accumulator.end(), 0.f);
+            for (int c = o; c < channels; c += outputs)
+            {
+                const float* x = spectra[impulse.input(c, inputs)].data();
+                for (int p = 0; p < partitions; ++p)
+                {
+                    const int slot = (cursor - p + partitions) % partitions;
+                    MultiplyAccumulate(x + static_cast<size_t>(slot) * 2 * bins, impulse.partition(c, index, p), accumulator.data(), bins);
+                }
+            }
+
+            // the second half of the window is the part that didn't wrap around
+            fft.inverse(accumulator.data(), accumulator.data() + bins, time.data());
+            std::copy(time.begin() + block, time.end(), result[o].begin());
+        }
+
+        cursor = (cursor + 1) % partitions;
+    }
+};
+
+// the threads that convolve the tail stages of every convolver
+class PartitionedConvolver::Pool
+{
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::vector<TailStage*> _stages;
+    std::vector<std::thread> _threads;
+    bool _stop = false;
+
+    std::atomic<uint64_t> _posts {0};
+    std::atomic<int> _sleeping {0};
+
+    // called with the mutex held. Takes the posted stage of the smallest block, whose
+    // result is due soonest.
+    TailStage* claim()
+    {
+        for (;;)
+        {
+            TailStage* next = nullptr;
+            for (TailStage* s : _stages)
+                if (s->state.load(std::memory_order_relaxed) == TailStage::Posted && (!next || s->block < next->block))
+                    next = s;
+            if (!next)
+                return nullptr;
+
+            // fails if the convolver took the block itself
+            int expected = TailStage::Posted;
+            if (next->state.compare_exchange_strong(expected, TailStage::Running, std::memory_order_acquire))
+                return next;
+        }
+    }
+
+    void run()
+    {
+        DisableDenormals();
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        uint64_t seen = _posts.load();
+        while (!_stop)
+        {
+            if (TailStage* s = claim())
+            {
+                lock.unlock();
+                s->convolve();
+                s->state.store(TailStage::Done, std::memory_order_release);
+                lock.lock();
+                continue;
+            }
+
+            ++_sleeping;
+            _wake.wait_for(lock, WakeInterval, [&]() { return _stop || _posts.load() != seen; });
+            --_sleeping;
+            seen = _posts.load();
+        }
+    }
+
+public:
+    explicit Pool(unsigned int threads)
+    {
+        for (unsigned int i = 0; i < threads; ++i)
+            _threads.emplace_back(&Pool::run, this);
+    }
+
+    ~Pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (auto& t : _threads)
+            t.join();
+    }
+
+    // the pool shared by every convolver that exists
+    static std::shared_ptr<Pool> shared()
+    {
+        static std::mutex mutex;
+        static std::weak_ptr<Pool> pool;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<Pool> p = pool.lock();
+        if (!p)
+        {
+            const unsigned int cores = std::thread::hardware_concurrency();
+            p = std::make_shared<Pool>(cores > 1 ? cores - 1 : 1);
+            pool = p;
+        }
+        return p;
+    }
+
+    void add(TailStage* s)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stages.push_back(s);
+    }
+
+    // once this returns, no thread is convolving s or will take it
+    void remove(TailStage* s)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stages.erase(std::remove(_stages.begin(), _stages.end(), s), _stages.end());
+        }
+        while (s->state.load(std::memory_order_acquire) == TailStage::Running)
+            std::this_thread::yield();
+    }
+
+    // called on the render thread once a stage has been posted; wakes a thread only if
+    // one is asleep, and takes no lock to do so
+    void notify()
+    {
+        _posts.fetch_add(1);
+        if (_sleeping.load() > 0)
+            _wake.notify_one();
+    }
+};
+
+PartitionedConvolver::TailStage::TailStage(const ConvolutionImpulse& impulse, Pool& pool, int index)
+    : impulse(impulse)
+    , pool(pool)
+    , index(index)
+    , block(impulse.stages()[index].block)
+    , offset(impulse.stages()[index].offset)
+    , partitions(impulse.stages()[index].partitions)
+    , channels(impulse.channels())
+    , outputs(impulse.outputs())
+    , window(impulse.inputs(), std::vector<float>(2 * block))
+    , fft(2 * block)
+    , spectra(impulse.inputs(), std::vector<float>(static_cast<size_t>(partitions) * 2 * (block + 1)))
+    , accumulator(2 * (block + 1))
+    , time(2 * block)
+    , result(outputs, std::vector<float>(block))
+{
+    pool.add(this);
+}
+
+PartitionedConvolver::TailStage::~TailStage()
+{
+    pool.remove(this);
+}
+
+void PartitionedConvolver::TailStage::post()
+{
+    state.store(Posted, std::memory_order_release);
+    pool.notify();
+}
+
+PartitionedConvolver::PartitionedConvolver(std::shared_ptr<const ConvolutionImpulse> impulse)
+    : _impulse(std::move(impulse))
+    , _channels(_impulse->channels())
+    , _outputs(_impulse->outputs())
+    , _head_partitions(_impulse->stages()[0].partitions)
+    , _head_fft(2 * ConvolutionImpulse::HeadBlock)
+{
+    const int head = ConvolutionImpulse::HeadBlock;
+    const int headBins = head + 1;
+
+    // enough history for the largest window, and enough output ring for a tail stage's
+    // block, which is scheduled up to a block ahead
+    int largest = head;
+    for (auto& s : _impulse->stages())
+        largest = std::max(largest, s.block);
+
+    const size_t historySize = RingSize(2 * largest);
+    _history.assign(_impulse->inputs(), std::vector<float>(historySize));
+    _history_mask = historySize - 1;
+
+    const size_t pendingSize = RingSize(2 * largest + head);
+    _pending.assign(_outputs, std::vector<float>(pendingSize));
+    _pending_mask = pendingSize - 1;
+
+    _head_spectra.assign(_impulse->inputs(), std::vector<float>(static_cast<size_t>(_head_partitions) * 2 * headBins));
+    _window.resize(2 * head);
+    _accumulator.resize(2 * headBins);
+    _time.resize(2 * head);
+
+    if (_impulse->stages().size() > 1)
+        _pool = Pool::shared();
+    for (int s = 1; s < static_cast<int>(_impulse->stages().size()); ++s)
+        _tail.emplace_back(new TailStage(*_impulse, *_pool, s));
+}
+
+PartitionedConvolver::~PartitionedConvolver() = default;
+
+void PartitionedConvolver::convolveHead(int inputs, float* const* out)
+{
+    const int head = ConvolutionImpulse::HeadBlock;
+    const int bins = head + 1;
+
+    for (int i = 0; i < inputs; ++i)
+    {
+        const std::vector<float>& history = _history[i];
+        for (int j = 0; j < 2 * head; ++j)
+            _window[j] = history[(_frame + head - 2 * head + j) & _history_mask];
+
+        float* x = _head_spectra[i].data() + static_cast<size_t>(_head_cursor) * 2 * bins;
+        _head_fft.forward(_window.data(), x, x + bins);
+    }
+
+    for (int o = 0; o < _outputs; ++o)
+    {
+        std::fill(_accumulator.begin(), _accumulator.end(), 0.f);
+        for (int c = o; c < _channels; c += _outputs)
+        {
+            const float* x = _head_spectra[_impulse->input(c, inputs)].data();
+            for (int p = 0; p < _head_partitions; ++p)
+            {
+                const int slot = (_head_cursor - p + _head_partitions) % _head_partitions;
+                MultiplyAccumulate(x + static_cast<size_t>(slot) * 2 * bins, _impulse->partition(c, 0, p), _accumulator.data(), bins);
+            }
+        }
+
+        _head_fft.inverse(_accumulator.data(), _accumulator.data() + bins, _time.data());
+        std::copy(_time.begin() + head, _time.end(), out[o]);
+    }
+
+    _head_cursor = (_head_cursor + 1) % _head_partitions;
+}
+
+void PartitionedConvolver::process(const float* const* in, int inputs, float* const* out, int frames)
+{
+    if (frames != ConvolutionImpulse::HeadBlock)
+    {
+        for (int o = 0; o < _outputs; ++o)
+            std::fill(out[o], out[o] + frames, 0.f);
+        return;
+    }
+
+    inputs = inputs > 1 ? _impulse->inputs() : 1;
+    for (int i = 0; i < inputs; ++i)
+    {
+        std::vector<float>& history = _history[i];
+        for (int j = 0; j < frames; ++j)
+            history[(_frame + j) & _history_mask] = in[i][j];
+    }
+
+    convolveHead(inputs, out);
+
+    // mix in what the tail stages have scheduled for this quantum
+    for (int o = 0; o < _outputs; ++o)
+    {
+        std::vector<float>& pending = _pending[o];
+        for (int j = 0; j < frames; ++j)
+        {
+            float& p = pending[(_frame + j) & _pending_mask];
+            out[o][j] += p;
+            p = 0;
+        }
+    }
+
+    // a stage whose block of input is complete collects its last block's output, which
+    // starts at the next quantum at the earliest, and starts on the new block
+    const uint64_t end = _frame + frames;
+    for (auto& stage : _tail)
+    {
+        TailStage& s = *stage;
+        if (end % s.block)
+            continue;
+
+        if (s.busy())
+        {
+            s.wait();
+            const uint64_t start = s.end_frame - s.block + s.offset;
+            for (int o = 0; o < _outputs; ++o)
+            {
+                std::vector<float>& pending = _pending[o];
+                const float* result = s.result[o].data();
+                for (int j = 0; j < s.block; ++j)
+                    pending[(start + j) & _pending_mask] += result[j];
+            }
+        }
+
+        for (int i = 0; i < inputs; ++i)
+        {
+            const std::vector<float>& history = _history[i];
+            float* window = s.window[i].data();
+            for (int j = 0; j < 2 * s.block; ++j)
+                window[j] = history[(end - 2 * s.block + j) & _history_mask];
+        }
+        s.inputs = inputs;
+        s.end_frame = end;
+        s.post();
+    }
+
+    _frame = end;
+}
+
+void PartitionedConvolver::reset()
+{
+    for (auto& stage : _tail)
+    {
+        TailStage& s = *stage;
+        if (s.busy())
+            s.wait();
+        for (auto& x : s.spectra)
+            std::fill(x.begin(), x.end(), 0.f);
+        s.cursor = 0;
+    }
+
+    for (auto& h : _history)
+        std::fill(h.begin(), h.end(), 0.f);
+    for (auto& p : _pending)
+        std::fill(p.begin(), p.end(), 0.f);
+    for (auto& x : _head_spectra)
+        std::fill(x.begin(), x.end(), 0.f);
+    _head_cursor = 0;
+    _frame = 0;
+}
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_PARTITIONEDCONVOLVER_H
+#define LABSOUNDDEMO_PARTITIONEDCONVOLVER_H
+
+#include "LabSound/LabSound.h"
+#include "Fft.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// An impulse response cut into partitions of growing size, and transformed, ready to be
+// convolved by a PartitionedConvolver.
+//
+// The first partitions, the head, are HeadBlock long, a quantum. Then come stages of
+// partitions four times longer than the last, up to MaxBlock, and the last stage takes
+// whatever remains of the response. A stage of block size L starts 2L into the response,
+// which leaves a background thread L frames to compute each of its blocks.
+//
+// Each partition is zero padded to twice its size, and stored as the real and imaginary
+// parts of its spectrum, block + 1 bins each. The spectra are either owned by the impulse,
+// or were prepared earlier and are owned by something else, such as a mapped file.
+//
+// An impulse is immutable once prepared, so any number of convolvers may share one, and
+// with it a single copy of the spectra. Each convolver still keeps rings of the spectra of
+// its own input, as large per input as a channel of the response, so a convolver sharing a
+// stereo response costs about half what it would with a copy of its own, and one sharing a
+// true stereo response about a third.
+//
+// A response of one or two channels has a channel per input and output. A four channel
+// response is true stereo, as WebAudio's: the left input is convolved into the left and
+// right outputs with the first two channels, and the right input with the last two.
+class ConvolutionImpulse
+{
+public:
+    enum : int
+    {
+        HeadBlock = lab::AudioNode::ProcessingSizeInFrames,
+        FirstTailBlock = HeadBlock * 4,
+        MaxBlock = 16384,
+        Growth = 4,
+    };
+
+    struct Stage
+    {
+        int block = 0;          // partition length
+        int offset = 0;         // of the first partition into the response
+        int partitions = 0;
+        size_t spectra = 0;     // of the first partition, into a channel's spectra
+    };
+
+private:
+    int _channels = 0;
+    int _length = 0;
+    std::vector<Stage> _stages;
+    size_t _channel_stride = 0;
+    std::vector<float> _spectra;
+    const float* _data = nullptr;               // _spectra, or the spectra kept alive by _owner
+    std::shared_ptr<const void> _owner;
+
+    static std::vector<Stage> layout(int length, size_t& channelStride);
+
+public:
+    // Partitions and transforms all four channels of ir if it has four, or else its first
+    // two. If normalize is set, scales
+    // the response as WebAudio's ConvolverNode does, so that a reverb is about as loud as
+    // its input. sampleRate is the rate the response is played at.
+    static std::shared_ptr<const ConvolutionImpulse> prepare(const lab::AudioBus& ir, float sampleRate, bool normalize = true);
+
+    // An impulse of spectra prepared earlier, laid out as those of an impulse of the same
+    // channels and length. owner keeps spectra alive for as long as the impulse exists.
+    static std::shared_ptr<const ConvolutionImpulse> adopt(int channels, int length, const float* spectra, std::shared_ptr<const void> owner);
+
+    // the number of floats of spectra per channel of a response length frames long
+    static size_t channelStride(int length);
+
+    int channels() const { return _channels; }
+    int inputs() const { return _channels == 4 ? 2 : _channels; }
+    int outputs() const { return _channels == 4 ? 2 : _channels; }
+    int length() const { return _length; }
+
+    // the input channel c of the response convolves, when there are inputs of them, one or
+    // inputs()
+    int input(int c, int inputs) const { return inputs == 1 ? 0 : c / (_channels / outputs()); }
+
+    const std::vector<Stage>& stages() const { return _stages; }
+    size_t channelStride() const { return _channel_stride; }
+    size_t bytes() const { return _channel_stride * _channels * sizeof(float); }
+
+    // all of the spectra, channel by channel
+    const float* spectra() const { return _data; }
+
+    // the real parts of partition p of a stage's spectra, followed by the imaginary parts
+    const float* partition(int channel, int stage, int p) const
+    {
+        const Stage& s = _stages[stage];
+        return _data + channel * _channel_stride + s.spectra + static_cast<size_t>(p) * 2 * (s.block + 1);
+    }
+};
+
+// PartitionedConvolver convolves one or more channels with a ConvolutionImpulse, a quantum
+// at a time, without latency. The head of the response is convolved on the calling thread,
+// one quantum long partition per quantum. The later stages are convolved by a pool of
+// threads that every convolver in the process shares, one fewer than the cores. A thread
+// convolves a block of input with the stage's partitions while the next block arrives;
+// when that block is complete the convolver collects the result, convolving it itself if
+// no thread has taken it yet, or waiting for the thread, and schedules it for output. A
+// stage's output is due 2L frames after its input arrived, L after it is collected, so the
+// wait costs nothing if the pool keeps up. Posting a block to the pool takes no lock.
+//
+// The input is either a single channel, which is convolved with each channel of the
+// response, or the response's inputs(). Each input is transformed once per block, however
+// many channels of the response convolve it, and the products for an output are summed
+// as spectra, so each output is transformed back once per block too.
+//
+// Only one thread may call process() and reset().
+class PartitionedConvolver
+{
+    class TailStage;
+    class Pool;
+
+    std::shared_ptr<const ConvolutionImpulse> _impulse;
+    int _channels;
+    int _outputs;
+    int _head_partitions;
+
+    // input history, one ring per input channel
+    std::vector<std::vector<float>> _history;
+    size_t _history_mask;
+
+    // scheduled output of the tail stages, one ring per output channel
+    std::vector<std::vector<float>> _pending;
+    size_t _pending_mask;
+
+    // the head, convolved on the calling thread
+    RealFft _head_fft;
+    std::vector<std::vector<float>> _head_spectra;  // per input, a ring of partitions
+    int _head_cursor = 0;
+    std::vector<float> _window;
+    std::vector<float> _accumulator;
+    std::vector<float> _time;
+
+    std::shared_ptr<Pool> _pool;    // outlives the stages, which it runs
+    std::vector<std::unique_ptr<TailStage>> _tail;
+    uint64_t _frame = 0;
+
+    void convolveHead(int inputs, float* const* out);
+
+public:
+    explicit PartitionedConvolver(std::shared_ptr<const ConvolutionImpulse> impulse);
+    ~PartitionedConvolver();
+
+    const std::shared_ptr<const ConvolutionImpulse>& impulse() const { return _impulse; }
+    int inputs() const { return _impulse->inputs(); }
+    int outputs() const { return _outputs; }
+
+    // in holds inputs channels, 1 or inputs(); out receives outputs() channels. frames
+    // must be ConvolutionImpulse::HeadBlock.
+    void process(const float* const* in, int inputs, float* const* out, int frames);
+
+    // silences the convolver, once the pool has finished what it is working on
+    void reset();
+};
+
+#endif
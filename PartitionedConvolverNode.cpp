@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "PartitionedConvolverNode.h"
+
+#include <algorithm>
+
+using namespace lab;
+
+PartitionedConvolverNode::PartitionedConvolverNode(AudioContext& ac)
+    : AudioBasicInspectorNode(ac, *desc(), 2)
+    , _ac(ac)
+    , _mono(AudioNode::ProcessingSizeInFrames)
+{
+    initialize();
+}
+
+AudioNodeDescriptor* PartitionedConvolverNode::desc()
+{
+    static AudioNodeDescriptor d {nullptr, nullptr};
+    return &d;
+}
+
+void PartitionedConvolverNode::setImpulse(std::shared_ptr<AudioBus> impulse)
+{
+    std::unique_ptr<PartitionedConvolver> convolver;
+    if (impulse)
+        convolver.reset(new PartitionedConvolver(ConvolutionImpulse::prepare(*impulse, _ac.sampleRate(), _normalize)));
+    replaceConvolver(std::move(convolver), std::move(impulse));
+}
+
+void PartitionedConvolverNode::setImpulse(std::shared_ptr<const ConvolutionImpulse> impulse)
+{
+    std::unique_ptr<PartitionedConvolver> convolver;
+    if (impulse)
+        convolver.reset(new PartitionedConvolver(std::move(impulse)));
+    replaceConvolver(std::move(convolver), nullptr);
+}
+
+void PartitionedConvolverNode::replaceConvolver(std::unique_ptr<PartitionedConvolver> convolver, std::shared_ptr<AudioBus> impulse)
+{
+    {
+        ContextRenderLock r(&_ac, "PartitionedConvolverNode::setImpulse");
+        std::swap(_convolver, convolver);
+        _impulse = std::move(impulse);
+    }
+
+    // the previous convolver, whose threads are joined here rather than on the render thread
+    convolver.reset();
+}
+
+void PartitionedConvolverNode::process(ContextRenderLock& r, int bufferSize)
+{
+    AudioBus* outputBus = output(0)->bus(r);
+    AudioBus* inputBus = input(0)->bus(r);
+    if (!outputBus)
+        return;
+
+    if (!_convolver || !inputBus || !input(0)->isConnected())
+    {
+        outputBus->zero();
+        return;
+    }
+
+    // the input may be pulled in place into the output; the convolver reads all of its
+    // input before writing any output
+    const int inputChannels = inputBus->numberOfChannels();
+    const int outputs = _convolver->outputs();
+    const float* in[2] = { inputBus->channel(0)->data(), nullptr };
+    int inputs = 1;
+    if (inputChannels > 1 && _convolver->inputs() > 1)
+    {
+        in[1] = inputBus->channel(1)->data();
+        inputs = 2;
+    }
+    else if (inputChannels > 1)
+    {
+        std::fill(_mono.begin(), _mono.begin() + bufferSize, 0.f);
+        const float scale = 1.f / inputChannels;
+        for (int c = 0; c < inputChannels; ++c)
+        {
+            const float* src = inputBus->channel(c)->data();
+            for (int i = 0; i < bufferSize; ++i)
+                _mono[i] += src[i] * scale;
+        }
+        in[0] = _mono.data();
+    }
+
+    const int outputChannels = outputBus->numberOfChannels();
+    float* out[2] = { outputBus->channel(0)->mutableData(), outputChannels > 1 ? outputBus->channel(1)->mutableData() : nullptr };
+    if (outputs > 1 && !out[1])
+        out[1] = _mono.data();  // a mono output only takes the first channel
+
+    _convolver->process(in, inputs, out, bufferSize);
+
+    for (int c = outputs; c < outputChannels; ++c)
+        std::copy(out[0], out[0] + bufferSize, outputBus->channel(c)->mutableData());
+    outputBus->clearSilentFlag();
+}
+
+void PartitionedConvolverNode::reset(ContextRenderLock&)
+{
+    if (_convolver)
+        _convolver->reset();
+}
+
+double PartitionedConvolverNode::tailTime(ContextRenderLock& r) const
+{
+    return _convolver ? _convolver->impulse()->length() / static_cast<double>(r.context()->sampleRate()) : 0;
+}
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_PARTITIONEDCONVOLVERNODE_H
+#define LABSOUNDDEMO_PARTITIONEDCONVOLVERNODE_H
+
+#include "LabSound/LabSound.h"
+#include "PartitionedConvolver.h"
+
+#include <memory>
+#include <vector>
+
+// PartitionedConvolverNode is a drop in replacement for ConvolverNode for long impulse
+// responses, such as reverbs. It convolves with a PartitionedConvolver, so the render
+// thread only convolves the first few milliseconds of the response, and the rest is
+// convolved on background threads, without adding latency.
+//
+// A mono response is applied to the input mixed to mono, and copied to both outputs. A
+// stereo response is applied to a mono input once per channel, or to a stereo input
+// channel by channel. A four channel response is applied as true stereo.
+//
+// Nodes that use the same response should share one ConvolutionImpulse, prepared once or
+// loaded from an ImpulseCache, rather than each preparing its own from the same bus.
+class PartitionedConvolverNode : public lab::AudioBasicInspectorNode
+{
+    lab::AudioContext& _ac;
+    std::unique_ptr<PartitionedConvolver> _convolver;   // swapped under a ContextRenderLock
+    std::shared_ptr<lab::AudioBus> _impulse;
+    std::vector<float> _mono;
+    bool _normalize = true;
+
+    virtual bool propagatesSilence(lab::ContextRenderLock&) const override { return false; }
+    void replaceConvolver(std::unique_ptr<PartitionedConvolver> convolver, std::shared_ptr<lab::AudioBus> impulse);
+
+public:
+    explicit PartitionedConvolverNode(lab::AudioContext& ac);
+    virtual ~PartitionedConvolverNode() = default;
+
+    static const char* static_name() { return "PartitionedConvolver"; }
+    virtual const char* name() const override { return static_name(); }
+    static lab::AudioNodeDescriptor* desc();
+
+    // Partitions and transforms the response on the calling thread, then swaps it in. The
+    // transformed response is this node's alone.
+    // Must not be called while holding a ContextRenderLock.
+    void setImpulse(std::shared_ptr<lab::AudioBus> impulse);
+    std::shared_ptr<lab::AudioBus> getImpulse() const { return _impulse; }
+
+    // Swaps in a response prepared earlier, such as one loaded from an ImpulseCache, which
+    // is normalized or not as it was prepared, and may be shared with other nodes.
+    // getImpulse() then returns nullptr.
+    // Must not be called while holding a ContextRenderLock.
+    void setImpulse(std::shared_ptr<const ConvolutionImpulse> impulse);
+
+    // whether responses set from now on are normalized, as ConvolverNode's are by default
+    void setNormalize(bool normalize) { _normalize = normalize; }
+
+    virtual void process(lab::ContextRenderLock&, int bufferSize) override;
+    virtual void reset(lab::ContextRenderLock&) override;
+    virtual double tailTime(lab::ContextRenderLock& r) const override;
+    virtual double latencyTime(lab::ContextRenderLock&) const override { return 0; }
+};
+
+#endif
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_PASSTHROUGHINSPECTORNODE_H
+#define LABSOUNDDEMO_PASSTHROUGHINSPECTORNODE_H
+
+#include "LabSound/LabSound.h"
+
+// PassThroughInspectorNode is the base of the nodes that watch or drive the rendering of
+// the graph upstream of them, such as the profiler and the parallel renderer. Its output is
+// its input, or silence if nothing is connected, so it can be connected between the
+// destination and the graph, or anywhere inline in a graph, without changing the sound.
+//
+// It never propagates silence, so it is processed every quantum. A derived node that does
+// work of its own in process() calls passThrough() when it is done.
+class PassThroughInspectorNode : public lab::AudioBasicInspectorNode
+{
+    virtual bool propagatesSilence(lab::ContextRenderLock&) const override { return false; }
+
+protected:
+    PassThroughInspectorNode(lab::AudioContext& ac, lab::AudioNodeDescriptor const& desc, int channelCount)
+        : lab::AudioBasicInspectorNode(ac, desc, channelCount)
+    {
+    }
+
+    void passThrough(lab::ContextRenderLock& r)
+    {
+        lab::AudioBus* outputBus = output(0)->bus(r);
+        lab::AudioBus* inputBus = input(0)->bus(r);
+        if (!outputBus)
+            return;
+
+        if (inputBus && input(0)->isConnected())
+        {
+            if (inputBus != outputBus)
+                outputBus->copyFrom(*inputBus);
+        }
+        else
+            outputBus->zero();
+    }
+
+public:
+    virtual ~PassThroughInspectorNode() = default;
+
+    virtual void process(lab::ContextRenderLock& r, int) override { passThrough(r); }
+    virtual void reset(lab::ContextRenderLock&) override {}
+    virtual double tailTime(lab::ContextRenderLock&) const override { return 0; }
+    virtual double latencyTime(lab::ContextRenderLock&) const override { return 0; }
+};
+
+#endif
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "PipelineStageNode.h"
+#include "FastMath.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace lab;
+
+namespace
+{
+    // how long the stage's thread keeps polling for the next quantum before it sleeps
+    const std::chrono::milliseconds SpinTime(5);
+}
+
+// processed by the context after everything else in the quantum, this waits for the
+// stage to finish, so that nothing is still rendering when the quantum's lock is released
+class PipelineStageNode::JoinNode : public lab::AudioNode
+{
+    std::shared_ptr<Handoff> _handoff;
+
+public:
+    JoinNode(AudioContext& ac, std::shared_ptr<Handoff> handoff)
+        : AudioNode(ac, *desc())
+        , _handoff(std::move(handoff))
+    {
+        initialize();
+    }
+
+    static AudioNodeDescriptor* desc()
+    {
+        static AudioNodeDescriptor d {nullptr, nullptr};
+        return &d;
+    }
+
+    virtual const char* name() const override { return "PipelineStageJoin"; }
+
+    virtual void process(ContextRenderLock&, int) override
+    {
+        const uint64_t requested = _handoff->requested.load(std::memory_order_acquire);
+        while (_handoff->completed.load(std::memory_order_acquire) < requested)
+            std::this_thread::yield();
+    }
+
+    virtual void reset(ContextRenderLock&) override {}
+    virtual double tailTime(ContextRenderLock&) const override { return 0; }
+    virtual double latencyTime(ContextRenderLock&) const override { return 0; }
+    virtual bool propagatesSilence(ContextRenderLock&) const override { return false; }
+};
+
+PipelineStageNode::PipelineStageNode(AudioContext& ac, int channelCount)
+    : AudioBasicInspectorNode(ac, *desc(), channelCount)
+    , _context(&ac)
+    , _handoff(std::make_shared<Handoff>())
+    , _channels(channelCount)
+    , _ready(static_cast<size_t>(channelCount) * AudioNode::ProcessingSizeInFrames)
+    , _pending(static_cast<size_t>(channelCount) * AudioNode::ProcessingSizeInFrames)
+{
+    _join = std::make_shared<JoinNode>(ac, _handoff);
+    ac.addAutomaticPullNode(_join);
+
+    _thread = std::thread(&PipelineStageNode::run, this);
+    initialize();
+}
+
+PipelineStageNode::~PipelineStageNode()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+
+    // The context may still process the join node in a quantum that has already started,
+    // so it mustn't be left waiting for this stage. It is removed from then on.
+    _handoff->completed.store(_handoff->requested.load());
+    _context->removeAutomaticPullNode(_join);
+}
+
+AudioNodeDescriptor* PipelineStageNode::desc()
+{
+    static AudioNodeDescriptor d {nullptr, nullptr};
+    return &d;
+}
+
+double PipelineStageNode::latencyTime(ContextRenderLock& r) const
+{
+    return latencyFrames() / static_cast<double>(r.context()->sampleRate());
+}
+
+void PipelineStageNode::pullInputs(ContextRenderLock& r, int bufferSize)
+{
+    // the join at the end of the last quantum means the stage's thread is idle, so the
+    // quantum it rendered can be taken, and the next one started
+    std::swap(_ready, _pending);
+    _ready_frames = _pending_frames;
+    _pending_frames = 0;
+
+    _lock = &r;
+    _buffer_size = bufferSize;
+    {
+        // taken so that the stage's thread can't miss the request as it goes to sleep
+        std::lock_guard<std::mutex> lock(_mutex);
+        _handoff->requested.fetch_add(1, std::memory_order_release);
+    }
+    _wake.notify_one();
+}
+
+void PipelineStageNode::process(ContextRenderLock& r, int bufferSize)
+{
+    AudioBus* outputBus = output(0)->bus(r);
+    if (!outputBus)
+        return;
+
+    if (_ready_frames != bufferSize)
+    {
+        outputBus->zero();
+        return;
+    }
+
+    const int channels = std::min(_channels, outputBus->numberOfChannels());
+    for (int c = 0; c < channels; ++c)
+    {
+        const float* src = _ready.data() + static_cast<size_t>(c) * bufferSize;
+        std::copy(src, src + bufferSize, outputBus->channel(c)->mutableData());
+    }
+    outputBus->clearSilentFlag();
+}
+
+void PipelineStageNode::run()
+{
+    DisableDenormals();
+
+    uint64_t seen = 0;
+    auto last_work = std::chrono::steady_clock::now();
+
+    while (!_stop)
+    {
+        const uint64_t requested = _handoff->requested.load(std::memory_order_acquire);
+        if (requested == seen)
+        {
+            if (std::chrono::steady_clock::now() - last_work < SpinTime)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&]() { return _stop || _handoff->requested.load() != seen; });
+            continue;
+        }
+
+        seen = requested;
+        renderUpstream();
+        _handoff->completed.store(seen, std::memory_order_release);
+        last_work = std::chrono::steady_clock::now();
+    }
+}
+
+void PipelineStageNode::renderUpstream()
+{
+    ContextRenderLock& r = *_lock;
+    const int frames = _buffer_size;
+
+    // As NodeProfilerNode does, process everything upstream in order, so that the pull
+    // below only gathers the results. The order ends at any stage upstream, which is only
+    // processed, to output what its own thread rendered in the last quantum.
+    _order.update(r, this);
+    for (AudioNode* node : _order.nodes())
+        node->processIfNecessary(r, frames);
+
+    // Not AudioBasicInspectorNode::pullInputs(), which would pull in place into the stage's
+    // output bus while the render thread reads it. Without an in place bus, the input mixes
+    // into its own bus, or passes on the bus of its only source.
+    AudioBus* inputBus = input(0)->isConnected() ? input(0)->pull(r, nullptr, frames) : nullptr;
+
+    if (_pending.size() < static_cast<size_t>(_channels) * frames)
+        _pending.resize(static_cast<size_t>(_channels) * frames);
+
+    const int inputChannels = inputBus ? inputBus->numberOfChannels() : 0;
+    for (int c = 0; c < _channels; ++c)
+    {
+        float* dst = _pending.data() + static_cast<size_t>(c) * frames;
+        if (!inputChannels)
+            std::fill(dst, dst + frames, 0.f);
+        else if (_channels == 1 && inputChannels > 1)
+        {
+            // down mix to a mono stage
+            std::fill(dst, dst + frames, 0.f);
+            const float scale = 1.f / inputChannels;
+            for (int k = 0; k < inputChannels; ++k)
+            {
+                const float* src = inputBus->channel(k)->data();
+                for (int i = 0; i < frames; ++i)
+                    dst[i] += src[i] * scale;
+            }
+        }
+        else
+        {
+            const float* src = inputBus->channel(std::min(c, inputChannels - 1))->data();
+            std::copy(src, src + frames, dst);
+        }
+    }
+    _pending_frames = frames;
+}
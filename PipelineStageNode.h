@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_PIPELINESTAGENODE_H
+#define LABSOUNDDEMO_PIPELINESTAGENODE_H
+
+#include "LabSound/LabSound.h"
+#include "NodeProfiler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// PipelineStageNode splits a serial chain of nodes into stages that render concurrently,
+// at the cost of a quantum of latency per stage. It is a pass-through node; put it between
+// two parts of a chain, for example between a filter network and the compressor after it.
+//
+// When the stage is pulled, it outputs what its inputs produced during the previous quantum,
+// and hands the graph upstream of it to its own thread to render the current quantum. So
+// while the render thread processes the nodes downstream of the stage, the stage's thread
+// processes the nodes upstream of it. Stages may be chained, each one adding a thread; a
+// stage's thread stops at the stage before it, which it only processes, so that it hands
+// over its previous quantum and starts its own thread on the next. The stage's thread pulls
+// its inputs into buses of their own, never into the stage's output, which the render
+// thread is reading meanwhile. All
+// stages finish before the quantum ends, when the context processes its automatic pull
+// nodes, and the stage registers one with the context for that purpose. Results are handed
+// over between the threads in a double buffer, guarded by those two points.
+//
+// The nodes upstream of a stage must only be pulled through it. A node that also feeds
+// something downstream of the stage would be processed on two threads at once. The stage
+// itself must be pulled through the destination rather than by an automatic pull node,
+// which might be processed after the stage's join.
+//
+// The first quantum a stage outputs is silent. A stage must be destroyed before its
+// context, as it takes its join node out of the context's automatic pull nodes.
+class PipelineStageNode : public lab::AudioBasicInspectorNode, public RenderBoundary
+{
+    // what the render thread and the stage's thread synchronize on. Shared with the node
+    // that waits for the stage at the end of each quantum, since the context may keep that
+    // node after the stage is gone.
+    struct Handoff
+    {
+        std::atomic<uint64_t> requested {0};
+        std::atomic<uint64_t> completed {0};
+    };
+
+    class JoinNode;
+
+    lab::AudioContext* _context;
+    std::shared_ptr<Handoff> _handoff;
+    std::shared_ptr<lab::AudioNode> _join;
+
+    int _channels;
+    std::vector<float> _ready;      // the previous quantum, output by the render thread
+    std::vector<float> _pending;    // the current quantum, written by the stage's thread
+    int _ready_frames = 0;
+    int _pending_frames = 0;
+
+    // the quantum being rendered
+    lab::ContextRenderLock* _lock = nullptr;
+    int _buffer_size = 0;
+    RenderOrder _order;                 // the stage's thread only
+
+    std::thread _thread;
+    std::atomic<bool> _stop {false};
+    std::mutex _mutex;
+    std::condition_variable _wake;
+
+    void run();
+    void renderUpstream();
+
+    virtual bool propagatesSilence(lab::ContextRenderLock&) const override { return false; }
+
+public:
+    explicit PipelineStageNode(lab::AudioContext& ac, int channelCount = 2);
+    virtual ~PipelineStageNode();
+
+    static const char* static_name() { return "PipelineStage"; }
+    virtual const char* name() const override { return static_name(); }
+    static lab::AudioNodeDescriptor* desc();
+
+    virtual void pullInputs(lab::ContextRenderLock&, int bufferSize) override;
+    virtual void process(lab::ContextRenderLock&, int bufferSize) override;
+    virtual void reset(lab::ContextRenderLock&) override {}
+    virtual double tailTime(lab::ContextRenderLock&) const override { return 0; }
+    virtual double latencyTime(lab::ContextRenderLock& r) const override;
+
+    // the latency the stage adds, in frames
+    static int latencyFrames() { return lab::AudioNode::ProcessingSizeInFrames; }
+};
+
+#endif
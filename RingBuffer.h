@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_RINGBUFFER_H
+#define LABSOUNDDEMO_RINGBUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// A lock-free ring buffer for one producer thread and one consumer thread, such as the
+// render thread and a disk thread. Neither side blocks or allocates, so it is safe to use
+// from process(). The capacity is rounded up to a power of two.
+template <typename T>
+class SpscRingBuffer
+{
+    std::vector<T> _data;
+    size_t _mask = 0;
+    std::atomic<size_t> _write{0};  // only advanced by the producer
+    std::atomic<size_t> _read{0};   // only advanced by the consumer
+
+public:
+    explicit SpscRingBuffer(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        _data.resize(size);
+        _mask = size - 1;
+    }
+
+    size_t capacity() const { return _data.size(); }
+
+    // may be called from either side; the result is a snapshot
+    size_t size() const
+    {
+        return _write.load(std::memory_order_acquire) - _read.load(std::memory_order_acquire);
+    }
+
+    // producer side. Writes all count items, or none if they don't fit.
+    bool tryWrite(const T* src, size_t count)
+    {
+        const size_t w = _write.load(std::memory_order_relaxed);
+        const size_t r = _read.load(std::memory_order_acquire);
+        if (capacity() - (w - r) < count)
+            return false;
+
+        const size_t start = w & _mask;
+        const size_t first = std::min(count, capacity() - start);
+        std::copy(src, src + first, _data.begin() + start);
+        std::copy(src + first, src + count, _data.begin());
+        _write.store(w + count, std::memory_order_release);
+        return true;
+    }
+
+    // producer side. Returns the number of free slots.
+    size_t writable() const
+    {
+        return capacity() - (_write.load(std::memory_order_relaxed) - _read.load(std::memory_order_acquire));
+    }
+
+    // consumer side. Reads up to count items, returns the number read.
+    size_t read(T* dst, size_t count)
+    {
+        const size_t r = _read.load(std::memory_order_relaxed);
+        const size_t w = _write.load(std::memory_order_acquire);
+        count = std::min(count, w - r);
+
+        const size_t start = r & _mask;
+        const size_t first = std::min(count, capacity() - start);
+        std::copy(_data.begin() + start, _data.begin() + start + first, dst);
+        std::copy(_data.begin(), _data.begin() + (count - first), dst + first);
+        _read.store(r + count, std::memory_order_release);
+        return count;
+    }
+
+    // consumer side. Drops everything written so far.
+    void discard()
+    {
+        _read.store(_write.load(std::memory_order_acquire), std::memory_order_release);
+    }
+};
+
+// A bounded lock-free queue for any number of producer threads and one consumer thread,
+// such as control threads posting events to the render thread. Each slot carries a sequence
+// number, so producers claim slots with a single compare and swap, and neither side blocks
+// or allocates. The capacity is rounded up to a power of two.
+template <typename T>
+class MpscQueue
+{
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::vector<Slot> _slots;
+    size_t _mask = 0;
+    std::atomic<size_t> _write{0};
+    size_t _read = 0;               // consumer only
+
+public:
+    explicit MpscQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        _slots = std::vector<Slot>(size);
+        _mask = size - 1;
+        for (size_t i = 0; i < size; ++i)
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return _slots.size(); }
+
+    // any thread. Returns false if the queue is full.
+    bool tryPush(const T& value)
+    {
+        size_t pos = _write.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = _slots[pos & _mask];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (_write.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.value = value;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;   // the consumer hasn't freed this slot yet
+            else
+                pos = _write.load(std::memory_order_relaxed);
+        }
+    }
+
+    // consumer side. Returns false if the queue is empty, or the next item is still being
+    // written.
+    bool tryPop(T& value)
+    {
+        Slot& slot = _slots[_read & _mask];
+        if (slot.sequence.load(std::memory_order_acquire) != _read + 1)
+            return false;
+
+        value = slot.value;
+        slot.sequence.store(_read + capacity(), std::memory_order_release);
+        ++_read;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,265 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "StreamingFileNode.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace lab;
+
+namespace
+{
+    // frames converted per trip through the ring
+    const size_t ReadChunkFrames = 1024;
+
+    // the size of a render quantum, so the render thread doesn't need to allocate
+    const size_t QuantumFrames = 128;
+}
+
+StreamingFileNode::StreamingFileNode(AudioContext& ac, int channels, float prefetch_seconds)
+    : FunctionNode(ac, channels)
+    , _channels(channels)
+    , _sample_rate(ac.sampleRate())
+    , _ring(static_cast<size_t>(std::max(prefetch_seconds * ac.sampleRate(), static_cast<float>(ReadChunkFrames * 2))) * channels)
+{
+    _quantum.resize(QuantumFrames * channels);
+    setFunction([this](ContextRenderLock&, FunctionNode*, int channel, float* values, int frames) {
+        render(channel, values, frames);
+    });
+}
+
+StreamingFileNode::~StreamingFileNode()
+{
+    close();
+}
+
+bool StreamingFileNode::open(const std::string& path)
+{
+    close();
+
+    std::shared_ptr<MappedAudioFile> file = MappedAudioFile::open(path);
+    if (!file)
+    {
+        // Not a format that can be read in place; decode it once, to a sidecar that can be.
+        // LabSound only decodes whole files, so the decoded file is released as soon as
+        // the sidecar is written, and if it can't be, the file isn't opened, rather than
+        // holding all of it for as long as it plays.
+        const std::string sidecar = SidecarPath(path, _sample_rate);
+        if (IsFileUpToDate(sidecar, path))
+            file = MappedAudioFile::open(sidecar);
+
+        if (!file)
+        {
+            std::shared_ptr<AudioBus> bus = MakeBusFromFile(path, false, _sample_rate);
+            if (!bus || !bus->length() || !WritePlanarFloatFile(sidecar, *bus, _sample_rate))
+                return false;
+
+            bus.reset();
+            file = MappedAudioFile::open(sidecar);
+            if (!file)
+                return false;
+        }
+    }
+
+    _file = file;
+    _file_channels = file->channels();
+    _file_frames = file->frames();
+    _file_rate = file->sampleRate();
+
+    if (!_file_frames || !_file_channels)
+    {
+        close();
+        return false;
+    }
+
+    _step = _file_rate / _sample_rate;
+    _position = 0;
+    _eof = false;
+    _ended = false;
+    const uint64_t generation = _seek_generation;
+    _reader_generation = generation;
+    _render_generation = generation;
+
+    _scratch.reserve(static_cast<size_t>(ReadChunkFrames * _step) + 2);
+    _interleaved.reserve(ReadChunkFrames * _channels);
+
+    // prefill, so that playback can start as soon as the file is open
+    while (!_eof && fill(ReadChunkFrames)) {}
+
+    _reader = std::thread(&StreamingFileNode::readLoop, this);
+    return true;
+}
+
+void StreamingFileNode::close()
+{
+    if (_reader.joinable())
+    {
+        _stop = true;
+        _reader.join();
+        _stop = false;
+    }
+
+    // the node isn't playing, so it is safe to drain the ring from here
+    _ring.discard();
+    _file.reset();
+    _file_channels = 0;
+    _file_frames = 0;
+    _eof = false;
+    _ended = false;
+}
+
+void StreamingFileNode::seek(double seconds)
+{
+    _seek_frame = std::floor(std::max(0.0, seconds) * _file_rate);
+    ++_seek_generation;
+}
+
+double StreamingFileNode::duration() const
+{
+    return _file_rate > 0 ? _file_frames / static_cast<double>(_file_rate) : 0.0;
+}
+
+void StreamingFileNode::readLoop()
+{
+    while (!_stop)
+    {
+        const uint64_t generation = _seek_generation;
+        if (generation != _reader_generation)
+        {
+            // nothing more is written until the render thread has emptied the ring
+            _reader_generation = generation;
+            while (!_stop && _render_generation != generation)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            _position = _seek_frame;
+            _eof = false;
+            continue;
+        }
+
+        // looping was turned on after the last frame had been read, as it is when setLoop()
+        // follows the open() of a file short enough for the prefill to reach its end
+        if (_eof && _loop)
+        {
+            _position = std::fmod(_position, static_cast<double>(_file_frames));
+            _eof = false;
+        }
+
+        if (_eof || !fill(ReadChunkFrames))
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+bool StreamingFileNode::fill(size_t frames)
+{
+    if (_ring.writable() < frames * _channels)
+        return false;
+
+    const bool loop = _loop;
+    if (!loop)
+    {
+        // don't pad the last chunk with silence past the end of the file
+        const double remaining = (_file_frames - std::min(_position, static_cast<double>(_file_frames))) / _step;
+        frames = std::min(frames, static_cast<size_t>(std::ceil(remaining)));
+        if (!frames)
+        {
+            _eof = true;
+            return true;
+        }
+    }
+
+    const uint64_t first = static_cast<uint64_t>(_position);
+    const double offset = _position - first;
+    const size_t span = static_cast<size_t>(offset + frames * _step) + 2;
+    _scratch.resize(span);
+    _interleaved.resize(frames * _channels);
+
+    for (int c = 0; c < _channels; ++c)
+    {
+        readFrames(c % _file_channels, first, span, _scratch.data());
+
+        const float* src = _scratch.data();
+        float* dst = _interleaved.data() + c;
+        for (size_t i = 0; i < frames; ++i, dst += _channels)
+        {
+            const double p = offset + i * _step;
+            const size_t j = static_cast<size_t>(p);
+            const float t = static_cast<float>(p - j);
+            *dst = src[j] + (src[j + 1] - src[j]) * t;
+        }
+    }
+
+    _ring.tryWrite(_interleaved.data(), _interleaved.size());
+
+    _position += frames * _step;
+    if (_position >= _file_frames)
+    {
+        if (loop)
+            _position = std::fmod(_position, static_cast<double>(_file_frames));
+        else
+            _eof = true;
+    }
+    return true;
+}
+
+void StreamingFileNode::readFrames(int channel, uint64_t frame, size_t count, float* dst) const
+{
+    while (count)
+    {
+        if (frame >= _file_frames)
+        {
+            if (!_loop)
+            {
+                std::fill(dst, dst + count, 0.f);
+                return;
+            }
+            frame %= _file_frames;
+        }
+
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(count, _file_frames - frame));
+        _file->read(channel, frame, n, dst);
+
+        dst += n;
+        frame += n;
+        count -= n;
+    }
+}
+
+void StreamingFileNode::render(int channel, float* values, int frames)
+{
+    const size_t wanted = static_cast<size_t>(frames) * _channels;
+
+    if (channel == 0)
+    {
+        const uint64_t generation = _reader_generation;
+        if (generation != _render_generation)
+        {
+            _ring.discard();
+            _render_generation = generation;
+        }
+
+        if (_quantum.size() < wanted)
+            _quantum.resize(wanted);
+
+        const size_t got = _file_frames ? _ring.read(_quantum.data(), wanted) : 0;
+        std::fill(_quantum.begin() + got, _quantum.begin() + wanted, 0.f);
+
+        // a short read while a seek is settling, or after the last frame, is expected
+        const bool eof = _eof;
+        if (got < wanted && _file_frames && !eof && generation == _seek_generation)
+            ++_underruns;
+
+        _ended = eof && _ring.size() == 0;
+    }
+
+    if (channel >= _channels)
+    {
+        std::fill(values, values + frames, 0.f);
+        return;
+    }
+
+    const float* src = _quantum.data() + channel;
+    for (int i = 0; i < frames; ++i, src += _channels)
+        values[i] = *src;
+}
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_STREAMINGFILENODE_H
+#define LABSOUNDDEMO_STREAMINGFILENODE_H
+
+#include "LabSound/LabSound.h"
+#include "MappedAudioFile.h"
+#include "RingBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// StreamingFileNode plays a file from disk without decoding it up front. A reader thread
+// converts the file a little ahead of playback into a lock-free ring buffer, which the
+// render thread drains, so only the prefetch window is resident rather than the whole
+// file. Playback can loop, and can seek while playing.
+//
+// Wav and planar float files are read in place through MappedAudioFile. Other formats,
+// such as ogg, are decoded once at the context's rate and written to the user's cache
+// directory as a planar float file, the same sidecar AssetCache writes, see SidecarPath(),
+// which is streamed from then on; if that can't be written, open() fails, rather than hold
+// the whole decoded file in memory. If a mapped file's sample rate differs from the
+// context's, the reader converts it by linear interpolation.
+//
+// The node is a FunctionNode, so it is started and stopped like any scheduled source.
+class StreamingFileNode : public lab::FunctionNode
+{
+    std::shared_ptr<MappedAudioFile> _file;
+    int _file_channels = 0;
+    uint64_t _file_frames = 0;
+    float _file_rate = 0;
+    double _step = 1;                   // file frames per rendered frame
+
+    int _channels;
+    float _sample_rate;
+    SpscRingBuffer<float> _ring;        // interleaved, at the context's rate
+    std::vector<float> _quantum;        // the current quantum, interleaved
+
+    // reader thread state
+    std::thread _reader;
+    std::atomic<bool> _stop{false};
+    double _position = 0;               // in file frames
+    std::vector<float> _scratch;        // source frames of one channel
+    std::vector<float> _interleaved;    // converted frames, waiting to be written
+    std::atomic<bool> _eof{false};      // the reader has written the last frame
+
+    std::atomic<bool> _loop{false};
+    std::atomic<bool> _ended{false};
+    std::atomic<uint64_t> _underruns{0};
+
+    // A seek bumps the seek generation. The reader stops writing and publishes the new
+    // generation, the render thread empties the ring when it sees it, and the reader waits
+    // for that before it fills from the new position, so no stale frames are played.
+    std::atomic<uint64_t> _seek_generation{0};
+    std::atomic<double> _seek_frame{0};
+    std::atomic<uint64_t> _reader_generation{0};
+    std::atomic<uint64_t> _render_generation{0};
+
+    void readLoop();
+    bool fill(size_t frames);
+    void readFrames(int channel, uint64_t frame, size_t count, float* dst) const;
+    void render(int channel, float* values, int frames);
+
+public:
+    // prefetch_seconds is the size of the ring buffer
+    StreamingFileNode(lab::AudioContext& ac, int channels = 2, float prefetch_seconds = 0.5f);
+    virtual ~StreamingFileNode();
+
+    // returns false if the file can't be read, or needs a sidecar that can't be written.
+    // The node must not be playing.
+    bool open(const std::string& path);
+    void close();
+
+    // may be called before or after open(), and while playing. Turning looping on after
+    // the reader has reached the end of the file carries on from its start.
+    void setLoop(bool loop) { _loop = loop; }
+    void seek(double seconds);
+
+    // true once a file that isn't looping has played to its end
+    bool ended() const { return _ended; }
+
+    // quanta that were rendered, in whole or part, as silence because the reader fell behind
+    uint64_t underruns() const { return _underruns; }
+
+    double duration() const;
+};
+
+#endif
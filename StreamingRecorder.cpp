@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "StreamingRecorder.h"
+
+#include <chrono>
+#include <cstring>
+
+using namespace lab;
+
+namespace
+{
+    void put_u16(unsigned char* p, uint16_t v)
+    {
+        p[0] = v & 0xff;
+        p[1] = (v >> 8) & 0xff;
+    }
+
+    void put_u32(unsigned char* p, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            p[i] = (v >> (8 * i)) & 0xff;
+    }
+
+    const uint32_t wav_header_size = 44;
+    const uint16_t wav_format_ieee_float = 3;
+}
+
+StreamingRecorderNode::StreamingRecorderNode(AudioContext& ac, int channelCount, float buffer_seconds)
+    : PassThroughInspectorNode(ac, *desc(), channelCount)
+    , _channels(channelCount)
+    , _sample_rate(ac.sampleRate())
+    , _ring(static_cast<size_t>(buffer_seconds * ac.sampleRate()) * channelCount)
+    , _interleaved(AudioNode::ProcessingSizeInFrames * channelCount)
+{
+    initialize();
+}
+
+StreamingRecorderNode::~StreamingRecorderNode()
+{
+    stopRecording();
+}
+
+AudioNodeDescriptor* StreamingRecorderNode::desc()
+{
+    static AudioNodeDescriptor d {nullptr, nullptr};
+    return &d;
+}
+
+void StreamingRecorderNode::process(ContextRenderLock& r, int bufferSize)
+{
+    AudioBus* inputBus = input(0)->bus(r);
+    const bool connected = inputBus && input(0)->isConnected();
+
+    if (_recording && bufferSize <= AudioNode::ProcessingSizeInFrames)
+    {
+        // interleave into the scratch buffer, silence if nothing is connected
+        const int busChannels = connected ? static_cast<int>(inputBus->numberOfChannels()) : 0;
+        for (int c = 0; c < _channels; ++c)
+        {
+            const float* src = c < busChannels ? inputBus->channel(c)->data() : nullptr;
+            for (int i = 0; i < bufferSize; ++i)
+                _interleaved[i * _channels + c] = src ? src[i] : 0.f;
+        }
+
+        const size_t samples = static_cast<size_t>(bufferSize) * _channels;
+        if (!_ring.tryWrite(_interleaved.data(), samples))
+        {
+            bool written = false;
+            if (_blocking)
+            {
+                // the writer signals under the mutex after every read, so no wakeup is missed
+                std::unique_lock<std::mutex> lock(_space_mutex);
+                _space_cv.wait(lock, [&]() {
+                    written = _ring.tryWrite(_interleaved.data(), samples);
+                    return written || _stop;
+                });
+            }
+            if (!written)
+                _dropped += bufferSize;
+        }
+    }
+
+    passThrough(r);
+}
+
+bool StreamingRecorderNode::startRecording(const std::string& path, bool mix_to_mono)
+{
+    stopRecording();
+
+    _file = fopen(path.c_str(), "wb");
+    if (!_file)
+        return false;
+
+    _mix_to_mono = mix_to_mono;
+    _written = 0;
+    _dropped = 0;
+    writeHeader(0);
+
+    // anything left from a previous recording is stale
+    _ring.discard();
+    _stop = false;
+    _writer = std::thread([this]() { writeLoop(); });
+    _recording = true;
+    return true;
+}
+
+void StreamingRecorderNode::stopRecording()
+{
+    if (!_file)
+        return;
+
+    _recording = false;
+    {
+        std::lock_guard<std::mutex> lock(_space_mutex);
+        _stop = true;
+    }
+    _space_cv.notify_all();
+    if (_writer.joinable())
+        _writer.join();
+
+    writeHeader(static_cast<uint32_t>(_written));
+    fclose(_file);
+    _file = nullptr;
+}
+
+float StreamingRecorderNode::recordedLengthInSeconds() const
+{
+    return static_cast<float>(static_cast<double>(_written) / _sample_rate);
+}
+
+void StreamingRecorderNode::writeLoop()
+{
+    const size_t chunk_frames = 4096;
+    std::vector<float> chunk(chunk_frames * _channels);
+    std::vector<float> mono(_mix_to_mono ? chunk_frames : 0);
+
+    while (true)
+    {
+        // whole frames only; the render thread always writes whole frames
+        const size_t available = _ring.size() / _channels;
+        const size_t frames = _ring.read(chunk.data(), std::min(available, chunk_frames) * _channels) / _channels;
+        if (frames && _blocking)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_space_mutex);
+            }
+            _space_cv.notify_one();
+        }
+
+        if (!frames)
+        {
+            // nothing left to write; stop has to be checked first, so nothing is left behind
+            if (_stop && _ring.size() < static_cast<size_t>(_channels))
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+
+        if (_mix_to_mono)
+        {
+            const float scale = 1.f / _channels;
+            for (size_t i = 0; i < frames; ++i)
+            {
+                float sum = 0;
+                for (int c = 0; c < _channels; ++c)
+                    sum += chunk[i * _channels + c];
+                mono[i] = sum * scale;
+            }
+            fwrite(mono.data(), sizeof(float), frames, _file);
+        }
+        else
+            fwrite(chunk.data(), sizeof(float), frames * _channels, _file);
+
+        _written += frames;
+    }
+}
+
+void StreamingRecorderNode::writeHeader(uint32_t frames)
+{
+    // the canonical 44 byte header
+    const uint16_t channels = static_cast<uint16_t>(_mix_to_mono ? 1 : _channels);
+    const uint32_t sample_rate = static_cast<uint32_t>(_sample_rate);
+    const uint32_t data_bytes = frames * channels * sizeof(float);
+
+    unsigned char h[wav_header_size];
+    memcpy(h, "RIFF", 4);
+    put_u32(h + 4, 36 + data_bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put_u32(h + 16, 16);
+    put_u16(h + 20, wav_format_ieee_float);
+    put_u16(h + 22, channels);
+    put_u32(h + 24, sample_rate);
+    put_u32(h + 28, sample_rate * channels * sizeof(float));
+    put_u16(h + 32, static_cast<uint16_t>(channels * sizeof(float)));
+    put_u16(h + 34, 32);
+    memcpy(h + 36, "data", 4);
+    put_u32(h + 40, data_bytes);
+
+    fseek(_file, 0, SEEK_SET);
+    fwrite(h, 1, wav_header_size, _file);
+    fseek(_file, 0, SEEK_END);
+}
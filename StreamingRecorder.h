@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_STREAMINGRECORDER_H
+#define LABSOUNDDEMO_STREAMINGRECORDER_H
+
+#include "LabSound/LabSound.h"
+#include "PassThroughInspectorNode.h"
+#include "RingBuffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// StreamingRecorderNode records its input to a wav file while the graph renders. Unlike
+// RecorderNode, which holds the whole recording in memory until it is written, the render
+// thread pushes each quantum into a lock-free ring buffer, and a writer thread appends it
+// to the file. Memory use is constant however long the recording is, and stopping does not
+// stall on a large write. The header's sizes are patched when the recording stops.
+//
+// Samples are written as 32 bit float, in host byte order, which is little endian on
+// every platform LabSound supports. If the writer falls behind by more than the ring
+// buffer holds, quanta are dropped and counted rather than blocking the render thread.
+// Offline renders, which run faster than the writer can keep up with and have no deadline
+// to meet, should setBlocking(true) instead, so the render waits for the writer and
+// nothing is dropped.
+class StreamingRecorderNode : public PassThroughInspectorNode
+{
+    int _channels;
+    float _sample_rate;
+    SpscRingBuffer<float> _ring;        // interleaved frames
+    std::vector<float> _interleaved;    // render thread scratch
+
+    std::atomic<bool> _recording{false};
+    std::atomic<bool> _stop{false};
+    bool _blocking = false;
+    std::mutex _space_mutex;
+    std::condition_variable _space_cv;  // signalled when the writer frees room in the ring
+    std::atomic<uint64_t> _dropped{0};
+    std::atomic<uint64_t> _written{0};
+
+    std::thread _writer;
+    FILE* _file = nullptr;
+    bool _mix_to_mono = false;
+
+    void writeLoop();
+    void writeHeader(uint32_t frames);
+
+public:
+    // buffer_seconds is the capacity of the ring buffer, which is how far the writer may
+    // fall behind the render before quanta are dropped
+    StreamingRecorderNode(lab::AudioContext& ac, int channelCount = 2, float buffer_seconds = 2.f);
+    virtual ~StreamingRecorderNode();
+
+    static const char* static_name() { return "StreamingRecorder"; }
+    virtual const char* name() const override { return static_name(); }
+    static lab::AudioNodeDescriptor* desc();
+
+    virtual void process(lab::ContextRenderLock&, int bufferSize) override;
+
+    // when set, a full ring holds the render thread until the writer makes room, rather than
+    // dropping the quantum. Only for offline contexts. Must be set before recording starts.
+    void setBlocking(bool blocking) { _blocking = blocking; }
+
+    // opens the file and starts writing; returns false if the file can't be created
+    bool startRecording(const std::string& path, bool mix_to_mono = false);
+
+    // writes out everything rendered so far, finishes the header, and closes the file
+    void stopRecording();
+
+    uint64_t framesWritten() const { return _written; }
+    uint64_t framesDropped() const { return _dropped; }
+    float recordedLengthInSeconds() const;
+};
+
+#endif
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#include "VoicePoolNode.h"
+#include "FastMath.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace lab;
+
+VoicePoolNode::VoicePoolNode(AudioContext& ac, int voices, int channels, size_t queueCapacity)
+    : AudioScheduledSourceNode(ac, *desc())
+    , _queue(queueCapacity)
+    , _voices(std::max(1, voices))
+    , _channels(std::max(1, channels))
+    , _voice_sample(_voices)
+    , _voice_position(_voices)
+    , _voice_start(_voices)
+    , _voice_level(_voices)
+    , _voice_gain(static_cast<size_t>(_voices) * _channels)
+{
+    _samples.reserve(MaxSamples);
+
+    // a trigger waits in _pending once it has been taken from the queue, so between them
+    // they hold as many triggers as the queue does
+    _pending.reserve(_queue.capacity());
+
+    addOutput(std::unique_ptr<AudioNodeOutput>(new AudioNodeOutput(this, _channels)));
+    initialize();
+}
+
+AudioNodeDescriptor* VoicePoolNode::desc()
+{
+    static AudioNodeDescriptor d {nullptr, nullptr};
+    return &d;
+}
+
+int VoicePoolNode::addSample(std::shared_ptr<AudioBus> sample)
+{
+    if (!sample)
+        return -1;
+
+    std::lock_guard<std::mutex> lock(_samples_mutex);
+    const int index = _sample_count.load(std::memory_order_relaxed);
+    if (index >= MaxSamples)
+        return -1;
+
+    // the storage was reserved, so the render thread's view of the earlier samples is stable
+    _samples.push_back(std::move(sample));
+    _sample_count.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+bool VoicePoolNode::trigger(int sample, double when, float gain, float pan)
+{
+    if (sample < 0 || sample >= _sample_count.load(std::memory_order_acquire))
+        return false;
+
+    Trigger t;
+    t.sample = sample;
+    t.gain = gain;
+    t.pan = std::max(-1.f, std::min(1.f, pan));
+    t.when = when;
+    if (_queue.tryPush(t))
+        return true;
+
+    ++_dropped;
+    return false;
+}
+
+void VoicePoolNode::startVoice(const Trigger& t, int64_t offset, uint64_t frame)
+{
+    int v = _active;
+    if (v == _voices)
+    {
+        // every voice is playing, so all of them are candidates
+        switch (_stealing.load(std::memory_order_relaxed))
+        {
+        case VoiceStealing::None:
+            ++_dropped;
+            return;
+
+        case VoiceStealing::Oldest:
+            v = static_cast<int>(std::min_element(_voice_start.begin(), _voice_start.end()) - _voice_start.begin());
+            break;
+
+        case VoiceStealing::Quietest:
+            v = static_cast<int>(std::min_element(_voice_level.begin(), _voice_level.end()) - _voice_level.begin());
+            break;
+        }
+        ++_stolen;
+    }
+    else
+        ++_active;
+
+    _voice_sample[v] = t.sample;
+    _voice_position[v] = -offset;
+    _voice_start[v] = frame;
+    _voice_level[v] = std::abs(t.gain);
+
+    // a mono sample is panned with an equal power law, the channels of anything wider are
+    // balanced against each other
+    float* gain = _voice_gain.data() + static_cast<size_t>(v) * _channels;
+    const bool mono = _samples[t.sample]->numberOfChannels() == 1;
+    for (int c = 0; c < _channels; ++c)
+        gain[c] = t.gain;
+    if (_channels >= 2)
+    {
+        if (mono)
+        {
+            const float angle = (t.pan + 1.f) * static_cast<float>(M_PI) * 0.25f;
+            gain[0] *= std::cos(angle);
+            gain[1] *= std::sin(angle);
+        }
+        else if (t.pan > 0)
+            gain[0] *= 1.f - t.pan;
+        else
+            gain[1] *= 1.f + t.pan;
+    }
+}
+
+void VoicePoolNode::stopVoice(int v)
+{
+    // keep the playing voices packed at the front of the pool
+    const int last = --_active;
+    if (v != last)
+    {
+        _voice_sample[v] = _voice_sample[last];
+        _voice_position[v] = _voice_position[last];
+        _voice_start[v] = _voice_start[last];
+        _voice_level[v] = _voice_level[last];
+        std::copy(_voice_gain.begin() + static_cast<size_t>(last) * _channels,
+                  _voice_gain.begin() + static_cast<size_t>(last + 1) * _channels,
+                  _voice_gain.begin() + static_cast<size_t>(v) * _channels);
+    }
+}
+
+void VoicePoolNode::process(ContextRenderLock& r, int bufferSize)
+{
+    AudioBus* outputBus = output(0)->bus(r);
+    if (!outputBus)
+        return;
+
+    outputBus->zero();
+
+    const int offset = _scheduler._renderOffset;
+    const int frames = _scheduler._renderLength;
+    if (!isInitialized() || !frames)
+    {
+        _active_count.store(_active, std::memory_order_relaxed);
+        return;
+    }
+
+    const uint64_t quantumStart = r.context()->currentSampleFrame();
+    const uint64_t quantumEnd = quantumStart + bufferSize;
+    const double sampleRate = r.context()->sampleRate();
+
+    // take what has been posted, leaving it queued if _pending is full
+    Trigger t;
+    while (_pending.size() < _pending.capacity() && _queue.tryPop(t))
+    {
+        _pending.push_back(t);
+        std::push_heap(_pending.begin(), _pending.end());
+    }
+
+    // start everything due this quantum, earliest first, not before the node itself started.
+    // Triggers due later stay in the heap untouched.
+    while (!_pending.empty())
+    {
+        const Trigger& p = _pending.front();
+        const uint64_t frame = p.when > 0 ? static_cast<uint64_t>(std::llround(p.when * sampleRate)) : 0;
+        if (frame >= quantumEnd)
+            break;
+
+        const int64_t start = std::max<int64_t>(offset, frame > quantumStart ? static_cast<int64_t>(frame - quantumStart) : 0);
+        startVoice(p, start, quantumStart + start);
+        std::pop_heap(_pending.begin(), _pending.end());
+        _pending.pop_back();
+    }
+
+    // mix every voice over the part of the quantum that it and the node are both playing in
+    const int channels = outputBus->numberOfChannels();
+    const int64_t renderEnd = offset + frames;
+    for (int v = 0; v < _active;)
+    {
+        const AudioBus* sample = _samples[_voice_sample[v]].get();
+        const int64_t position = _voice_position[v];
+        const int64_t length = sample->length();
+
+        const int64_t begin = std::max<int64_t>(offset, -position);
+        const int64_t end = std::min<int64_t>(renderEnd, length - position);
+        if (begin < end)
+        {
+            const float* gain = _voice_gain.data() + static_cast<size_t>(v) * _channels;
+            const int sampleChannels = sample->numberOfChannels();
+            for (int c = 0; c < channels && c < _channels; ++c)
+            {
+                const float* src = sample->channel(std::min(c, sampleChannels - 1))->data() + position + begin;
+                FastMulAddBlock(src, gain[c], outputBus->channel(c)->mutableData() + begin, static_cast<int>(end - begin));
+            }
+        }
+
+        _voice_position[v] = position + bufferSize;
+        if (_voice_position[v] >= length)
+            stopVoice(v);   // moves the last voice into v
+        else
+            ++v;
+    }
+
+    _active_count.store(_active, std::memory_order_relaxed);
+    outputBus->clearSilentFlag();
+}
+
+void VoicePoolNode::reset(ContextRenderLock&)
+{
+    while (_active)
+        stopVoice(_active - 1);
+    _pending.clear();
+    _active_count = 0;
+}
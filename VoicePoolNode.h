@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_VOICEPOOLNODE_H
+#define LABSOUNDDEMO_VOICEPOOLNODE_H
+
+#include "LabSound/LabSound.h"
+#include "RingBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// what a VoicePoolNode does with a trigger when every voice is playing
+enum class VoiceStealing
+{
+    None,       // the trigger is dropped
+    Oldest,     // the voice that started first is cut off
+    Quietest,   // the voice with the lowest gain is cut off
+};
+
+// VoicePoolNode plays one-shot samples on a fixed pool of voices, for music with many
+// overlapping hits. Scheduling a SampledAudioNode per hit, or many hits on a few of them,
+// costs allocations and graph work for every hit; here a hit is a small record posted to
+// a lock-free queue, and the voices are mixed in one pass over the pool.
+//
+// Samples are registered once with addSample(), and then triggered by index with trigger()
+// from any thread. Nothing is allocated after construction. The voices are stored as
+// arrays of each property rather than as an array of voices, so that the pool is scanned
+// without touching the state of idle voices, and each voice is mixed into the output with
+// FastMulAddBlock.
+//
+// Samples are played at their own rate, so they should be decoded at the context's rate.
+// A mono sample is panned with an equal power law; the channels of a multichannel sample
+// are balanced. The node must be started, like any scheduled source, before it plays.
+class VoicePoolNode : public lab::AudioScheduledSourceNode
+{
+public:
+    enum : int { MaxSamples = 256 };
+
+private:
+    struct Trigger
+    {
+        int32_t sample = 0;
+        float gain = 1.f;
+        float pan = 0.f;
+        double when = 0;
+
+        // orders _pending as a heap with the earliest trigger on top
+        bool operator<(Trigger const& other) const { return when > other.when; }
+    };
+
+    // registered samples, only appended to; the render thread reads the first _sample_count
+    std::vector<std::shared_ptr<lab::AudioBus>> _samples;
+    std::atomic<int> _sample_count {0};
+    std::mutex _samples_mutex;
+
+    MpscQueue<Trigger> _queue;
+    std::vector<Trigger> _pending;      // a heap of triggers waiting for their time, render thread only
+
+    // the pool. Voices [0, _active) are playing.
+    int _voices;
+    int _channels;
+    int _active = 0;
+    std::vector<int32_t> _voice_sample;
+    std::vector<int64_t> _voice_position;   // the sample frame at the start of the quantum
+    std::vector<uint64_t> _voice_start;     // context frame the voice started at
+    std::vector<float> _voice_level;        // for Quietest stealing
+    std::vector<float> _voice_gain;         // _channels gains per voice
+
+    std::atomic<VoiceStealing> _stealing {VoiceStealing::Oldest};
+    std::atomic<int> _active_count {0};
+    std::atomic<uint64_t> _dropped {0};
+    std::atomic<uint64_t> _stolen {0};
+
+    void startVoice(const Trigger& t, int64_t offset, uint64_t frame);
+    void stopVoice(int v);
+
+public:
+    // voices is the size of the pool, and queueCapacity the number of triggers that may be
+    // waiting, either to be picked up or for their time to come
+    explicit VoicePoolNode(lab::AudioContext& ac, int voices = 256, int channels = 2, size_t queueCapacity = 4096);
+    virtual ~VoicePoolNode() = default;
+
+    static const char* static_name() { return "VoicePool"; }
+    virtual const char* name() const override { return static_name(); }
+    static lab::AudioNodeDescriptor* desc();
+
+    // Returns the sample's index, or -1 if MaxSamples are already registered. May be called
+    // while the node plays; samples are never released until the node is destroyed.
+    int addSample(std::shared_ptr<lab::AudioBus> sample);
+
+    // Plays a sample at when, in the context's time; a time that has passed plays as soon as
+    // possible. pan runs from -1, left, to 1, right. Lock free, from any thread. Returns
+    // false if the queue is full, or the sample doesn't exist.
+    bool trigger(int sample, double when = 0, float gain = 1.f, float pan = 0.f);
+
+    void setStealing(VoiceStealing stealing) { _stealing = stealing; }
+
+    int voices() const { return _voices; }
+    int activeVoices() const { return _active_count; }
+    uint64_t droppedTriggers() const { return _dropped; }
+    uint64_t stolenVoices() const { return _stolen; }
+
+    virtual void process(lab::ContextRenderLock& r, int bufferSize) override;
+    virtual void reset(lab::ContextRenderLock&) override;
+    virtual double tailTime(lab::ContextRenderLock&) const override { return 0; }
+    virtual double latencyTime(lab::ContextRenderLock&) const override { return 0; }
+};
+
+#endif
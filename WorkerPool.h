@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright (C) 2020, The LabSound Authors. All rights reserved.
+
+#ifndef LABSOUNDDEMO_WORKERPOOL_H
+#define LABSOUNDDEMO_WORKERPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads running tasks in the order they are submitted. Intended for work
+// off the render thread, such as loading assets. Tasks still queued when the pool is
+// destroyed are discarded; running tasks are waited for.
+class WorkerPool
+{
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque<std::function<void()>> _tasks;
+    std::vector<std::thread> _threads;
+    bool _stop = false;
+
+    void run()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+                if (_stop)
+                    return;
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit WorkerPool(unsigned int threads)
+    {
+        for (unsigned int i = 0; i < (threads ? threads : 1); ++i)
+            _threads.emplace_back([this]() { run(); });
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+            _tasks.clear();
+        }
+        _cv.notify_all();
+        for (auto& t : _threads)
+            t.join();
+    }
+
+    WorkerPool(WorkerPool const&) = delete;
+    WorkerPool& operator=(WorkerPool const&) = delete;
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push_back(std::move(task));
+        }
+        _cv.notify_one();
+    }
+};
+
+#endif